@@ -23,6 +23,7 @@
 
   #define DebugLog(trace)   utils::Logger::getBuffer() << trace; utils::Logger::write(utils::LogLevel::DEBUG)
   #define InfoLog(trace)    utils::Logger::getBuffer() << trace; utils::Logger::write(utils::LogLevel::INFO)
+  #define WarnLog(trace)    utils::Logger::getBuffer() << trace; utils::Logger::write(utils::LogLevel::WARNING)
   #define ErrorLog(trace)   utils::Logger::getBuffer() << trace; utils::Logger::write(utils::LogLevel::ERROR)
 
   #define DestroyLogger()   utils::Logger::destroy()
@@ -30,7 +31,7 @@
 
 namespace utils
 {
-  enum LogLevel : uint8_t { DEBUG, INFO, ERROR };
+  enum LogLevel : uint8_t { DEBUG, INFO, WARNING, ERROR };
 
   class Logger
   {
@@ -52,8 +53,8 @@ namespace utils
     
 
   private:
-    inline static const std::string HEADERS[]{ "DEBUG: ", "INFO: ", "\n***********************************************************************\nERROR: " };
-    inline static const std::string TAILS[]{ "\n", "\n", "\n***********************************************************************\n\n" };
+    inline static const std::string HEADERS[]{ "DEBUG: ", "INFO: ", "WARNING: ", "\n***********************************************************************\nERROR: " };
+    inline static const std::string TAILS[]{ "\n", "\n", "\n", "\n***********************************************************************\n\n" };
 
     inline static std::unique_ptr<Logger> _logger{ nullptr };
     inline static std::stringstream _buffer;
@@ -73,6 +74,7 @@ namespace utils
 
   #define DebugLog(trace)
   #define InfoLog(trace)
+  #define WarnLog(trace)
   #define ErrorLog(trace)
 
   #define DestroyLogger()
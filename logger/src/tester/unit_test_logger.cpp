@@ -53,6 +53,7 @@ int main() {
     InitializeLoggerLevel(utils::INFO, std::cout);
     DebugLog("Debug");
     InfoLog("Info");
+    WarnLog("Warning");
     ErrorLog("Error");
     DestroyLogger();
   }
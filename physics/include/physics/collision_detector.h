@@ -0,0 +1,155 @@
+#ifndef COLLISION_DETECTOR_H
+#define COLLISION_DETECTOR_H
+
+#include <vector>
+#include <functional>
+
+#include <physics/units.h>
+#include <geometry/basic_types.h>
+
+
+namespace physics
+{
+  /**
+    *  \brief  Continuous collision detection between spherical bodies, over an interval of time between two known states of all the bodies.
+    *          The trajectory of each body in the interval is the cubic Hermite curve defined by its positions and velocities at both ends.
+    *             - Broad phase: every trajectory is bounded by a box (the bounding box of the Bezier control points of the curve, which contain it, 
+    *               enlarged by the radius of the body). The boxes are sorted along the x axis and swept (sweep and prune), so only the pairs of 
+    *               bodies with overlapping boxes are tested. The order of the boxes is kept between detections and updated with an insertion sort, 
+    *               which is almost linear since the order barely changes between consecutive intervals.
+    *             - Narrow phase: the closest approach of the relative trajectory of each pair is found (sampling and golden section search). If the
+    *               distance is below the sum of the radii, the time of the first contact is found by bisection and reported as an impact.
+    *          Pairs which are already in contact at the start of the interval are not reported again.
+    *          A single curve cannot follow a body which turns a large angle in the interval (e.g. a fast moon when the detection waits for the 
+    *          synchronization of the bodies). Such a body can be given a maximum segment length (a fraction of its orbital period): its trajectory 
+    *          is then a piecewise Hermite curve, through its states at the ends of 2^k equal segments, which are provided by a sampler (e.g. from 
+    *          the orbits, see KBody::stateAt()). Its box bounds all the segments, and the candidate pairs are tested segment by segment, with the 
+    *          segments of the body of the pair with more segments (the interpolation of the other body in them is exact at its own segments).
+    *          The vectors keep their capacity, so the detection can be executed periodically without allocations.
+    *
+    *          (Times are measured in seconds since the start of the interval, lengths in meters and speeds in meters per second)
+    */
+  class CollisionDetector
+  {
+  public:
+    struct Impact
+    {
+      size_t           body_1;     /**< Index of the first body (body_1 < body_2) */
+      size_t           body_2;
+      double           time;       /**< Time of the first contact */
+      units::LENGTH_T  distance;   /**< Distance between the centers at the closest approach */
+    };
+
+    /**
+      *  \brief  Function providing the state of a body (index) at a time of the interval
+      */
+    using Sampler = std::function<void(size_t body, double time, geometry::Vec3<units::LENGTH_T>& position, geometry::Vec3<units::SPEED_T>& velocity)>;
+
+    /**
+      *  \brief  Maximum number of segments of a trajectory
+      */
+    static constexpr size_t MAX_SEGMENTS{ 4096 };
+
+    /**
+      *  \brief  Constructor
+      *  @param  samples  Number of samples of the relative trajectories used to find the closest approach (at least 2)
+      */
+    CollisionDetector(size_t samples = 8) : _samples{ samples < 2 ? 2 : samples } {}
+
+    /**
+      *  \brief  Copy Constructor: DELETED
+      */
+    CollisionDetector(const CollisionDetector&) = delete;
+
+    /**
+      *  \brief  Assignment operator: DELETED
+      */
+    CollisionDetector& operator=(const CollisionDetector&) = delete;
+
+    /**
+      *  \brief  Detects the impacts between the bodies during an interval. The number of bodies must not change between detections 
+      *          (otherwise the order of the boxes is reset)
+      *  @param  positions_0, velocities_0  States of the bodies at the start of the interval
+      *  @param  positions_1, velocities_1  States of the bodies at the end of the interval
+      *  @param  radii     Radii of the bodies
+      *  @param  interval  Length of the interval
+      *  @param  impacts   The impacts are added to this vector, sorted by time
+      *  @throw  invalid_argument  If the sizes of the vectors do not match
+      */
+    void detect(const std::vector<geometry::Vec3<units::LENGTH_T>>& positions_0, const std::vector<geometry::Vec3<units::SPEED_T>>& velocities_0,
+                const std::vector<geometry::Vec3<units::LENGTH_T>>& positions_1, const std::vector<geometry::Vec3<units::SPEED_T>>& velocities_1,
+                const std::vector<units::LENGTH_T>& radii, double interval, std::vector<Impact>& impacts) {
+      detect(positions_0, velocities_0, positions_1, velocities_1, radii, std::vector<double>(), Sampler(), interval, impacts);
+    }
+
+    /**
+      *  \brief  Detects the impacts between the bodies during an interval, with the trajectories of the fast bodies divided in segments
+      *  @param  max_segments  Maximum length of the segments of each body (0 or greater than the interval: a single segment). If it is empty, all 
+      *                        the trajectories have a single segment
+      *  @param  sampler       Function providing the states at the ends of the segments inside the interval
+      *  (the rest of parameters as in the other overload)
+      *  @throw  invalid_argument  If the sizes of the vectors do not match
+      */
+    void detect(const std::vector<geometry::Vec3<units::LENGTH_T>>& positions_0, const std::vector<geometry::Vec3<units::SPEED_T>>& velocities_0,
+                const std::vector<geometry::Vec3<units::LENGTH_T>>& positions_1, const std::vector<geometry::Vec3<units::SPEED_T>>& velocities_1,
+                const std::vector<units::LENGTH_T>& radii, const std::vector<double>& max_segments, const Sampler& sampler, double interval, 
+                std::vector<Impact>& impacts);
+
+    /**
+      *  \brief  Number of pairs tested in the narrow phase during the last detection
+      */
+    size_t candidates() const { return _candidates; }
+
+
+  private:
+    struct Box
+    {
+      geometry::Vec3<units::LENGTH_T> min;
+      geometry::Vec3<units::LENGTH_T> max;
+    };
+
+    /**
+      *  \brief  Relative trajectory of a pair of bodies: r(s) = a*s^3 + b*s^2 + c*s + d, with s in [0, 1]
+      */
+    struct Trajectory
+    {
+      geometry::Vec3<units::LENGTH_T> a, b, c, d;
+
+      geometry::Vec3<units::LENGTH_T> at(double s) const { return ((a * s + b) * s + c) * s + d; }
+    };
+
+    size_t  _samples;
+
+    std::vector<Box>      _boxes;
+
+    /**
+      *  \brief  Indexes of the bodies sorted by the minimum x of their boxes, and bodies whose boxes contain the current x during the sweep
+      */
+    std::vector<uint32_t> _order, _active;
+
+    size_t  _candidates{ 0 };
+
+    /**
+      *  \brief  Number of segments of the trajectory of every body (a power of 2), and index of its first state in the states at the ends of the 
+      *          segments (segments + 1 states for each body, including the ends of the interval)
+      */
+    std::vector<uint32_t> _segments;
+    std::vector<size_t>   _first_state;
+    std::vector<geometry::Vec3<units::LENGTH_T>> _state_positions;
+    std::vector<geometry::Vec3<units::SPEED_T>>  _state_velocities;
+
+    /**
+      *  \brief  State of a body at a fraction of the interval (s in [0, 1]), interpolated in its segment
+      */
+    void trajectoryState(size_t body, double s, double interval, geometry::Vec3<units::LENGTH_T>& position, geometry::Vec3<units::SPEED_T>& velocity) const;
+
+    /**
+      *  \brief  Narrow phase for a pair of bodies. Returns true and sets the impact if the bodies get in contact during the interval
+      */
+    bool narrowPhase(const Trajectory& trajectory, units::LENGTH_T contact_distance, double interval, Impact& impact) const;
+
+  }; // END class CollisionDetector
+}
+
+
+#endif // COLLISION_DETECTOR_H
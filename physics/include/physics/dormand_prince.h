@@ -0,0 +1,141 @@
+#ifndef DORMAND_PRINCE_H
+#define DORMAND_PRINCE_H
+
+#include <algorithm>
+#include <cmath>
+
+#include <physics/units.h>
+#include <geometry/basic_types.h>
+
+
+namespace physics
+{
+  /**
+    *  \brief  Adaptive integrator of the motion of a body: embedded Runge-Kutta pair of Dormand and Prince, order 5(4). The 5th order solution is
+    *          propagated and the difference with the 4th order solution estimates the error of every step. The step is adapted to keep the error
+    *          of the position and the velocity below a relative tolerance, so the steps are short at a close approach and long far from it.
+    *          The last stage of a step is the first stage of the next one (FSAL), so each accepted step costs 6 evaluations of the acceleration.
+    *          It does not allocate memory and has no state, so the same integrator can be used by several threads.
+    *
+    *          (Times are measured in seconds, lengths in meters and speeds in meters per second)
+    */
+  class DormandPrince
+  {
+  public:
+    /**
+      *  \brief  Position and velocity of the body
+      */
+    struct State
+    {
+      geometry::Vec3<units::LENGTH_T>  position;
+      geometry::Vec3<units::SPEED_T>   velocity;
+    };
+
+    /**
+      *  \brief  Constructor
+      *  @param  tolerance  Maximum error of every step, relative to the position and the velocity
+      *  @param  max_steps  Maximum number of steps (accepted or rejected) of an integration
+      */
+    DormandPrince(double tolerance = 1e-10, size_t max_steps = 100000) : _tolerance{ tolerance }, _max_steps{ max_steps } {}
+
+    /**
+      *  \brief  Integrates the state from t0 to t1
+      *  @param  state         Initial state, replaced by the final state (unchanged if the integration fails)
+      *  @param  t0, t1        Initial and final times (t1 > t0)
+      *  @param  step          Initial step. It is replaced by the last step proposed by the controller (to be used in the next integration)
+      *  @param  acceleration  Function (double t, const Vec3<LENGTH_T>& position) -> Vec3<ACCELERATION_T>
+      *  @return  Number of accepted steps. 0 if the maximum number of steps has been reached
+      */
+    template <typename ACCELERATION>
+    size_t integrate(State& state, double t0, double t1, double& step, ACCELERATION&& acceleration) const;
+
+    double tolerance() const { return _tolerance; }
+
+  private:
+    double  _tolerance;
+    size_t  _max_steps;
+
+  }; // END class DormandPrince
+
+
+
+  template <typename ACCELERATION>
+  size_t DormandPrince::integrate(State& state, double t0, double t1, double& step, ACCELERATION&& acceleration) const {
+    using Position = geometry::Vec3<units::LENGTH_T>;
+    using Velocity = geometry::Vec3<units::SPEED_T>;
+
+    // Butcher tableau (c: nodes, a: stages) and weights of the error (5th order minus 4th order weights)
+    constexpr double C2{ 1.0 / 5 }, C3{ 3.0 / 10 }, C4{ 4.0 / 5 }, C5{ 8.0 / 9 };
+    constexpr double A21{ 1.0 / 5 };
+    constexpr double A31{ 3.0 / 40 }, A32{ 9.0 / 40 };
+    constexpr double A41{ 44.0 / 45 }, A42{ -56.0 / 15 }, A43{ 32.0 / 9 };
+    constexpr double A51{ 19372.0 / 6561 }, A52{ -25360.0 / 2187 }, A53{ 64448.0 / 6561 }, A54{ -212.0 / 729 };
+    constexpr double A61{ 9017.0 / 3168 }, A62{ -355.0 / 33 }, A63{ 46732.0 / 5247 }, A64{ 49.0 / 176 }, A65{ -5103.0 / 18656 };
+    constexpr double A71{ 35.0 / 384 }, A73{ 500.0 / 1113 }, A74{ 125.0 / 192 }, A75{ -2187.0 / 6784 }, A76{ 11.0 / 84 };
+    constexpr double E1{ 71.0 / 57600 }, E3{ -71.0 / 16695 }, E4{ 71.0 / 1920 }, E5{ -17253.0 / 339200 }, E6{ 22.0 / 525 }, E7{ -1.0 / 40 };
+
+    // The derivatives of the position are velocities (kr) and the derivatives of the velocity are accelerations (kv)
+    Position r{ state.position };
+    Velocity v{ state.velocity };
+    Velocity kr[7];
+    Velocity kv[7];
+    kr[0] = v;
+    kv[0] = acceleration(t0, r);
+
+    double t{ t0 };
+    size_t accepted{ 0 };
+    for (size_t iter = 0; t < t1; iter++) {
+      if (iter == _max_steps)
+        return 0;
+
+      const double h = std::min(step, t1 - t);
+      const bool last = (h < step);
+
+      kr[1] = v + h * A21 * kv[0];
+      kv[1] = acceleration(t + C2 * h, r + h * (A21 * kr[0]));
+      kr[2] = v + h * (A31 * kv[0] + A32 * kv[1]);
+      kv[2] = acceleration(t + C3 * h, r + h * (A31 * kr[0] + A32 * kr[1]));
+      kr[3] = v + h * (A41 * kv[0] + A42 * kv[1] + A43 * kv[2]);
+      kv[3] = acceleration(t + C4 * h, r + h * (A41 * kr[0] + A42 * kr[1] + A43 * kr[2]));
+      kr[4] = v + h * (A51 * kv[0] + A52 * kv[1] + A53 * kv[2] + A54 * kv[3]);
+      kv[4] = acceleration(t + C5 * h, r + h * (A51 * kr[0] + A52 * kr[1] + A53 * kr[2] + A54 * kr[3]));
+      kr[5] = v + h * (A61 * kv[0] + A62 * kv[1] + A63 * kv[2] + A64 * kv[3] + A65 * kv[4]);
+      kv[5] = acceleration(t + h, r + h * (A61 * kr[0] + A62 * kr[1] + A63 * kr[2] + A64 * kr[3] + A65 * kr[4]));
+
+      // 5th order solution, and its derivatives (first stage of the next step)
+      const Position r_new = r + h * (A71 * kr[0] + A73 * kr[2] + A74 * kr[3] + A75 * kr[4] + A76 * kr[5]);
+      const Velocity v_new = v + h * (A71 * kv[0] + A73 * kv[2] + A74 * kv[3] + A75 * kv[4] + A76 * kv[5]);
+      kr[6] = v_new;
+      kv[6] = acceleration(t + h, r_new);
+
+      // Error, relative to the tolerance
+      const Position r_error = h * (E1 * kr[0] + E3 * kr[2] + E4 * kr[3] + E5 * kr[4] + E6 * kr[5] + E7 * kr[6]);
+      const Velocity v_error = h * (E1 * kv[0] + E3 * kv[2] + E4 * kv[3] + E5 * kv[4] + E6 * kv[5] + E7 * kv[6]);
+      const double error = std::max(r_error.norm() / (_tolerance * std::max(r.norm(), r_new.norm())),
+                                    v_error.norm() / (_tolerance * std::max(v.norm(), v_new.norm())));
+
+      // New step: h * 0.9 * error^(-1/5), changed at most by a factor of 5
+      const double factor = (error > 0) ? std::min(5.0, std::max(0.2, 0.9 * std::pow(error, -0.2))) : 5.0;
+      if (error <= 1) {
+        t = last ? t1 : t + h;
+        r = r_new;
+        v = v_new;
+        kr[0] = kr[6];
+        kv[0] = kv[6];
+        accepted++;
+        // The last step is shortened to reach t1, so it does not determine the next step (unless it has to be reduced)
+        if (!last || factor < 1)
+          step = h * factor;
+      }
+      else
+        step = h * factor;
+    }
+
+    state.position = r;
+    state.velocity = v;
+    return accepted;
+  }
+}
+
+
+#endif // DORMAND_PRINCE_H
@@ -0,0 +1,218 @@
+#ifndef EPHEMERIS_CACHE_H
+#define EPHEMERIS_CACHE_H
+
+#include <vector>
+#include <unordered_map>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <future>
+
+#include <physics/units.h>
+#include <geometry/basic_types.h>
+
+
+namespace physics
+{
+  /**
+    *  \brief  Cache of Chebyshev ephemerides, used to evaluate the state of a set of bodies at any time with a few polynomial evaluations
+    *          (replay, rendering at interpolated times, repeated queries over the same interval)
+    *          The time is divided in segments of the same length. For every body and segment, the position and velocity given by a propagator
+    *          (e.g. the Kepler orbit of the body, see KeplerOrbit::stateAt()) are sampled at the Chebyshev nodes of the segment and fitted with
+    *          Chebyshev series of the configured degree.
+    *          The segments are fitted lazily: when a state in a missing segment is evaluated, or in advance by the worker threads (see prefetch()).
+    *          When the memory used by the segments exceeds the memory budget, the least recently used segments (an eighth of them) are evicted.
+    *          The cache can be used from several threads. The propagator is called from the worker threads and from the threads evaluating the
+    *          states, so it must be thread safe. The cache does not detect changes in the propagated orbits: in that case it must be cleared (the 
+    *          segments being fitted when it is cleared are discarded)
+    *
+    *          (Times are measured in seconds since the start of the simulation, lengths in meters and speeds in meters per second)
+    */
+  class EphemerisCache
+  {
+  public:
+    /**
+      *  \brief  Position and velocity of a body
+      */
+    using State = std::pair<geometry::Vec3<units::LENGTH_T>, geometry::Vec3<units::SPEED_T>>;
+
+    /**
+      *  \brief  Function providing the exact state of a body (index) at any time
+      */
+    using Propagator = std::function<State(size_t body, double time)>;
+
+    /**
+      *  \brief  Constructor
+      *  @param  num_bodies      Number of bodies. The bodies are identified by their index in [0, num_bodies)
+      *  @param  propagator      Function providing the exact states which are fitted
+      *  @param  segment_length  Length of the segments
+      *  @param  degree          Degree of the Chebyshev series
+      *  @param  memory_budget   Maximum memory used by the segments (in bytes)
+      *  @param  num_threads     Number of worker threads fitting the prefetched segments (0: the segments are only fitted when they are evaluated)
+      *  @throw  invalid_argument  If the segment length or the degree are not positive
+      */
+    EphemerisCache(size_t num_bodies, Propagator propagator, units::TIME_T segment_length, size_t degree, size_t memory_budget, size_t num_threads = 1);
+
+    /**
+      *  \brief  Copy Constructor: DELETED
+      */
+    EphemerisCache(const EphemerisCache&) = delete;
+
+    /**
+      *  \brief  Assignment operator: DELETED
+      */
+    EphemerisCache& operator=(const EphemerisCache&) = delete;
+
+    /**
+      *  \brief  Destructor: stops the worker threads (the pending prefetches are discarded)
+      */
+    ~EphemerisCache();
+
+    /**
+      *  \brief  State of a body at any time. The segment is fitted if it is not in the cache
+      *  @param  body  Index of the body
+      *  @param  time  The time
+      *  @return  Position and velocity of the body
+      *  @throw  out_of_range  If the body index is not valid
+      */
+    State evaluate(size_t body, double time);
+
+    /**
+      *  \brief  Requests the worker threads to fit the segments of a body covering the interval [first_time, last_time]. It does not wait for them.
+      *          Without worker threads the segments are fitted before returning
+      *  @return  Future which is ready when all the segments have been fitted. If the cache is destroyed before, the pending segments are discarded 
+      *           and the future holds a broken_promise error
+      *  @throw  out_of_range  If the body index is not valid
+      */
+    std::future<void> prefetch(size_t body, double first_time, double last_time);
+
+    /**
+      *  \brief  Removes all the segments (e.g. when the propagated orbits have changed)
+      */
+    void clear();
+
+    /**
+      *  \brief  Memory used by the segments (in bytes)
+      */
+    size_t memoryUsage() const;
+
+    /**
+      *  \brief  Number of segments in the cache
+      */
+    size_t size() const;
+
+    /**
+      *  \brief  Number of bodies
+      */
+    size_t numBodies() const { return _num_bodies; }
+
+
+  private:
+    /**
+      *  \brief  Segment identifier: body index and segment index (time / segment length, rounded down)
+      */
+    using Key = std::pair<size_t, int64_t>;
+
+    /**
+      *  \brief  Chebyshev coefficients of a segment: (degree + 1) groups of 6 coefficients, one for each series (x, y, z, vx, vy, vz), so the 6 series 
+      *          are evaluated together. They are shared, so a segment can be evicted while its coefficients are being evaluated
+      */
+    using Coefficients = std::shared_ptr<const std::vector<double>>;
+
+    struct Segment
+    {
+      Coefficients  coefficients;
+      uint64_t      last_use;     /**< Value of the use counter when the segment was used for the last time */
+    };
+
+    struct KeyHash
+    {
+      size_t operator()(const Key& key) const { return std::hash<int64_t>()(key.second * 1000003 + int64_t(key.first)); }
+    };
+
+    /**
+      *  \brief  Memory used by a segment (coefficients plus bookkeeping)
+      */
+    size_t segmentMemory() const { return (_degree + 1) * 6 * sizeof(double) + sizeof(Segment) + 4 * sizeof(Key); }
+
+    const size_t        _num_bodies;
+    const Propagator    _propagator;
+    const double        _segment_length;
+    const size_t        _degree;
+    const size_t        _memory_budget;
+
+    /**
+      *  \brief  Chebyshev nodes in [-1, 1] and cosines used in the fit: cos(PI * j * (k + 0.5) / (degree + 1))
+      */
+    std::vector<double> _nodes;
+    std::vector<double> _cosines;
+
+    mutable std::mutex                            _mutex;
+    std::unordered_map<Key, Segment, KeyHash>     _segments;
+
+    /**
+      *  \brief  Counter incremented in every use of a segment (used to find the least recently used segments)
+      */
+    uint64_t              _use_counter{ 0 };
+
+    /**
+      *  \brief  Counter incremented when the cache is cleared. The segments fitted before are not inserted
+      */
+    uint64_t              _generation{ 0 };
+
+    size_t                _memory{ 0 };
+
+    /**
+      *  \brief  Buffer used to sort the segments by last use when they are evicted
+      */
+    std::vector<uint64_t> _evict_buffer;
+
+    /**
+      *  \brief  Segments requested in a call to prefetch(): the promise is fulfilled when the last one has been fitted
+      */
+    struct Prefetch
+    {
+      std::promise<void>  done;
+      size_t              pending;
+    };
+
+    /**
+      *  \brief  Worker threads and segments requested to them
+      */
+    std::vector<std::thread>                                    _workers;
+    std::mutex                                                  _requests_mutex;
+    std::condition_variable                                     _requests_cv;
+    std::deque<std::pair<Key, std::shared_ptr<Prefetch>>>      _requests;
+    bool                                                        _stop{ false };
+
+    /**
+      *  \brief  Fits the Chebyshev series of a segment, calling the propagator at the Chebyshev nodes
+      */
+    Coefficients fit(const Key& key) const;
+
+    /**
+      *  \brief  Finds a segment in the cache (marking it as the most recently used). Returns nullptr if the segment is not in the cache.
+      *          The generation is set to the current one, to be passed to insert() if the segment is fitted
+      */
+    Coefficients find(const Key& key, uint64_t& generation);
+
+    /**
+      *  \brief  Inserts a fitted segment (unless another thread inserted it before, or the cache has been cleared since the given generation). 
+      *          If the memory budget is exceeded, an eighth of the segments (the least recently used ones) are evicted, so the cost of the eviction 
+      *          is amortized
+      */
+    Coefficients insert(const Key& key, Coefficients coefficients, uint64_t generation);
+
+    /**
+      *  \brief  Function executed by the worker threads
+      */
+    void work();
+
+  }; // END class EphemerisCache
+}
+
+
+#endif // EPHEMERIS_CACHE_H
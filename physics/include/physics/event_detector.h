@@ -0,0 +1,128 @@
+#ifndef EVENT_DETECTOR_H
+#define EVENT_DETECTOR_H
+
+#include <vector>
+#include <array>
+#include <string>
+
+#include <physics/units.h>
+#include <geometry/basic_types.h>
+
+
+namespace physics
+{
+  /**
+    *  \brief  Detection of events over an interval of time between two known states of the bodies. Every event is the root of an event function
+    *          g(t) of the states of 1 to 3 bodies, and it is reported with its direction (rising: g changes from negative to positive):
+    *             - APSIS: g = r . v / |r|^2, relative to the reference body. Rising: periapsis passage, falling: apoapsis passage
+    *             - SOI: g = distance to the other body - radius of its sphere of influence. Falling: SOI entry, rising: SOI exit
+    *             - DISTANCE: g = distance to the other body - threshold distance. Falling: closer than the distance, rising: farther
+    *             - CONJUNCTION: g = sine of the difference of the ecliptic longitudes of the body and the other body, seen from the reference body.
+    *               Only the roots where both bodies are on the same side of the reference body are reported (the oppositions are not)
+    *             - ECLIPSE: g = angle between the other body (occulter) and the reference body (light source) seen from the body - sum of their
+    *               apparent radii. Falling: start of the partial eclipse of the light source, rising: end
+    *          The trajectory of each body in the interval is the cubic Hermite curve defined by its positions and velocities at both ends
+    *          (see CollisionDetector). The interval is divided in samples: the event functions are evaluated at the samples, so every sign change
+    *          brackets a root, which is refined with the Illinois method (regula falsi). Several roots of a function in the same sample are not
+    *          detected, so the interval must be short compared to the periods of the events.
+    *          A root at the boundary between 2 intervals is only reported once, since g = 0 is considered positive.
+    *
+    *          (Times are measured in seconds since the start of the interval, lengths in meters and speeds in meters per second)
+    */
+  class EventDetector
+  {
+  public:
+    enum Type : uint8_t { APSIS, SOI, DISTANCE, CONJUNCTION, ECLIPSE };
+    inline static const std::array<std::string, 5> TYPE_NAME{ "APSIS", "SOI", "DISTANCE", "CONJUNCTION", "ECLIPSE" };
+
+    /**
+      *  \brief  Event function. The bodies are indexes in the vectors of states
+      */
+    struct Definition
+    {
+      Type             type;
+      size_t           body;
+      size_t           other;        /**< Other body (SOI, DISTANCE, CONJUNCTION) or occulter (ECLIPSE). Not used by APSIS */
+      size_t           reference;    /**< Primary body (APSIS), observer (CONJUNCTION) or light source (ECLIPSE). Not used by SOI and DISTANCE */
+      units::LENGTH_T  distance;     /**< Radius of the SOI (SOI) or threshold distance (DISTANCE) */
+    };
+
+    struct Event
+    {
+      size_t  definition;   /**< Index of the definition */
+      double  time;         /**< Time of the root */
+      bool    rising;       /**< The event function changes from negative to positive */
+    };
+
+    /**
+      *  \brief  Constructor
+      *  @param  samples  Number of samples of the interval (at least 1)
+      */
+    EventDetector(size_t samples = 8) : _samples{ samples < 1 ? 1 : samples } {}
+
+    /**
+      *  \brief  Copy Constructor: DELETED
+      */
+    EventDetector(const EventDetector&) = delete;
+
+    /**
+      *  \brief  Assignment operator: DELETED
+      */
+    EventDetector& operator=(const EventDetector&) = delete;
+
+    /**
+      *  \brief  Name of an event: the type and the direction (e.g. PERIAPSIS, SOI EXIT)
+      */
+    static std::string eventName(Type type, bool rising);
+
+    /**
+      *  \brief  Detects the events during an interval
+      *  @param  definitions                Event functions
+      *  @param  positions_0, velocities_0  States of the bodies at the start of the interval
+      *  @param  positions_1, velocities_1  States of the bodies at the end of the interval
+      *  @param  radii     Radii of the bodies (used by ECLIPSE)
+      *  @param  interval  Length of the interval
+      *  @param  events    The events are added to this vector, sorted by time
+      *  @throw  invalid_argument  If the sizes of the vectors do not match or a definition uses a body which does not exist
+      */
+    void detect(const std::vector<Definition>& definitions,
+                const std::vector<geometry::Vec3<units::LENGTH_T>>& positions_0, const std::vector<geometry::Vec3<units::SPEED_T>>& velocities_0,
+                const std::vector<geometry::Vec3<units::LENGTH_T>>& positions_1, const std::vector<geometry::Vec3<units::SPEED_T>>& velocities_1,
+                const std::vector<units::LENGTH_T>& radii, double interval, std::vector<Event>& events);
+
+
+  private:
+    /**
+      *  \brief  Trajectory of a body: r(s) = a*s^3 + b*s^2 + c*s + d, with s in [0, 1]
+      */
+    struct Trajectory
+    {
+      geometry::Vec3<units::LENGTH_T> a, b, c, d;
+
+      geometry::Vec3<units::LENGTH_T> at(double s) const { return ((a * s + b) * s + c) * s + d; }
+      geometry::Vec3<units::LENGTH_T> derivative(double s) const { return (3 * a * s + 2 * b) * s + c; }
+    };
+
+    size_t  _samples;
+
+    /**
+      *  \brief  Trajectories of the bodies in the current interval, and values of the event function at the samples
+      */
+    std::vector<Trajectory>  _trajectories;
+    std::vector<double>      _values;
+
+    /**
+      *  \brief  Value of the event function at s
+      */
+    double value(const Definition& definition, const std::vector<units::LENGTH_T>& radii, double s) const;
+
+    /**
+      *  \brief  Root of the event function in [s_0, s_1], where it changes its sign (Illinois method)
+      */
+    double root(const Definition& definition, const std::vector<units::LENGTH_T>& radii, double s_0, double value_0, double s_1, double value_1) const;
+
+  }; // END class EventDetector
+}
+
+
+#endif // EVENT_DETECTOR_H
@@ -1,10 +1,17 @@
 #ifndef K_BODY_H
 #define K_BODY_H
 
+#include <unordered_map>
+
 #include <physics/p_body.h>
 #include <physics/kepler_orbit.h>
+#include <physics/kepler_batch.h>
+#include <physics/octree.h>
+#include <physics/dormand_prince.h>
+#include <physics/ephemeris_cache.h>
 
 #include <collections/mtree.h>
+#include <misc/thread_pool.h>
 
 
 namespace physics
@@ -17,25 +24,114 @@ namespace physics
                   - PLANETS: Name
                   - DWARF PLANETS AND MINOR BODIES: id + " " + name | provisional name
                   - SATELLITES: name + " [<Parent body name> <id-in-Roman-Numeral>]"
+                  - SHIPS: Name
     *          The keplerian body has a Kepler orbit unless it is not gravitationally bound to any other body.
     *          All the bodies can be stored in a hierarchical tree, represented by an MTree.
     *          Keplerian bodies can interact and be perturbated by gravitational interactions. The way these interactions are calculated depends on the configuration
-    *             defined in the properties file body.cfg. These properties are read upon initialization of the class: see initialize(). Bodies can't be created before
-    *             class initialization.
+    *             defined in the properties file body.cfg. The property BARYCENTER_LIMIT is read upon initialization of the class: see initialize(). Bodies can't be 
+    *             created before class initialization. The rest of the properties are read by the context of the movement (see Context), which holds all the 
+    *             state of the movement of a tree of bodies. Each simulation owns its context, so several simulations can move their bodies in the same process.
     *          Once all the bodies are created, using a common CS, the barycenter of the system as well as the different local barycenters should be calculated. Only bodies fulfilling
-    *             some conditions will be used to calculate the barycenter and the perturbations on their parent bodies: see barycenters()
+    *             some conditions will be used to calculate the barycenter and the perturbations on their parent bodies: see Context::barycenters()
     *          The barycenter of the system will be used as new inertial CS for all the bodies. No more bodies can be created after this change is performed. 
     *             The position of all barycenters will be stored in each parent body, using the new inertial CS. 
-    *          Only after these steps are executed the gravitational interaction of the system should be called: see gravInteraction(). This method will calculate the changes in positions 
+    *          Only after these steps are executed the gravitational interaction of the system should be called: see Context::gravInteraction(). This method will calculate the changes in positions 
     *             and velocities, as well as perturbations caused by all the bodies in all the other bodies, according to certain rules configured in body.cfg.
     *          Finally the movement of each body will be executed: see keplerMove()
+    *          The Kepler orbits of all the moving bodies are propagated together, in a single batch (see KeplerBatch), which is bound to the tree of bodies
+    *             when the barycenters are set.
+    *          The movement is executed in parallel phases by a pool of threads (property THREADS in body.cfg; 0 = all the hardware threads)
+    *          The integrator is selected with the property INTEGRATOR in body.cfg:
+    *             - KEPLER: each body follows its Kepler orbit around its parent
+    *             - WISDOM_HOLMAN: mixed variable symplectic integrator for the first level bodies, in democratic heliocentric coordinates (positions 
+    *               relative to the root body and barycentric velocities, which are canonical). Every tick is split in a half kick, a Kepler drift 
+    *               of the orbits (around the mass of the root body) and another half kick. The kicks are the accelerations caused by the first level 
+    *               perturbators (direct terms), combined with the linear drift of the positions caused by the momentum of the root body. 
+    *               The rest of the bodies follow their Kepler orbits around their parents
+    *               Optionally (property MINOR_BODIES_INTERACTION), the first level minor bodies and dwarf planets perturb each other. These accelerations
+    *               are approximated with a Barnes-Hut octree (property OPENING_ANGLE)
+    *             - ENCKE: Encke's method for the first level bodies. Each body follows a reference Kepler orbit, propagated in the batch, and only the 
+    *               small deviation from it is integrated (kick - drift - kick) in the CS of the root body: the accelerations caused by the perturbators 
+    *               (direct and indirect terms) plus the difference between the attraction of the root body at the true and at the reference positions. The reference orbit is rectified (recalculated from 
+    *               the true state) only when the deviation grows beyond RECTIFICATION_THRESHOLD times the distance to the root body
+    *          Close encounters (WISDOM_HOLMAN and ENCKE): a first level body which is not a perturbator is in a close encounter while it is closer to a 
+    *             perturbator in its interaction list than ENCOUNTER_HILL_RADII Hill radii of the perturbator. During the encounter the body is not kicked: 
+    *             its state is integrated through the tick with an adaptive Runge-Kutta integrator (see DormandPrince), with the attraction of the 
+    *             root body and the perturbators, and its orbit is rectified at the end of the tick. When the encounter ends, the body continues with 
+    *             the Kepler orbit and kicks of the integrator
+    *          The perturbators of the root body are selected once, with the property BARYCENTER_LIMIT. With the WISDOM_HOLMAN and ENCKE integrators, each first level 
+    *             body is only perturbated by the perturbators in its interaction list. The lists are updated every INTERACTION_WINDOW seconds and contain the 
+    *             perturbators which can get closer than HILL_RADII Hill radii during the window, or which perturbation can be greater than 
+    *             PERTURBATION_THRESHOLD (relative to the acceleration caused by the root body)
+    *          Multi-rate stepping: each body is moved every 2^k ticks (its step, up to MAX_STEP_TICKS), so that it is moved at least STEPS_PER_ORBIT times per 
+    *             orbital period. The second level bodies are moved by family, with the step of the fastest body of the family. With the WISDOM_HOLMAN and ENCKE 
+    *             integrators the first level bodies are always moved in every tick. The bodies which are not due in a tick keep their previous state, so all the bodies 
+    *             must be synchronized (see Context::synchronize()) before their state is read. The synchronization does not move the orbits: the states are only placed 
+    *             to be read, and restored before the bodies are moved again, so the moves do not depend on when (or whether) the bodies were synchronized
+    *          Ships (type SHIP) are propagated as patched conics, in every tick and outside the batch: each ship follows a Kepler orbit (elliptic or 
+    *             hyperbolic) relative to the body whose sphere of influence (SOI) contains it. When it leaves the SOI of its parent, or enters the SOI 
+    *             of a planet, dwarf planet, satellite or secondary star orbiting its parent, the ship is moved in the tree to the new parent and its orbit 
+    *             is recalculated relative to it (from the orbits at the current time, so the bodies do not need to be synchronized). 
+    *             Ships do not perturbate any body and cannot have children
+    *          Passive bodies (property LAZY_PASSIVE_BODIES): the minor bodies which do not perturbate their parent and have no children are not moved 
+    *             in the ticks, so the cost of a tick depends only on the moving bodies. They keep only their orbits (elements at their epoch): their 
+    *             state is calculated on demand at the current time, from the orbit and the state of the parent, when it is read with state() or states() 
+    *             (position() and velocity() keep the state of the body when it became passive). Their orbits are never recalculated, as the orbits of 
+    *             the moving bodies which are not perturbators (see Context::move()). With the WISDOM_HOLMAN and ENCKE integrators only the second level minor 
+    *             bodies can be passive (the first level bodies are kicked in every tick)
+    *             The states of the passive bodies relative to their parents can be interpolated from Chebyshev ephemerides (property PASSIVE_EPHEMERIS_SEGMENT, 
+    *             see EphemerisCache), fitted to their orbits. The cache is cleared whenever the passive orbits can change: when the batch is bound and when 
+    *             the bodies are restored (checkpoints, rewinds). The kicks and rectifications only change the orbits of the first level bodies, which are not cached
     */
   class KBody : public PBody
   {
   public:
-    enum BodyType : uint8_t {STAR, PLANET, DWARF_PLANET, MINOR_BODY, SATELLITE};
+    enum BodyType : uint8_t {STAR, PLANET, DWARF_PLANET, MINOR_BODY, SATELLITE, SHIP};
+
+    inline static const std::array<std::string, 6> TYPE_NAME{ "STAR", "PLANET", "DWARF_PLANET", "MINOR_BODY", "SATELLITE", "SHIP" };
+
+    enum Integrator : uint8_t {KEPLER, WISDOM_HOLMAN, ENCKE};
+
+    inline static const std::array<std::string, 3> INTEGRATOR_NAME{ "KEPLER", "WISDOM_HOLMAN", "ENCKE" };
+
+    /**
+      *  \brief  State of the movement of a tree of bodies, owned by the simulation which moves it (see Context)
+      */
+    class Context;
+
+    /**
+      *  \brief  Deviation of the position and velocity of a body from its reference orbit (ENCKE)
+      */
+    using Deviation = std::pair<geometry::Vec3<units::LENGTH_T>, geometry::Vec3<units::SPEED_T>>;
 
-    inline static const std::array<std::string, 5> TYPE_NAME{ "STAR", "PLANET", "DWARF_PLANET", "MINOR_BODY", "SATELLITE" };
+    /**
+      *  \brief  Compact copy of the state of all the bodies (see checkpoint() and restore())
+      */
+    struct Checkpoint
+    {
+      struct Entry
+      {
+        PositionType             position;
+        VelocityType             velocity;
+        KeplerOrbit::Checkpoint  orbit;
+        KBody*                   parent;    /**< Parent of the body (it changes for the ships) */
+      };
+
+      units::TIME_T       time{ 0 };
+      uint64_t            ticks{ 0 };    /**< Ticks of the multi-rate stepping */
+      std::vector<Entry>  bodies;        /**< In the iteration order of the tree of bodies */
+      std::vector<Deviation> deviations; /**< Deviations of the first level bodies from their reference orbits, in the order of the batch (ENCKE) */
+    };
+
+    /**
+      *  \brief  Part of the state of a body which is determined when the barycenters are set and not changed afterwards (see setup() and adopt())
+      */
+    struct Setup
+    {
+      bool          parent_perturbator;
+      PositionType  barycenter_pos;
+      VelocityType  barycenter_vel;
+    };
 
     const BodyType    TYPE;
 
@@ -57,12 +153,6 @@ namespace physics
 
     static void initialize();
 
-    /**
-      *  \brief  Determine Barycenter displacement for all the parent bodies with their perturbator children bodies.
-      */
-    static void barycenters(tree::MTree<KBody>& bodies);
-
-
     /**
       *  \brief  Determine Barycenter displacement for a parent body with their perturbator children bodies.
       *          This information is stored in the bodies and will be used during the calulation of the perturbations
@@ -70,9 +160,6 @@ namespace physics
     static void barycenter(tree::MTree<KBody>& bodies, KBody& parent_body);
 
 
-    static void gravInteraction(tree::MTree<KBody>& bodies, const units::TIME_T& delta_t);
-
-
     KBody(DECL_BODY_CONSTRUCTOR_PARAMS, KBody& parent, BodyType type, int64_t id, std::string provisional_name = "");
 
     KBody(DECL_BODY_CONSTRUCTOR_PARAMS); // Constructor for the main star
@@ -90,9 +177,47 @@ namespace physics
     const KBody& parent() const { return *_parent; }
 
     const KeplerOrbit& orbit() const { return *_orbit; }
+
+    /**
+      *  \brief  Whether the state of the body is calculated on demand (passive body, see LAZY_PASSIVE_BODIES)
+      */
+    bool lazy() const { return _lazy; }
+
+    /**
+      *  \brief  Position and velocity of the body at the current time. The state of a passive body, or of a body which lags (or whose parent lags, 
+      *          see multi-rate stepping) while the bodies are not synchronized, is calculated on demand from its orbit and the state of its parent, 
+      *          so a few bodies can be read without synchronizing all of them. To read many bodies, synchronize() them first, as the lagging 
+      *          perturbators are evaluated for each body which depends on the root body. It must not be called while the bodies are being moved
+      */
+    std::pair<PositionType, VelocityType> state() const;
+
+    /**
+      *  \brief  Position and velocity of the body at a time close to the current time (e.g. between two synchronizations), from its state at the 
+      *          current time and the change of the orbits of the body and its ancestors (and of the perturbators of the root body) between both 
+      *          times. The perturbations in between are neglected
+      *  @param  time  Time, in seconds since the start of the simulation
+      */
+    std::pair<PositionType, VelocityType> stateAt(double time) const;
+
+    /**
+      *  \brief  Radius of the Hill sphere at the periapsis: r(p) * cbrt(m / (3 * (M + m))). For unbound orbits the current distance to the parent is used
+      *          DO NOT USE WITH THE ROOT BODY
+      */
+    units::LENGTH_T hillRadius() const;
+
+    /**
+      *  \brief  Radius of the sphere of influence (Laplace): a * (m / M)^(2/5). For unbound orbits the current distance to the parent is used
+      *          DO NOT USE WITH THE ROOT BODY
+      */
+    units::LENGTH_T soiRadius() const;
        
     const bool parentPerturbator() const { return _parent_perturbator; }
 
+    /**
+      *  \brief  Number of ticks between two moves of the body (multi-rate stepping)
+      */
+    size_t stepTicks() const { return _step_ticks; }
+
     /**
       *  \brief  Get the barycenter position with the perturbating bodies (children)
       */
@@ -103,6 +228,8 @@ namespace physics
       */
     const VelocityType& barycenterVel() const { return _barycenter_vel; }
 
+    Setup setup() const { return Setup{ _parent_perturbator, _barycenter_pos, _barycenter_vel }; }
+
 
   protected:
 
@@ -110,16 +237,20 @@ namespace physics
     
     static double _barycenter_ratio_limit;
 
-    static bool _barycenters_set;
     
     KBody*  _parent{ nullptr };
 
+    /**
+      *  \brief  Context of the simulation moving the body (nullptr until the barycenters are set, see Context::barycenters() and Context::adopt())
+      */
+    Context* _context{ nullptr };
+
     std::unique_ptr<KeplerOrbit>  _orbit{ new KeplerOrbit()};
 
 
     /**
       *  \brief  Flag to indicate whether this body perturbates its parent
-      *          Set in the constructor and not changed afterwards
+      *          Set in the constructor (or in adopt()) and not changed afterwards
       */
     bool _parent_perturbator{ false };
 
@@ -138,22 +269,474 @@ namespace physics
     VelocityType _barycenter_vel;
 
 
+    /**
+      *  \brief  Slot of the orbit of this body in the batch
+      */
+    size_t _batch_slot{ 0 };
+
+    /**
+      *  \brief  Number of ticks between two moves of the body (multi-rate stepping)
+      */
+    size_t _step_ticks{ 1 };
+
+    /**
+      *  \brief  Passive body (not moved in the ticks)
+      */
+    bool _lazy{ false };
+
+    /**
+      *  \brief  Index of the passive body in the ephemerides (NO_EPHEMERIS if its state is calculated from the orbit)
+      */
+    size_t _ephemeris_index{ NO_EPHEMERIS };
+    static constexpr size_t NO_EPHEMERIS{ SIZE_MAX };
+
+
+    /**
+      *  \brief  Change of the state of the body between the current time and another time (see stateAt())
+      */
+    std::pair<geometry::Vec3<units::LENGTH_T>, geometry::Vec3<units::SPEED_T>> stateChange(double time) const;
+
     /**
       *  \brief  Calculates the new keplerian orbit position after interacting with the parent body for delta_t seconds
       *          DO NOT USE WITH THE ROOT BODY
       */
     void keplerMove(const units::TIME_T& delta_t);
 
+    /**
+      *  \brief  Applies the change in the position and velocity relative to the parent body, after the orbit has been propagated
+      *          DO NOT USE WITH THE ROOT BODY
+      */
+    void applyOrbitChange(const std::pair<geometry::Vec3<units::LENGTH_T>, geometry::Vec3<units::SPEED_T>>& change);
+
 
   private:
     static std::string uniqueName(BodyType type, int64_t id, const std::string& name, const std::string& provisional_name, const std::string& parent_name);
 
     static bool validateTypes(BodyType parent_type, BodyType child_type);
 
+    /**
+      *  \brief  Copies the propagated state from the batch into the orbit and applies the change to the body
+      */
+    void batchMove();
+
+    /**
+      *  \brief  New parent of a ship, if it has left the SOI of its parent or entered the SOI of a body orbiting its parent. nullptr otherwise
+      */
+    KBody* soiTransition() const;
+
+    /**
+      *  \brief  Moves a ship to a new parent (its grandparent or a body orbiting its parent) and recalculates its orbit relative to it
+      */
+    void reparent(tree::MTree<KBody>& bodies, KBody& new_parent);
+
     void commonConstructor();
 
   };
 
+
+  /**
+    *  \brief  Context of the movement of a tree of bodies (see KBody): the configuration read from body.cfg, the batch of orbits, the multi-rate 
+    *          stepping, the interactions and encounters, the ships, the passive bodies and the pool of threads. It is owned by the simulation 
+    *          (see Space) and bound to its tree when the barycenters are set (see barycenters() and adopt()), so every simulation in the process 
+    *          moves its own bodies. The bodies read it to calculate their state on demand (see KBody::state())
+    */
+  class KBody::Context
+  {
+  public:
+    /**
+      *  \brief  Constructor: reads the configuration of the movement from body.cfg (see KBody)
+      *  @throw  invalid_argument  If the integrator is not valid
+      */
+    Context();
+
+    /**
+      *  \brief  Copy Constructor: DELETED
+      */
+    Context(const Context&) = delete;
+
+    /**
+      *  \brief  Assignment operator: DELETED
+      */
+    Context& operator=(const Context&) = delete;
+
+    /**
+      *  \brief  Determine Barycenter displacement for all the parent bodies with their perturbator children bodies.
+      */
+    void barycenters(tree::MTree<KBody>& bodies);
+
+    /**
+      *  \brief  Moves all the bodies during delta_t seconds, propagating their Kepler orbits in batch (with the interaction kicks, if the integrator is WISDOM_HOLMAN or ENCKE)
+      *  @throw  runtime_error  If the barycenters have not been set yet (see barycenters())
+      */
+    void gravInteraction(tree::MTree<KBody>& bodies, const units::TIME_T& delta_t);
+
+    /**
+      *  \brief  Moves all the bodies directly to any time (since the start of the simulation), without calculating the intermediate states.
+      *          The state of every orbit is calculated from its epoch, so the cost does not depend on the elapsed time
+      *          The ships follow their current conics: the SOI transitions are only checked at the new time
+      *          With the ENCKE integrator the reference orbits are rectified before the jump. The states which are not bound to the root body 
+      *          (kept as deviations from the orbits) follow their conics
+      *  @throw  runtime_error  If the barycenters have not been set yet (see barycenters())
+      */
+    void jumpTo(tree::MTree<KBody>& bodies, const units::TIME_T& time);
+
+    /**
+      *  \brief  Places the bodies which were not due in the last ticks (see multi-rate stepping) at the current time, so the state of all the 
+      *          bodies is consistent to be read (see state()). The orbits are not changed: the states of their last move are restored when the 
+      *          bodies are moved again. It does nothing if all the bodies are already synchronized
+      */
+    void synchronize(tree::MTree<KBody>& bodies);
+
+    /**
+      *  \brief  Whether all the bodies were moved to the current time (see multi-rate stepping), so their state can be read without synchronizing them
+      */
+    bool synchronized() const { return _synchronized; }
+
+    /**
+      *  \brief  Copies the state of all the bodies into a checkpoint, as they were moved (the bodies which were not due in the last ticks keep the state 
+      *          of their last move), so the restored bodies continue exactly. The vector of the checkpoint keeps its capacity, so a reused checkpoint 
+      *          is filled without allocations
+      */
+    void checkpoint(tree::MTree<KBody>& bodies, Checkpoint& checkpoint);
+
+    /**
+      *  \brief  Restores the state of all the bodies from a checkpoint of the same tree. Moving the bodies again from the checkpoint with the same ticks 
+      *          reproduces the same states (the interaction lists are updated in the first tick). The ships are moved back to their parents in the checkpoint
+      *  @throw  invalid_argument  If the checkpoint does not match the tree
+      */
+    void restore(tree::MTree<KBody>& bodies, const Checkpoint& checkpoint);
+
+    /**
+      *  \brief  Sets up a tree of new bodies with a stored setup and state, instead of calculating the barycenters (e.g. when the bodies are loaded from a file 
+      *          saved in a previous execution). The bodies continue exactly as the bodies which were stored, except for the multi-rate steps, which are 
+      *          scheduled again from the restored orbits
+      *  @param  setups      Setup of every body, in the iteration order of the tree
+      *  @param  checkpoint  State of the bodies
+      *  @throw  runtime_error     If the barycenters have already been set
+      *  @throw  invalid_argument  If the setups or the checkpoint do not match the tree
+      */
+    void adopt(tree::MTree<KBody>& bodies, const std::vector<Setup>& setups, const Checkpoint& checkpoint);
+
+    /**
+      *  \brief  Time of the current state of the bodies (since the start of the simulation)
+      */
+    units::TIME_T time() const { return _time; }
+
+    Integrator integrator() const { return _integrator; }
+
+    /**
+      *  \brief  Whether several ticks can be propagated as a single step (see jumpTo()): only with the KEPLER integrator, which propagates the orbits 
+      *          from their epochs, and without ships (their SOI transitions are only checked at the end of every step)
+      */
+    bool canCoalesce() const { return _integrator == KEPLER && _ships.empty(); }
+
+    /**
+      *  \brief  Pool of threads of the movement (property THREADS). It can be used by the thread moving the bodies while they are not being moved
+      */
+    utils::ThreadPool& pool() { return *_pool; }
+
+    /**
+      *  \brief  States of a set of bodies at the current time (see state()), calculated in parallel. The vector of states keeps its capacity
+      */
+    void states(const std::vector<const KBody*>& bodies, std::vector<std::pair<PositionType, VelocityType>>& states);
+
+
+  private:
+    friend class KBody;
+
+    Integrator _integrator{ KEPLER };
+
+    bool _minor_bodies_interaction{ false };
+
+    /**
+      *  \brief  Whether the passive bodies are calculated on demand instead of being moved in every tick
+      */
+    bool _lazy_passive_bodies{ false };
+
+    /**
+      *  \brief  Selection of the perturbations evaluated in the kicks (WISDOM_HOLMAN, ENCKE): see updateInteractions()
+      */
+    double _perturbation_threshold{ 0 };
+    double _hill_radii{ 0 };
+    units::TIME_T _interaction_window{ 0 };
+
+    /**
+      *  \brief  Maximum deviation from the reference orbit, relative to the distance to the root body, before the orbit is rectified (ENCKE)
+      */
+    double _rectification_threshold{ 0 };
+
+    /**
+      *  \brief  Distance to a perturbator, in Hill radii of the perturbator, which starts a close encounter (0: no close encounters), and integrator 
+      *          of the encounters (WISDOM_HOLMAN, ENCKE)
+      */
+    double _encounter_hill_radii{ 0 };
+    DormandPrince _encounter_integrator;
+
+    /**
+      *  \brief  Multi-rate stepping: minimum number of steps per orbital period and maximum step (in ticks, power of 2)
+      */
+    double _steps_per_orbit{ 0 };
+    size_t _max_step_ticks{ 1 };
+
+    /**
+      *  \brief  Tick used to assign the steps of the bodies
+      */
+    units::TIME_T _schedule_tick{ 0 };
+
+    /**
+      *  \brief  Number of ticks since the steps were assigned or the bodies jumped to a new time
+      */
+    uint64_t _ticks{ 0 };
+
+    /**
+      *  \brief  Whether all the bodies have been moved to the current time
+      */
+    bool _synchronized{ true };
+
+    /**
+      *  \brief  Whether the lagging bodies have been placed at the current time to be read (see synchronize()), and the states of the root body, the 
+      *          batch bodies and the ships before they were placed
+      */
+    bool _placed{ false };
+    std::vector<std::pair<PositionType, VelocityType>> _saved_states;
+
+    bool _barycenters_set{ false };
+
+    /**
+      *  \brief  Time of the current state of the bodies (since the start of the simulation)
+      */
+    units::TIME_T _time{ 0 };
+
+    /**
+      *  \brief  Orbits of all the moving bodies, propagated together in every interaction
+      */
+    KeplerBatch _batch;
+
+    /**
+      *  \brief  Moving bodies in the same order as their slots in the batch: level 1 bodies first, then the level 2 bodies
+      */
+    std::vector<KBody*> _batch_bodies;
+
+    /**
+      *  \brief  Number of level 1 bodies in the batch (stored before the level 2 bodies)
+      */
+    size_t _batch_first_level{ 0 };
+
+    /**
+      *  \brief  Ranges [first, last) in the batch bodies of each family of level 2 bodies (children of the same level 1 body)
+      */
+    std::vector<std::pair<size_t, size_t>> _batch_families;
+
+    /**
+      *  \brief  Steps (in ticks) of the level 1 bodies in the batch and of the families of level 2 bodies, in the same order (ascending)
+      */
+    std::vector<size_t> _batch_steps;
+    std::vector<size_t> _family_steps;
+
+    /**
+      *  \brief  Indexes in the batch bodies of the first level perturbators, which cause the interaction kicks (WISDOM_HOLMAN, ENCKE)
+      */
+    std::vector<size_t> _batch_perturbators;
+
+    /**
+      *  \brief  Change of velocity of each first level body in the current kick (WISDOM_HOLMAN, ENCKE)
+      */
+    std::vector<geometry::Vec3<units::SPEED_T>> _kicks;
+
+    /**
+      *  \brief  Linear drift of the positions of the first level bodies in the current kick (WISDOM_HOLMAN, see kick())
+      */
+    geometry::Vec3<units::LENGTH_T> _linear_drift{ 0.0, 0.0, 0.0 };
+
+    /**
+      *  \brief  Deviation of each first level body from its reference orbit (ENCKE). With the WISDOM_HOLMAN integrator it is only used for the states 
+      *          which are not bound to the root body
+      */
+    std::vector<Deviation> _deviations;
+
+    /**
+      *  \brief  Perturbator of the close encounter of each first level body in the current tick and in the previous one (nullptr if it is not in 
+      *          a close encounter), and the state of the bodies in a close encounter at the start of the tick, relative to the root body
+      */
+    std::vector<const KBody*> _encounters;
+    std::vector<const KBody*> _last_encounters;
+    std::vector<DormandPrince::State> _encounter_states;
+
+    /**
+      *  \brief  Integration step of each first level body in a close encounter, proposed at the end of the previous tick (0 at the start of the 
+      *          encounter), and whether its integration has failed in the current tick
+      */
+    std::vector<double> _encounter_steps;
+    std::vector<uint8_t> _encounter_failures;
+
+    /**
+      *  \brief  Interaction list of each first level body: indexes in the batch bodies of the perturbators evaluated in its kicks (WISDOM_HOLMAN, ENCKE)
+      */
+    std::vector<std::vector<size_t>> _interactions;
+
+    /**
+      *  \brief  Time when the interaction lists were updated, and whether they are valid for the current batch
+      */
+    units::TIME_T _interactions_time{ 0 };
+    bool _interactions_set{ false };
+
+    /**
+      *  \brief  Indexes in the batch bodies of the first level minor bodies and dwarf planets (not perturbators), and their positions and masses, 
+      *          used to build the octree for their mutual interaction (WISDOM_HOLMAN, ENCKE)
+      */
+    std::vector<size_t> _batch_minor_bodies;
+    std::vector<geometry::Vec3<units::LENGTH_T>> _minor_positions;
+    std::vector<units::REDUCED_MASS_T> _minor_masses;
+
+    /**
+      *  \brief  Octree used to approximate the mutual interaction of the minor bodies
+      */
+    Octree _octree;
+
+    /**
+      *  \brief  Ships (propagated as patched conics, outside the batch) and the new parent of each ship in the current tick (nullptr if it does not change)
+      */
+    std::vector<KBody*> _ships;
+    std::vector<KBody*> _ship_transitions;
+
+    /**
+      *  \brief  Bodies whose sphere of influence can capture a ship, by parent: planets, dwarf planets, satellites and secondary stars
+      *          (the spheres of influence of the minor bodies are negligible)
+      */
+    std::unordered_map<const KBody*, std::vector<KBody*>> _soi_bodies;
+
+    /**
+      *  \brief  Passive bodies, calculated on demand (see state())
+      */
+    std::vector<KBody*> _lazy_bodies;
+
+    /**
+      *  \brief  Ephemerides of the passive bodies (nullptr if disabled or there are no passive bodies to interpolate), indexed by _ephemeris_index
+      */
+    std::unique_ptr<EphemerisCache> _ephemeris{ nullptr };
+    units::TIME_T _ephemeris_segment_length{ 0 };
+    size_t _ephemeris_degree{ 0 };
+    size_t _ephemeris_memory{ 0 };
+
+    /**
+      *  \brief  Segment of the current time when the following segments were prefetched
+      */
+    int64_t _ephemeris_segment{ 0 };
+
+    /**
+      *  \brief  Minimum number of segments per orbital period of an interpolated passive body
+      */
+    static constexpr double EPHEMERIS_SEGMENTS_PER_ORBIT{ 8.0 };
+
+    /**
+      *  \brief  Pool of threads used to move the bodies
+      */
+    std::unique_ptr<utils::ThreadPool> _pool{ nullptr };
+
+    /**
+      *  \brief  Adds the orbits of the level 1 and level 2 bodies to the batch, sorted by step (the bodies due in a tick are always the first ones)
+      */
+    void bindBatch(tree::MTree<KBody>& bodies);
+
+    /**
+      *  \brief  Step (in ticks) of an orbit: the greatest power of 2, up to MAX_STEP_TICKS, which keeps at least STEPS_PER_ORBIT steps per period. 
+      *          1 for unbound orbits
+      */
+    size_t scheduleStep(const KeplerOrbit& orbit);
+
+    /**
+      *  \brief  Moves the first level_1_due level 1 bodies and the first families_due families of level 2 bodies to a time 
+      *          (since the start of the simulation). The rest of the bodies keep their state. 
+      *          With the WISDOM_HOLMAN and ENCKE integrators the first level bodies must be placed afterwards (see placeFirstLevel())
+      */
+    void move(tree::MTree<KBody>& bodies, const units::TIME_T& time, size_t level_1_due, size_t families_due);
+
+    /**
+      *  \brief  Saves the state of the bodies and places the lagging ones at the current time, from the states of their orbits at that time 
+      *          (see KeplerOrbit::stateAt()), without changing the orbits or the batch
+      */
+    void placeLagging(tree::MTree<KBody>& bodies);
+
+    /**
+      *  \brief  Restores the state of the bodies saved before they were placed (see placeLagging()), if they have been placed
+      */
+    void unplaceLagging(tree::MTree<KBody>& bodies);
+
+    /**
+      *  \brief  Number of bodies moved by each parallel task
+      */
+    static constexpr size_t PARALLEL_CHUNK{ 256 };
+
+    /**
+      *  \brief  Executes func(first, last) in parallel for chunks of the range [first, last), using the pool of threads
+      */
+    template <typename FUNC>
+    void parallelFor(size_t first, size_t last, FUNC&& func, size_t chunk = PARALLEL_CHUNK) { _pool->parallelFor(first, last, chunk, std::forward<FUNC>(func)); }
+
+    /**
+      *  \brief  Interaction kick of the first level bodies during delta_t seconds: the barycentric velocities are changed by the accelerations caused by 
+      *          the first level perturbators, the positions are drifted by the momentum of the root body (before the kick in the first half of the tick, 
+      *          after it in the second half) and the orbits are recalculated (WISDOM_HOLMAN). With the ENCKE integrator only the deviations from the 
+      *          reference orbits are changed, adding the indirect term and Encke's term
+      */
+    void kick(double delta_t, bool first_half);
+
+    /**
+      *  \brief  Applies the kick and the linear drift (or any other displacement) to a first level body (see kick())
+      */
+    void kickBody(size_t index, const geometry::Vec3<units::SPEED_T>& kick, const geometry::Vec3<units::LENGTH_T>& linear_drift, double delta_t);
+
+    /**
+      *  \brief  Velocity of the linear drift of the positions relative to the root body: sum(m(j) * v(j)) / m(root), for the barycentric velocities 
+      *          of the first level perturbators (WISDOM_HOLMAN), optionally with the current kicks
+      */
+    geometry::Vec3<units::SPEED_T> driftVelocity(bool kicked);
+
+    /**
+      *  \brief  Drift of the deviations from the reference orbits during delta_t seconds (ENCKE)
+      */
+    void drift(double delta_t);
+
+    /**
+      *  \brief  Rectifies the reference orbits whose deviation is beyond the threshold, or all of them, and resets their deviations (ENCKE). 
+      *          The deviations of the states which are not bound to the root body are kept
+      */
+    void rectify(bool all);
+
+    /**
+      *  \brief  Detects the first level bodies in a close encounter at the start of the tick, and stores their state
+      */
+    void detectEncounters();
+
+    /**
+      *  \brief  Integrates the state of the bodies in a close encounter during the last delta_t seconds and rectifies their orbits. 
+      *          If the state is not bound to the root body, it is kept as the deviation from the orbit. If the integration fails (too many steps), 
+      *          the body is kicked as the rest of the bodies
+      */
+    void integrateEncounters(double delta_t);
+
+    /**
+      *  \brief  Sets the state of the root body and the first level bodies from the orbits (and deviations) of the first level bodies, keeping the barycenter 
+      *          at the origin of the inertial CS. The second level bodies follow their parents (WISDOM_HOLMAN, ENCKE). 
+      *          With the WISDOM_HOLMAN integrator the velocities of the orbits are barycentric
+      */
+    void placeFirstLevel();
+
+    /**
+      *  \brief  Updates the interaction lists of the first level bodies (WISDOM_HOLMAN, ENCKE). A perturbator is added to the list of a body if, during the 
+      *          interaction window, the body can get closer to it than HILL_RADII Hill radii, or the perturbation can be greater than 
+      *          PERTURBATION_THRESHOLD * the acceleration caused by the root body. The closest distance is estimated with the current relative velocity
+      */
+    void updateInteractions();
+
+    /**
+      *  \brief  Moves the ships to the current time along their conics, moves the ships changing their sphere of influence to their new parents 
+      *          and places all of them relative to their parents
+      */
+    void moveShips(tree::MTree<KBody>& bodies);
+
+  }; // END class KBody::Context
+
 }
 
 
@@ -0,0 +1,161 @@
+#ifndef KEPLER_BATCH_H
+#define KEPLER_BATCH_H
+
+#include <vector>
+
+#include <physics/units.h>
+#include <physics/kepler_orbit.h>
+
+
+namespace physics
+{
+  /**
+    *  \brief  Batched propagation engine for a population of Kepler orbits.
+    *          The orbital elements, the perifocal basis (P, Q) and the anomalies of every orbit are stored in contiguous arrays
+    *          (structure of arrays), so the whole population can be advanced in tight loops without pointer chasing or rebuilding
+    *          rotation matrices.
+    *          Propagation is done in 2 stages:
+    *               1. Per orbit: mean anomaly at the new time (from the mean anomaly at the epoch), eccentric anomaly and state in the orbital plane (perifocal CS)
+    *               2. Rotation of the perifocal state to the primary CS: r = x * P + y * Q, v = vx * P + vy * Q, in a plain loop over the 
+    *                  arrays which the compiler can vectorize
+    *          Each orbit is identified by its slot (index in the arrays), returned when it is added.
+    *          The propagated state can be copied back to the KeplerOrbit object: see store()
+    *
+    *          (Angles are measured in radians, lengths are measured in meters and times in seconds)
+    */
+  class KeplerBatch
+  {
+  public:
+    /**
+      *  \brief  Default Constructor: empty batch
+      */
+    KeplerBatch() {}
+
+    /**
+      *  \brief  Copy Constructor: DELETED
+      */
+    KeplerBatch(const KeplerBatch&) = delete;
+
+    /**
+      *  \brief  Assignment operator: DELETED
+      */
+    KeplerBatch& operator=(const KeplerBatch&) = delete;
+
+    /**
+      *  \brief  Adds an orbit to the batch
+      *  @param  orbit  The orbit which elements and current anomaly are copied into the batch
+      *  @return  The slot assigned to the orbit
+      */
+    size_t add(const KeplerOrbit& orbit);
+
+    /**
+      *  \brief  Reloads the elements and current anomaly of an orbit in an existing slot (e.g. after the orbit has been recalculated)
+      *  @param  slot   The slot of the orbit
+      *  @param  orbit  The orbit which elements are copied into the batch
+      *  @throw  out_of_range  If the slot does not exist
+      */
+    void load(size_t slot, const KeplerOrbit& orbit);
+
+    /**
+      *  \brief  Removes all the orbits from the batch
+      */
+    void clear();
+
+    /**
+      *  \brief  Number of orbits in the batch
+      */
+    size_t size() const { return _e.size(); }
+
+    /**
+      *  \brief  Propagates all the orbits in the batch to a new time
+      *  @param  time  The new time (since the start of the simulation)
+      */
+    void moveTo(units::TIME_T time) { moveTo(0, size(), time); _time = time; }
+
+    /**
+      *  \brief  Propagates the orbits in the slots [first, last) to a new time. Ranges can be propagated in parallel.
+      *          All the orbits in the batch should be moved to the same time and the time of the batch updated (see time()) before storing them
+      *  @param  first  First slot to be propagated
+      *  @param  last   Slot after the last one to be propagated
+      *  @param  time   The new time (since the start of the simulation)
+      */
+    void moveTo(size_t first, size_t last, units::TIME_T time);
+
+    /**
+      *  \brief  Time of the current state of the orbits in the batch
+      */
+    units::TIME_T time() const { return _time; }
+
+    /**
+      *  \brief  Sets the time of the current state, after propagating all the orbits in ranges
+      */
+    void time(units::TIME_T time) { _time = time; }
+
+    /**
+      *  \brief  Copies the propagated anomalies, position and velocity of a slot into the orbit
+      *  @param  slot   The slot of the orbit
+      *  @param  orbit  The orbit to be updated (it should be the same one added or loaded in the slot)
+      */
+    void store(size_t slot, KeplerOrbit& orbit) const;
+
+    /**
+      *  \brief  Position relative to the primary body of the orbit in a slot
+      */
+    geometry::Vec3<units::LENGTH_T> position(size_t slot) const { return { _rx[slot], _ry[slot], _rz[slot] }; }
+
+    /**
+      *  \brief  Velocity relative to the primary body of the orbit in a slot
+      */
+    geometry::Vec3<units::SPEED_T> velocity(size_t slot) const { return { _vx[slot], _vy[slot], _vz[slot] }; }
+
+
+  protected:
+    /**
+      *  \brief  Orbital elements and reused constants: semimajor axis, semiminor axis, eccentricity and mean motion (2*PI / period)
+      */
+    std::vector<units::LENGTH_T>  _a, _b, _e;
+    std::vector<double>           _mean_motion;
+
+    /**
+      *  \brief  Epoch (in seconds since the start of the simulation) and mean anomaly at the epoch
+      */
+    std::vector<double>           _epoch;
+    std::vector<units::ANGLE_T>   _mean_anomaly_epoch;
+
+    /**
+      *  \brief  Perifocal basis in the primary CS: P points to the periapsis, Q is P rotated 90 degrees in the direction of the movement
+      */
+    std::vector<double>           _px, _py, _pz, _qx, _qy, _qz;
+
+    /**
+      *  \brief  Current mean and eccentric anomalies
+      */
+    std::vector<units::ANGLE_T>   _mean_anomaly, _ecc_anomaly;
+
+    /**
+      *  \brief  Current state in the perifocal CS (intermediate result of the 1st propagation stage)
+      */
+    std::vector<double>           _x, _y, _vxp, _vyp;
+
+    /**
+      *  \brief  Current position and velocity relative to the primary body
+      */
+    std::vector<double>           _rx, _ry, _rz, _vx, _vy, _vz;
+
+    /**
+      *  \brief  Time of the current state
+      */
+    units::TIME_T                 _time{ 0 };
+
+
+  private:
+    /**
+      *  \brief  Stage 2 of the propagation: rotation of the perifocal state to the primary CS for the slots [first, last)
+      */
+    void rotate(size_t first, size_t last);
+
+  }; // END class KeplerBatch
+}
+
+
+#endif // KEPLER_BATCH_H
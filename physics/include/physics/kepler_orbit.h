@@ -32,12 +32,20 @@ namespace physics
     *
     *          As well as the position and velocity relative to the parent body
     *
+    *          The elements are defined at an epoch (time since the start of the simulation). The state at any other time is calculated directly 
+    *          from the mean anomaly at the epoch, M = M(epoch) + n * (time - epoch), so moving to any time costs the same and no errors are accumulated
+    *
+    *          The orbits of the ships can also be hyperbolic (e > 1, a < 0, see conic()). Then the eccentric anomaly is the hyperbolic anomaly H, 
+    *          the mean anomaly is M = e*sinh(H) - H and the mean motion is sqrt(mu / -a^3)
+    *
     *          It is also possible to get the representation of the full orbit as a set of points (contained in a vector)
     *
     *          (Angles are measured in radians, lengths are measured in meters and times in seconds)
     */
   class KeplerOrbit
   {
+    friend class KeplerBatch;
+
   public:
     /**
       *  \brief  Customized exception for a Body Collision between the primary and the secondary
@@ -58,6 +66,19 @@ namespace physics
       ExcBodyNotBound(std::string txt) : runtime_error(txt) {}
     };
 
+    /**
+      *  \brief  Compact copy of the elements and the current state of an orbit (see checkpoint() and restore())
+      */
+    struct Checkpoint
+    {
+      units::LENGTH_T      a, e;
+      units::ANGLE_T       i, asc_node, periapsis;
+      units::ANGLE_T       anomaly, ecc_anomaly, mean_anomaly, mean_anomaly_epoch;
+      units::TIME_T        epoch, time, time_periapsis;
+      PBody::PositionType  position;
+      PBody::VelocityType  velocity;
+    };
+
     /**
       *  \brief  Default Constructor (to be used for bodies with non keplerian orbits, like the Sun)
       *          It keeps the default value for all elements, and sets _mu to 1 to avoid 0/0 divisions when invoking the method to get the period
@@ -71,11 +92,63 @@ namespace physics
       *
       *  @param  prim_body      The main (primary) body
       *  @param  sec_body       The secondary body, for which the orbit is calculated.
+      *  @param  epoch          Time of the state of the bodies, which becomes the epoch of the orbital elements
       *
       *  @throw  BodyNotBound      If body and its parents are not gravitationally bound
       *  @throw  BodyCollision     If body and its parents are colliding
       */
-    KeplerOrbit(const PBody& prim_body, const PBody& sec_body);
+    KeplerOrbit(const PBody& prim_body, const PBody& sec_body, units::TIME_T epoch = units::TIME_T(0));
+
+    /**
+      *  \brief  Recalculates the orbit in place (osculating orbit) for the current state of the primary and secondary bodies.
+      *          No memory is allocated, so it can be used in every simulation tick
+      *
+      *  @param  prim_body      The main (primary) body
+      *  @param  sec_body       The secondary body, for which the orbit is calculated.
+      *  @param  epoch          Time of the state of the bodies, which becomes the epoch of the orbital elements
+      *
+      *  @throw  BodyNotBound      If body and its parents are not gravitationally bound
+      *  @throw  BodyCollision     If body and its parents are colliding
+      */
+    void osculate(const PBody& prim_body, const PBody& sec_body, units::TIME_T epoch);
+
+    /**
+      *  \brief  Recalculates the orbit in place for a state relative to the primary body, without checking that the bodies are bound: 
+      *          the orbit can be elliptic or hyperbolic (e.g. a ship escaping from a planet)
+      *
+      *  @param  mu             Reduced mass of the primary and secondary bodies (Gm1 + Gm2)
+      *  @param  rel_position   Position relative to the primary body
+      *  @param  rel_velocity   Velocity relative to the primary body
+      *  @param  epoch          Time of the state, which becomes the epoch of the orbital elements
+      */
+    void conic(units::REDUCED_MASS_T mu, const geometry::Vec3<units::LENGTH_T>& rel_position, const geometry::Vec3<units::SPEED_T>& rel_velocity, units::TIME_T epoch);
+
+    /**
+      *  \brief  Rectifies the orbit at the current time: the deviation of the true state from the state of the orbit is added and the orbit is 
+      *          recalculated in place (Encke's method). The current time becomes the new epoch of the elements
+      *
+      *  @param  delta_position  Deviation of the position relative to the primary body
+      *  @param  delta_velocity  Deviation of the velocity relative to the primary body
+      *
+      *  @throw  BodyNotBound      If the rectified orbit is not bound
+      */
+    void rectify(const geometry::Vec3<units::LENGTH_T>& delta_position, const geometry::Vec3<units::SPEED_T>& delta_velocity);
+
+    /**
+      *  \brief  Copy of the elements and the current state of the orbit
+      */
+    Checkpoint checkpoint() const;
+
+    /**
+      *  \brief  Restores the elements and the state of the orbit from a checkpoint (the perifocal basis is recalculated). No memory is allocated
+      */
+    void restore(const Checkpoint& checkpoint);
+
+    /**
+      *  \brief  Restores the orbit from a checkpoint taken around another primary body (e.g. a ship moved back to its previous parent)
+      *  @param  mu  Reduced mass of the primary and secondary bodies (Gm1 + Gm2) when the checkpoint was taken
+      */
+    void restore(const Checkpoint& checkpoint, units::REDUCED_MASS_T mu) { _mu = mu; restore(checkpoint); }
 
     /**
       *  \brief  Copy Constructor: DELETED
@@ -103,10 +176,74 @@ namespace physics
       *  @param  delta_time The elapsed time
       *
       *  @return  State change: delta of the position and velocity relative to the primary body
+      */
+    std::pair<geometry::Vec3<units::LENGTH_T>, geometry::Vec3<units::SPEED_T>> forward(units::TIME_T delta_time) { return moveTo(_time + delta_time); }
+
+    /**
+      *  \brief  Recalculates the position of the secondary relative to the primary at any time (before or after the current time)
+      *
+      *  @param  time  The new time (since the start of the simulation)
+      *
+      *  @return  State change: delta of the position and velocity relative to the primary body
+      */
+    std::pair<geometry::Vec3<units::LENGTH_T>, geometry::Vec3<units::SPEED_T>> moveTo(units::TIME_T time);
+
+    /**
+      *  \brief  Calculates the position and velocity relative to the primary at any time, without changing the current state
+      *
+      *  @param  time  The time (since the start of the simulation)
       *
-      *  @throw  runtime_error In case the anomaly cannot be calculated with enough precision
+      *  @return  Position and velocity relative to the primary body
       */
-    std::pair<geometry::Vec3<units::LENGTH_T>, geometry::Vec3<units::SPEED_T>> forward(units::TIME_T delta_time);
+    std::pair<PBody::PositionType, PBody::VelocityType> stateAt(units::TIME_T time) const { return stateAt(double(time.count())); }
+
+    /**
+      *  \brief  Calculates the position and velocity relative to the primary at any time, including fractions of a second, without changing the current state
+      *
+      *  @param  time  The time in seconds (since the start of the simulation)
+      *
+      *  @return  Position and velocity relative to the primary body
+      */
+    std::pair<PBody::PositionType, PBody::VelocityType> stateAt(double time) const;
+
+    /**
+      *  \brief  Solves Kepler's equation, M = E - e*sin(E), for elliptic orbits (e < 1)
+      *          Danby's starter and Halley iterations, safeguarded with bisection, up to a fixed tolerance. 
+      *          The number of iterations is bounded, so the cost does not depend on the elapsed time since the last calculation
+      *
+      *  @param  mean_anomaly  The mean anomaly (any value)
+      *  @param  e             The eccentricity
+      *
+      *  @return  The eccentric anomaly, in the same revolution as the mean anomaly
+      */
+    static units::ANGLE_T solveKepler(units::ANGLE_T mean_anomaly, units::LENGTH_T e);
+
+    /**
+      *  \brief  Solves Kepler's equation as solveKepler(), up to a given tolerance (e.g. for positions calculated in single precision), 
+      *          and provides the sine and cosine of the eccentric anomaly (without calculating them again)
+      */
+    static units::ANGLE_T solveKepler(units::ANGLE_T mean_anomaly, units::LENGTH_T e, units::ANGLE_T tolerance, double& sin_E, double& cos_E);
+
+    /**
+      *  \brief  Solves the hyperbolic Kepler's equation, M = e*sinh(H) - H, for hyperbolic orbits (e > 1)
+      *          Halley iterations from a logarithmic starter, up to a fixed tolerance
+      *
+      *  @param  mean_anomaly  The mean anomaly (any value)
+      *  @param  e             The eccentricity
+      *
+      *  @return  The hyperbolic anomaly
+      */
+    static units::ANGLE_T solveKeplerHyperbolic(units::ANGLE_T mean_anomaly, units::LENGTH_T e);
+
+    /**
+      *  \brief  Calculates the perifocal basis from the orientation elements: unit vectors pointing to the periapsis (P) and 90 degrees ahead 
+      *          of it in the orbital plane (Q)
+      *
+      *  @param  i, asc_node, periapsis  Inclination, longitude of the ascending node and argument of the periapsis
+      *  @param  p, q                    The perifocal basis
+      */
+    static void perifocalBasis(units::ANGLE_T i, units::ANGLE_T asc_node, units::ANGLE_T periapsis, 
+                               geometry::Vec3<units::LENGTH_T>& p, geometry::Vec3<units::LENGTH_T>& q);
 
     /**
       *  \brief  Getters for the Keplerian elements
@@ -123,6 +260,8 @@ namespace physics
     GET2(eccAnomaly, ecc_anomaly)
     GET2(meanAnomaly, mean_anomaly)
     GET2(timePeriapsis, time_periapsis)
+    GET(epoch)
+    GET(time)
     GET(position)
     GET(velocity)
 #undef GET
@@ -132,6 +271,22 @@ namespace physics
       *  \brief  Get orbital period
       */
     units::TIME_T period() const { return units::TIME_T(units::TIME_T::rep(TWO_PI * sqrt(_a * _a * _a / _mu))); }
+
+    /**
+      *  \brief  Get mean motion (2*PI / period), in radians per second
+      */
+    double meanMotion() const { return sqrt(_mu / std::abs(_a * _a * _a)); }
+
+    /**
+      *  \brief  Whether the orbit is elliptic (e < 1)
+      */
+    bool bound() const { return _e < 1; }
+
+    /**
+      *  \brief  Get the perifocal basis: unit vectors pointing to the periapsis (P) and 90 degrees ahead of it in the orbital plane (Q)
+      */
+    const geometry::Vec3<units::LENGTH_T>& perifocalP() const { return _perifocal_p; }
+    const geometry::Vec3<units::LENGTH_T>& perifocalQ() const { return _perifocal_q; }
     
     /**
       *  \brief  Set orbit vertices in the provided ellipse
@@ -187,6 +342,21 @@ namespace physics
       */
     units::TIME_T          _time_periapsis{ 0 };
 
+    /**
+      *  \brief  Time (since the start of the simulation) at which the elements are defined
+      */
+    units::TIME_T          _epoch{ 0 };
+
+    /**
+      *  \brief  Mean anomaly at the epoch
+      */
+    units::ANGLE_T         _mean_anomaly_epoch{ 0.0 };
+
+    /**
+      *  \brief  Time (since the start of the simulation) of the current position and velocity
+      */
+    units::TIME_T          _time{ 0 };
+
     /**
       *  \brief  Reused constant parameter: reduced mass of the primary and secondary bodies (Gm1 + Gm2)
       */
@@ -202,13 +372,35 @@ namespace physics
       */
     PBody::VelocityType    _velocity{ 0.0, 0.0, 0.0 };
 
+    /**
+      *  Perifocal basis in the CS of the primary body: unit vector pointing to the periapsis (P) and unit vector in the orbital plane, 
+      *  90 degrees from P in the direction of the movement (Q). Calculated once from the elements i, asc_node and periapsis
+      */
+    geometry::Vec3<units::LENGTH_T> _perifocal_p{ 1.0, 0.0, 0.0 };
+    geometry::Vec3<units::LENGTH_T> _perifocal_q{ 0.0, 1.0, 0.0 };
+
 
   private:
+    /**
+      *  \brief  Calculates the elements from the position and velocity relative to the primary body (_mu must be already set)
+      */
+    void elements(const geometry::Vec3<units::LENGTH_T>& v_rel_position, const geometry::Vec3<units::SPEED_T>& v_rel_velocity);
+
     /**
       *  \brief  Recalculates the other anomalies and time after periapsis
       */
     void extParams();
 
+    /**
+      *  \brief  Mean anomaly at any time, in [0, 2*PI) (not reduced for hyperbolic orbits)
+      */
+    units::ANGLE_T meanAnomalyAt(double time) const;
+
+    /**
+      *  \brief  Calculates the perifocal basis (P, Q) from the orientation elements (i, asc_node, periapsis)
+      */
+    void perifocalBasis();
+
     /**
       *  \brief  Transforms keplerian orbit elements to the cartesian elements relative to the primary CS
       */
@@ -0,0 +1,115 @@
+#ifndef LAMBERT_SOLVER_H
+#define LAMBERT_SOLVER_H
+
+#include <vector>
+
+#include <misc/thread_pool.h>
+
+#include <physics/units.h>
+#include <geometry/basic_types.h>
+
+
+namespace physics
+{
+  /**
+    *  \brief  Solver of Lambert's problem: the Kepler orbits connecting 2 positions relative to a primary body in a given time of flight.
+    *          It uses Izzo's algorithm: the problem is reduced to the non-dimensional time of flight T(x) of a single parameter x,
+    *          which is solved with Householder iterations (third order) from an initial guess close to the solution.
+    *          With a long time of flight there are also 2 solutions for every complete revolution around the primary body (up to the maximum
+    *          number of revolutions for which the time of flight is long enough): one with a lower and one with a higher energy.
+    *          The batches of problems are solved in parallel by a pool of threads. Solving a single problem does not use the pool,
+    *          so it can be called from several threads.
+    *
+    *          (Lengths are measured in meters, speeds in meters per second, times in seconds and masses as reduced masses, G*M)
+    */
+  class LambertSolver
+  {
+  public:
+    /**
+      *  \brief  Lambert's problem
+      */
+    struct Problem
+    {
+      geometry::Vec3<units::LENGTH_T>  r1;         /**< Initial position relative to the primary body */
+      geometry::Vec3<units::LENGTH_T>  r2;         /**< Final position relative to the primary body */
+      double                           tof;        /**< Time of flight (in seconds) */
+      units::REDUCED_MASS_T            mu;         /**< Reduced mass of the primary body */
+      bool                             prograde;   /**< The transfer is counterclockwise around the Z axis */
+    };
+
+    /**
+      *  \brief  Solution of a Lambert's problem: velocities at the initial and final positions
+      */
+    struct Solution
+    {
+      geometry::Vec3<units::SPEED_T>  v1;
+      geometry::Vec3<units::SPEED_T>  v2;
+      uint32_t                        revolutions;  /**< Number of complete revolutions */
+      bool                            valid;        /**< False if the solution does not exist (not enough time for the revolutions, or degenerate problem) */
+    };
+
+    /**
+      *  \brief  Constructor
+      *  @param  num_threads  Number of threads solving the batches, including the calling thread. 0: number of hardware threads
+      */
+    LambertSolver(size_t num_threads = 0) : _pool{ num_threads } {}
+
+    /**
+      *  \brief  Number of solutions of a problem (valid or not) up to a number of revolutions: 1 + 2 * max_revolutions
+      */
+    static size_t solutionsPerProblem(size_t max_revolutions) { return 1 + 2 * max_revolutions; }
+
+    /**
+      *  \brief  Solves a problem (single thread)
+      *  @param  problem          The problem
+      *  @param  max_revolutions  Maximum number of complete revolutions
+      *  @param  solutions        Array of solutionsPerProblem(max_revolutions) solutions: the direct transfer, and the 2 solutions with 1, 2, ... revolutions
+      *  @return  Number of valid solutions
+      *  @throw  invalid_argument  If the time of flight or the reduced mass are not positive, or a position is 0
+      */
+    static size_t solve(const Problem& problem, size_t max_revolutions, Solution* solutions);
+
+    /**
+      *  \brief  Solves a batch of problems in parallel
+      *  @param  problems         The problems
+      *  @param  max_revolutions  Maximum number of complete revolutions
+      *  @param  solutions        Resized and filled with solutionsPerProblem(max_revolutions) consecutive solutions for every problem
+      *  @throw  invalid_argument  If a problem is not valid (see solve())
+      */
+    void solve(const std::vector<Problem>& problems, size_t max_revolutions, std::vector<Solution>& solutions);
+
+
+  private:
+    /**
+      *  \brief  Maximum number of iterations of the solvers
+      */
+    static constexpr size_t MAX_ITERATIONS{ 15 };
+
+    /**
+      *  \brief  Number of problems per task of the pool
+      */
+    static constexpr size_t CHUNK{ 256 };
+
+    utils::ThreadPool _pool;
+
+    /**
+      *  \brief  Non-dimensional time of flight T(x) for N revolutions, with the Lancaster-Blanchard expressions. Close to the parabola (x = 1) Battin's
+      *          series or Lagrange's expression are used instead, to avoid the loss of precision
+      */
+    static double timeOfFlight(double x, double lambda, size_t N);
+
+    /**
+      *  \brief  First, second and third derivatives of T(x)
+      */
+    static void derivatives(double x, double T, double lambda, double& dT, double& ddT, double& dddT);
+
+    /**
+      *  \brief  Householder iterations solving T(x) = T, starting at x. Returns the solution
+      */
+    static double householder(double T, double x, double lambda, size_t N, double tolerance);
+
+  }; // END class LambertSolver
+}
+
+
+#endif // LAMBERT_SOLVER_H
@@ -0,0 +1,128 @@
+#ifndef MOID_SCREENER_H
+#define MOID_SCREENER_H
+
+#include <vector>
+#include <mutex>
+
+#include <misc/thread_pool.h>
+
+#include <physics/units.h>
+#include <physics/kepler_orbit.h>
+#include <geometry/basic_types.h>
+
+
+namespace physics
+{
+  /**
+    *  \brief  Screening of close approaches between a catalog of bodies (e.g. the minor bodies) and a set of target bodies (e.g. the planets),
+    *          based on the minimum orbit intersection distance (MOID): the minimum distance between any point of 2 orbits, whatever the positions 
+    *          of the bodies. Two bodies can only be closer than their MOID, so only the pairs with a MOID below a threshold are flagged as 
+    *          candidates for a detailed check in the time domain.
+    *          The MOID is calculated from the Keplerian elements:
+    *             - pairs whose perihelion and aphelion distances do not overlap (with the threshold) are discarded without calculation
+    *             - the squared distance is evaluated in a grid of eccentric anomalies of both orbits
+    *             - every local minimum of the grid is refined with Newton iterations on the 2 eccentric anomalies. The MOID is the smallest one
+    *          The catalog is screened in parallel by a pool of threads.
+    *          The orbits of each pair must be relative to the same primary body, and they must be elliptic (bound).
+    *
+    *          (Lengths are measured in meters)
+    */
+  class MoidScreener
+  {
+  public:
+    /**
+      *  \brief  Candidate pair: indexes in the vectors of bodies and targets, and MOID of their orbits
+      */
+    struct Candidate
+    {
+      size_t           body;
+      size_t           target;
+      units::LENGTH_T  moid;
+    };
+
+    /**
+      *  \brief  Constructor
+      *  @param  num_threads  Number of threads screening the catalog, including the calling thread. 0: number of hardware threads
+      *  @param  grid_size    Number of eccentric anomalies of each orbit in the grid
+      *  @throw  invalid_argument  If the grid size is less than 4
+      */
+    MoidScreener(size_t num_threads = 0, size_t grid_size = 32);
+
+    /**
+      *  \brief  MOID of 2 orbits around the same primary body
+      */
+    units::LENGTH_T moid(const KeplerOrbit& orbit_1, const KeplerOrbit& orbit_2) const;
+
+    /**
+      *  \brief  Screens all the pairs (body, target)
+      *  @param  bodies      Orbits of the bodies of the catalog
+      *  @param  targets     Orbits of the target bodies
+      *  @param  threshold   Maximum MOID of the candidates
+      *  @param  candidates  Cleared and filled with the candidate pairs, sorted by body and target
+      */
+    void screen(const std::vector<const KeplerOrbit*>& bodies, const std::vector<const KeplerOrbit*>& targets, units::LENGTH_T threshold, 
+                std::vector<Candidate>& candidates);
+
+    /**
+      *  \brief  Number of pairs whose MOID was calculated in the last screening (those not discarded by the perihelion and aphelion distances)
+      */
+    size_t calculated() const { return _calculated; }
+
+
+  private:
+    /**
+      *  \brief  Maximum number of Newton iterations refining a minimum of the grid
+      */
+    static constexpr size_t NEWTON_ITERATIONS{ 20 };
+
+    /**
+      *  \brief  Number of bodies per task of the pool
+      */
+    static constexpr size_t CHUNK{ 64 };
+
+    /**
+      *  \brief  Orbit as a function of the eccentric anomaly: r(E) = a * (cos(E) - e) * P + b * sin(E) * Q
+      */
+    struct Ellipse
+    {
+      geometry::Vec3<units::LENGTH_T> p;    /**< a * P */
+      geometry::Vec3<units::LENGTH_T> q;    /**< b * Q */
+      geometry::Vec3<units::LENGTH_T> c;    /**< Center of the ellipse: -a * e * P */
+      units::LENGTH_T perihelion;
+      units::LENGTH_T aphelion;
+      units::LENGTH_T a;
+
+      Ellipse(const KeplerOrbit& orbit);
+
+      geometry::Vec3<units::LENGTH_T> point(double cos_E, double sin_E) const { return c + cos_E * p + sin_E * q; }
+    };
+
+    utils::ThreadPool _pool;
+    const size_t      _grid_size;
+
+    /**
+      *  \brief  Cosines and sines of the eccentric anomalies of the grid
+      */
+    std::vector<double> _cos, _sin;
+
+    std::mutex  _mutex;
+    size_t      _calculated{ 0 };
+
+    /**
+      *  \brief  MOID of 2 ellipses. The buffers are used for the points of the orbits and the grid of squared distances
+      *          Only the minima of the grid which can be below the threshold are refined: if the MOID is above the threshold, the result 
+      *          is only an upper bound of it
+      */
+    units::LENGTH_T moid(const Ellipse& ellipse_1, const Ellipse& ellipse_2, units::LENGTH_T threshold, std::vector<geometry::Vec3<units::LENGTH_T>>& points, 
+                         std::vector<double>& grid) const;
+
+    /**
+      *  \brief  Refines a minimum of the squared distance, starting at the eccentric anomalies (E1, E2). Returns the squared distance
+      */
+    double refine(const Ellipse& ellipse_1, const Ellipse& ellipse_2, double E1, double E2, double squared_distance) const;
+
+  }; // END class MoidScreener
+}
+
+
+#endif // MOID_SCREENER_H
@@ -0,0 +1,113 @@
+#ifndef OCTREE_H
+#define OCTREE_H
+
+#include <vector>
+#include <algorithm>
+
+#include <physics/units.h>
+#include <geometry/basic_types.h>
+
+
+namespace physics
+{
+  /**
+    *  \brief  Barnes-Hut octree, used to approximate the gravitational accelerations caused by a large population of bodies in O(N log N).
+    *          The space containing all the bodies is divided recursively in 8 cubes (nodes) until every node contains a few bodies (leaf nodes).
+    *          Each node stores the total mass and the center of mass of its bodies, so a distant node can be used as a single body.
+    *          A node is used as a single body if size / distance < opening angle. Otherwise its children are visited.
+    *          The nodes are stored in a contiguous vector, which keeps its capacity, so the tree can be rebuilt in every tick without allocations.
+    *          The tree is not changed by the acceleration calculations, so they can be executed in parallel.
+    *
+    *          (Lengths are measured in meters and masses as reduced masses, G*M)
+    */
+  class Octree
+  {
+  public:
+    /**
+      *  \brief  Constructor
+      *  @param  opening_angle  Opening angle (theta). 0 means that the accelerations are calculated directly (no approximation)
+      *  @param  leaf_size      Maximum number of bodies in a leaf node
+      */
+    Octree(double opening_angle = 0.5, size_t leaf_size = 8) : _opening_angle{ opening_angle }, _leaf_size{ std::max(size_t(1), leaf_size) } {}
+
+    /**
+      *  \brief  Copy Constructor: DELETED
+      */
+    Octree(const Octree&) = delete;
+
+    /**
+      *  \brief  Assignment operator: DELETED
+      */
+    Octree& operator=(const Octree&) = delete;
+
+    /**
+      *  \brief  Builds the tree for a set of bodies. The vectors are referenced, not copied: they must not be changed while the tree is used
+      *  @param  positions  Positions of the bodies
+      *  @param  masses     Reduced masses of the bodies
+      *  @throw  invalid_argument  If the sizes of the vectors do not match
+      */
+    void build(const std::vector<geometry::Vec3<units::LENGTH_T>>& positions, const std::vector<units::REDUCED_MASS_T>& masses);
+
+    /**
+      *  \brief  Gravitational acceleration caused by the bodies in the tree at a position
+      *  @param  position  The position
+      *  @param  exclude   Index of a body which is excluded from the calculation (e.g. the body at the position). Use size() for none
+      *  @return  The acceleration
+      */
+    geometry::Vec3<units::ACCELERATION_T> acceleration(const geometry::Vec3<units::LENGTH_T>& position, size_t exclude) const;
+
+    /**
+      *  \brief  Number of bodies in the tree
+      */
+    size_t size() const { return _order.size(); }
+
+    /**
+      *  \brief  Opening angle
+      */
+    double openingAngle() const { return _opening_angle; }
+    void openingAngle(double opening_angle) { _opening_angle = opening_angle; }
+
+
+  private:
+    /**
+      *  \brief  Maximum depth of the tree (deeper nodes are leaves, whatever the number of bodies they contain)
+      */
+    static constexpr size_t MAX_DEPTH{ 32 };
+
+    /**
+      *  \brief  Node of the tree: cube with the bodies [first, first + count) in the order vector
+      */
+    struct Node
+    {
+      geometry::Vec3<units::LENGTH_T> center{ 0.0, 0.0, 0.0 };
+      units::LENGTH_T                 half_size{ 0.0 };
+      geometry::Vec3<units::LENGTH_T> mass_center{ 0.0, 0.0, 0.0 };
+      units::REDUCED_MASS_T           mass{ 0.0 };
+      uint32_t                        children{ 0 };   /**< Index of the first of the 8 consecutive children. 0 for a leaf node */
+      uint32_t                        first{ 0 };
+      uint32_t                        count{ 0 };
+    };
+
+    double _opening_angle;
+    size_t _leaf_size;
+
+    std::vector<Node>   _nodes;
+
+    /**
+      *  \brief  Indexes of the bodies sorted by node, and buffer used to sort them
+      */
+    std::vector<uint32_t> _order, _buffer;
+
+    const std::vector<geometry::Vec3<units::LENGTH_T>>* _positions{ nullptr };
+    const std::vector<units::REDUCED_MASS_T>*           _masses{ nullptr };
+
+    /**
+      *  \brief  Divides a node in 8 children (recursively) and calculates its mass and center of mass
+      */
+    void split(uint32_t node, size_t depth);
+
+  }; // END class Octree
+}
+
+
+#endif // OCTREE_H
@@ -0,0 +1,107 @@
+#ifndef PARTICLE_CLOUD_H
+#define PARTICLE_CLOUD_H
+
+#include <vector>
+
+#include <physics/units.h>
+#include <physics/k_body.h>
+
+
+namespace physics
+{
+  /**
+    *  \brief  Cloud of massless test particles orbiting a parent body (rings, asteroid belts, debris fields).
+    *          The particles are not bodies: they have no name, orbit or node in the tree of bodies, they do not attract any body and they are
+    *          only attracted by the parent body. Each particle is a Kepler orbit stored in flat arrays (structure of arrays), with its constants
+    *          precomputed: eccentricity, mean motion, mean anomaly at time 0 and the perifocal basis scaled by the semiaxes (A = a * P, B = b * Q),
+    *          so the position at any time is r = (cos E - e) * A + sin E * B, with E solved from Kepler's equation.
+    *          The particles have no state: their positions are calculated in bulk for the requested time (see positions()), as single precision
+    *          (x, y, z) triplets relative to the parent body, ready to be rendered as points. Ranges of particles can be calculated in parallel.
+    *
+    *          (Angles are measured in radians, lengths in meters and times in seconds since the start of the simulation)
+    */
+  class ParticleCloud
+  {
+  public:
+    /**
+      *  \brief  Constructor: empty cloud
+      *  @param  parent  The body orbited by the particles
+      */
+    ParticleCloud(const KBody& parent) : _parent{ parent }, _mu{ parent.reduced_mass } {}
+
+    /**
+      *  \brief  Copy Constructor: DELETED
+      */
+    ParticleCloud(const ParticleCloud&) = delete;
+
+    /**
+      *  \brief  Assignment operator: DELETED
+      */
+    ParticleCloud& operator=(const ParticleCloud&) = delete;
+
+    /**
+      *  \brief  Adds a particle, from its Keplerian elements relative to the parent body (in the inertial CS)
+      *  @param  a, e             Semimajor axis and eccentricity
+      *  @param  i, raan, arg_periapsis  Inclination, longitude of the ascending node and argument of the periapsis
+      *  @param  mean_anomaly     Mean anomaly at the epoch
+      *  @param  epoch            Time of the mean anomaly
+      *  @throw  invalid_argument  If the orbit is not elliptical (a <= 0 or e not in [0, 1))
+      */
+    void add(units::LENGTH_T a, double e, units::ANGLE_T i, units::ANGLE_T raan, units::ANGLE_T arg_periapsis, units::ANGLE_T mean_anomaly,
+             units::TIME_T epoch = units::TIME_T{ 0 });
+
+    /**
+      *  \brief  Adds particles with random elements (uniform distributions), e.g. a ring or a belt. The same seed generates the same particles
+      *  @param  count             Number of particles
+      *  @param  min_a, max_a      Range of the semimajor axes (the particles are uniformly distributed in the area of the annulus)
+      *  @param  max_e             Maximum eccentricity
+      *  @param  max_i             Maximum inclination (relative to the XY plane of the inertial CS)
+      *  @param  seed              Seed of the random numbers
+      *  @throw  invalid_argument  If the ranges are not valid
+      */
+    void generate(size_t count, units::LENGTH_T min_a, units::LENGTH_T max_a, double max_e, units::ANGLE_T max_i, uint32_t seed);
+
+    /**
+      *  \brief  Reserves memory for a number of particles
+      */
+    void reserve(size_t count);
+
+    /**
+      *  \brief  Number of particles
+      */
+    size_t size() const { return _e.size(); }
+
+    /**
+      *  \brief  The body orbited by the particles
+      */
+    const KBody& parent() const { return _parent; }
+
+    /**
+      *  \brief  Calculates the positions of the particles [first, last) at a time
+      *  @param  time       The time
+      *  @param  first      First particle
+      *  @param  last       Particle after the last one
+      *  @param  positions  Array of 3 * size() floats: the position (x, y, z) of particle p, relative to the parent, is written at 3 * p
+      */
+    void positions(units::TIME_T time, size_t first, size_t last, float* positions) const;
+
+
+  private:
+    const KBody&           _parent;
+    units::REDUCED_MASS_T  _mu;
+
+    /**
+      *  \brief  Eccentricity, mean motion and mean anomaly at time 0
+      */
+    std::vector<double>  _e, _mean_motion, _mean_anomaly_0;
+
+    /**
+      *  \brief  Perifocal basis scaled by the semimajor axis (A = a * P) and the semiminor axis (B = b * Q)
+      */
+    std::vector<double>  _ax, _ay, _az, _bx, _by, _bz;
+
+  }; // END class ParticleCloud
+}
+
+
+#endif // PARTICLE_CLOUD_H
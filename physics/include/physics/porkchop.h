@@ -0,0 +1,102 @@
+#ifndef PORKCHOP_H
+#define PORKCHOP_H
+
+#include <vector>
+#include <ostream>
+
+#include <physics/units.h>
+#include <physics/kepler_orbit.h>
+#include <physics/lambert_solver.h>
+
+
+namespace physics
+{
+  /**
+    *  \brief  Generator of porkchop plots: grids of transfers between 2 bodies orbiting the same primary body, for a range of departure times and
+    *          times of flight. The states of the bodies are calculated from their Kepler orbits (see KeplerOrbit::stateAt()) and every transfer
+    *          is solved as a Lambert's problem (prograde, up to a maximum number of revolutions). For every cell the transfer with the lowest
+    *          total delta-v is kept:
+    *             - C3: square of the hyperbolic excess speed at departure (relative to the departure body)
+    *             - arrival v-inf: hyperbolic excess speed at arrival (relative to the arrival body)
+    *             - delta-v: sum of both excess speeds (the gravity of the bodies and the parking orbits are not considered)
+    *          The grid is solved in blocks of departures, so the memory used does not depend on the size of the grid.
+    *
+    *          (Times are measured in seconds since the start of the simulation, speeds in meters per second)
+    */
+  class Porkchop
+  {
+  public:
+    /**
+      *  \brief  Grid of departure times and times of flight
+      */
+    struct Grid
+    {
+      units::TIME_T  first_departure;
+      units::TIME_T  departure_step;
+      size_t         departures;
+      units::TIME_T  min_tof;
+      units::TIME_T  tof_step;
+      size_t         tofs;
+      size_t         max_revolutions;
+    };
+
+    /**
+      *  \brief  Best transfer of a cell of the grid
+      */
+    struct Cell
+    {
+      units::TIME_T   departure;
+      units::TIME_T   tof;
+      double          c3;              /**< m2/s2. NaN if there is no transfer */
+      units::SPEED_T  arrival_v_inf;
+      units::SPEED_T  delta_v;
+      uint32_t        revolutions;
+    };
+
+    /**
+      *  \brief  Constructor
+      *  @param  solver  Solver of the Lambert's problems (its pool of threads is used)
+      */
+    Porkchop(LambertSolver& solver) : _solver{ solver } {}
+
+    /**
+      *  \brief  Generates the grid of transfers
+      *  @param  departure  Orbit of the departure body
+      *  @param  arrival    Orbit of the arrival body (around the same primary body)
+      *  @param  mu         Reduced mass of the primary body
+      *  @param  grid       Departure times and times of flight
+      *  @param  cells      Resized and filled with the cells, sorted by departure and time of flight
+      *  @throw  invalid_argument  If the grid is empty, or the steps or the minimum time of flight are not positive
+      */
+    void generate(const KeplerOrbit& departure, const KeplerOrbit& arrival, units::REDUCED_MASS_T mu, const Grid& grid, std::vector<Cell>& cells);
+
+    /**
+      *  \brief  Writes the cells as CSV: DEPARTURE;TOF;C3;ARRIVAL_V_INF;DELTA_V;REVOLUTIONS
+      */
+    static void writeCsv(std::ostream& out, const std::vector<Cell>& cells, char separator = ';');
+
+    /**
+      *  \brief  Writes the cells in binary format: number of cells (uint64_t), followed by 6 doubles per cell (the CSV fields)
+      */
+    static void writeBinary(std::ostream& out, const std::vector<Cell>& cells);
+
+
+  private:
+    /**
+      *  \brief  Number of departures solved in every block
+      */
+    static constexpr size_t BLOCK_DEPARTURES{ 64 };
+
+    LambertSolver& _solver;
+
+    /**
+      *  \brief  Buffers of the problems and solutions of a block
+      */
+    std::vector<LambertSolver::Problem>   _problems;
+    std::vector<LambertSolver::Solution>  _solutions;
+
+  }; // END class Porkchop
+}
+
+
+#endif // PORKCHOP_H
@@ -4,15 +4,28 @@
 #include <string>
 #include <memory>
 #include <chrono>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
 
 //////#include <mysqlx/xdevapi.h>
 
 #include <files/properties_file_reader.h>
 #include <misc/formatDateTime.h>
+#include <misc/triple_buffer.h>
+#include <misc/ring_buffer.h>
 
 #include <physics/units.h>
 #include <physics/observer.h>
 #include <physics/k_body.h>
+#include <physics/collision_detector.h>
+#include <physics/event_detector.h>
+#include <physics/particle_cloud.h>
+#include <physics/spatial_index.h>
 
 #include <collections/mtree.h>
 
@@ -24,10 +37,135 @@ namespace physics
     *  \brief  Space simulation class. 
     *          It contains one or more observers and a collection of different types of bodies
     *          The spcae wvolves according to a tick time, which can be increased or decreased (in seconds, min value = 1)
+    *          The simulation can run in its own thread (see start()). In that case:
+    *             - the state is published periodically as immutable snapshots, which can be read by another thread without blocking (see snapshot())
+    *             - the simulation is controlled with commands (pause, resume, tick, jump, rewind), executed by the simulation thread between ticks (see post())
+    *             - with a real-time factor (property REAL_TIME_FACTOR), the ticks are paced with the real time: the simulation time owed since the last 
+    *               tick is accumulated and the ticks are run when it reaches the tick. When several ticks are owed and the propagator allows it 
+    *               (see KBody::Context::canCoalesce()), up to MAX_COALESCED_TICKS ticks are propagated as a single step. If the simulation falls behind the 
+    *               real time by more than MAX_PACE_LAG, it is reported (see Snapshot::lagging) and the excess is dropped
+    *          Every CHECKPOINT_INTERVAL seconds of simulation time, the state of all the bodies is stored in a bounded ring buffer of checkpoints, 
+    *             so the space can be moved back to any past time covered by the checkpoints (see rewindTo())
+    *          The state of the space can be saved in a binary state file (see saveState()). If the property STATE_FILE names an existing state file, 
+    *             the space is loaded from it instead of the DB, and the simulation continues from the saved time (see StateFile)
+    *          Every COLLISION_INTERVAL seconds of simulation time, the trajectories of all the bodies since the previous detection are checked for 
+    *             impacts (see CollisionDetector). The impacts are logged and kept as events (see impacts()). The detection waits for the next tick 
+    *             when all the bodies have been moved (see KBody::Context::synchronized()), so it is not executed more often than every MAX_STEP_TICKS ticks. 
+    *             The trajectories of the bodies whose orbital period is shorter than COLLISION_SEGMENTS_PER_ORBIT times the interval are divided in 
+    *             segments, calculated from the orbits (see KBody::stateAt()), so the fast moons are followed through long intervals
+    *          Events (apsis passages, SOI crossings, distance thresholds, conjunctions and eclipses) can be registered for some bodies (see addEvent()).
+    *             Every EVENT_INTERVAL seconds of simulation time (or every tick), the event functions are bracketed between the states of 
+    *             the bodies at both ends of the interval and their roots are refined (see EventDetector). The events are logged and published 
+    *             through a queue, which can be read by another thread (see pollEvents())
+    *          Clouds of massless test particles (rings, belts, debris) can be attached to the bodies (see ParticleCloud and the property 
+    *             PARTICLE_CLOUDS). The particles are not propagated in the ticks: their positions are calculated in bulk, in parallel, only when 
+    *             a snapshot is published (see Snapshot::particles)
     */
   class Space
   {
     public:
+      /**
+        *  \brief  State of a body in a snapshot
+        */
+      struct BodyState
+      {
+        const KBody*         body;      /**< The body (only its constant members can be used while the simulation thread is running) */
+        const KBody*         parent;    /**< Parent of the body (nullptr for the root body). The ships change their parent when they change their SOI */
+        PBody::PositionType  position;
+        PBody::VelocityType  velocity;
+        units::LENGTH_T      a;         /**< Semimajor axis of the orbit */
+      };
+
+      /**
+        *  \brief  Particle cloud in a snapshot
+        */
+      struct CloudState
+      {
+        const ParticleCloud*  cloud;
+        PBody::PositionType   origin;   /**< Position of the parent of the cloud: the positions of the particles are relative to it */
+        size_t                first;    /**< First particle of the cloud in Snapshot::particles */
+        size_t                count;    /**< Number of particles */
+      };
+
+      /**
+        *  \brief  Snapshot of the state of the space, published by the simulation thread
+        */
+      struct Snapshot
+      {
+        units::TIME_T           elapsed_time{ 0 };
+        units::TIME_T           tick{ 0 };
+        uint64_t                ticks{ 0 };         /**< Total number of executed ticks */
+        bool                    paused{ false };
+        bool                    lagging{ false };   /**< The simulation cannot keep up with the real-time factor */
+        std::vector<BodyState>  bodies;
+
+        /**
+          *  \brief  Spatial index of the positions of the bodies, to find the bodies near a position without checking all of them. 
+          *          The indexes returned by its queries are indexes in the bodies vector
+          */
+        SpatialIndex            spatial_index;
+
+        /**
+          *  \brief  Index of each body in the bodies vector (the same for all the snapshots)
+          */
+        const std::unordered_map<const KBody*, size_t>* index{ nullptr };
+
+        /**
+          *  \brief  Particle clouds, and the positions (x, y, z) of the particles of all the clouds, relative to the parent of their cloud 
+          *          (single precision, to be rendered as points)
+          */
+        std::vector<CloudState> clouds;
+        std::vector<float>      particles;
+
+        /**
+          *  \brief  State of a body
+          *  @throw  out_of_range  If the body is not in the snapshot
+          */
+        const BodyState& state(const KBody& body) const { return bodies[index->at(&body)]; }
+
+        /**
+          *  \brief  Children of every body, sorted as in the tree families. The simulation thread moves the ships in the tree, so another thread
+          *          must use the hierarchy of the snapshot instead of iterating the tree families
+          */
+        std::unordered_map<const KBody*, std::vector<const KBody*>> children() const;
+      };
+
+      /**
+        *  \brief  Impact between two bodies
+        */
+      struct Impact
+      {
+        const KBody*     body_1;
+        const KBody*     body_2;
+        units::TIME_T    time;       /**< Elapsed time of the first contact */
+        units::LENGTH_T  distance;   /**< Distance between the centers at the closest approach */
+      };
+
+      /**
+        *  \brief  Event detected for a registered event function
+        */
+      struct Event
+      {
+        size_t               id;          /**< Id returned by addEvent() */
+        EventDetector::Type  type;
+        bool                 rising;      /**< Direction of the event (see EventDetector and EventDetector::eventName()) */
+        const KBody*         body;
+        const KBody*         other;
+        const KBody*         reference;
+        double               time;        /**< Elapsed time of the event, in seconds (with the fraction of the second) */
+      };
+
+      /**
+        *  \brief  Command to be executed by the simulation thread
+        */
+      struct Command
+      {
+        enum Type : uint8_t { PAUSE, RESUME, TICK, JUMP_TO, REWIND_TO };
+
+        Type          type;
+        units::TIME_T value{ 0 };   /**< New tick (TICK) or new elapsed time (JUMP_TO, REWIND_TO) */
+      };
+
       /* *********************************************** Operations ************************************************************* */
       /**
         *  \brief  Copy constructor: DELETED
@@ -109,6 +247,101 @@ namespace physics
         */
       void tick(const units::TIME_T &new_tick);
 
+      /**
+        *  \brief  Starts the simulation thread, which runs ticks until it is paused or stopped
+        *          The first snapshot is published before the thread starts
+        *  @return  void
+        */
+      void start();
+
+      /**
+        *  \brief  Stops the simulation thread (if running) and waits until it has finished
+        *  @return  void
+        */
+      void stop();
+
+      /**
+        *  \brief  Sends a command to the simulation thread. It will be executed before the next tick
+        *  @param   command  The command
+        *  @return  void
+        */
+      void post(const Command& command);
+
+      /**
+        *  \brief  Latest snapshot published by the simulation thread. To be used by 1 reader thread only
+        *  @throw   The exception which stopped the simulation thread, if any
+        *  @return  A reference to the snapshot, valid until the next call
+        */
+      const Snapshot& snapshot();
+
+      /**
+        *  \brief  Moves the space directly to a date/time, without running the intermediate ticks
+        *          The state of all the bodies is calculated from the epochs of their orbits
+        *  @param   date_time  The new date/time
+        *  @return  void
+        */
+      void jumpTo(const std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds>& date_time);
+
+      /**
+        *  \brief  Moves the space back to a past date/time: the latest checkpoint before it is restored and the ticks are run again up to the last 
+        *          tick at or before the date/time, so the following ticks stay on the same grid. The reached date/time is the new elapsed time 
+        *          (see elapsedTime()). The newer checkpoints are discarded
+        *  @param   date_time  The date/time, between the oldest checkpoint and the current date/time
+        *  @return  false if the date/time is not covered by the checkpoints (the space is not changed)
+        */
+      bool rewindTo(const std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds>& date_time);
+
+      /**
+        *  \brief  Moves the bodies which are not moved in every tick (multi-rate stepping) to the current time.
+        *          It must be called before reading the state of the bodies directly (the snapshots are always synchronized)
+        *  @return  void
+        */
+      void synchronize();
+
+      /**
+        *  \brief  Saves the state of the space (bodies, hierarchy, orbits and time) in a binary state file, which can be loaded in another execution 
+        *          (property STATE_FILE). It must not be called while the simulation thread is running
+        *  @param   file_name  The state file
+        *  @throw   runtime_error  If the file cannot be written
+        *  @return  void
+        */
+      void saveState(const std::string& file_name);
+
+      /**
+        *  \brief  Registers an event function. It must not be called while the simulation thread is running
+        *  @param   type       Type of the event (see EventDetector)
+        *  @param   body       The body
+        *  @param   other      Other body (SOI, DISTANCE, CONJUNCTION) or occulter (ECLIPSE). SOI: the parent of the body if it is nullptr
+        *  @param   reference  Primary body (APSIS), observer (CONJUNCTION) or light source (ECLIPSE). The parent of the body (APSIS) or 
+        *                      the root body (CONJUNCTION, ECLIPSE) if it is nullptr
+        *  @param   distance   Threshold distance (DISTANCE)
+        *  @throw   invalid_argument  If a mandatory body is missing, or the body has no parent (APSIS, SOI)
+        *  @return  The id of the event function, reported in its events
+        */
+      size_t addEvent(EventDetector::Type type, const KBody& body, const KBody* other = nullptr, const KBody* reference = nullptr, units::LENGTH_T distance = 0);
+
+      /**
+        *  \brief  Adds an empty particle cloud orbiting a body. It must not be called while the simulation thread is running
+        *  @param   parent  The body orbited by the particles
+        *  @return  The cloud, to add the particles
+        */
+      ParticleCloud& addParticleCloud(const KBody& parent);
+
+      /**
+        *  \brief  Moves the events detected since the last call to a vector (thread safe). Events after a rewind are detected and reported again
+        *  @param   events  Cleared and filled with the events, sorted by time
+        *  @return  false if there are no events
+        */
+      bool pollEvents(std::vector<Event>& events);
+
+      /**
+        *  \brief  Converts a date/time string, in the space date/time format (DATE_FORMAT + " " + TIME_FORMAT), to a time point
+        *  @param   date_time  The date/time string
+        *  @throw   string exception if the string does not have the expected format
+        *  @return  The time point
+        */
+      std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds> parseDateTime(const std::string& date_time) const;
+
 
       /**
         *  \brief  GET Operations
@@ -116,9 +349,17 @@ namespace physics
       auto tick() const { return _tick; }
       auto elapsedTime() const { return _elapsed_time; }
       auto initDateTime() const { return _init_date_time; }
-      std::pair<std::string, std::string> dateAndTime() const { return utils::formatAnyDateTime(_init_date_time + _elapsed_time, _datetime_format->first, _datetime_format->second, true); }
+      auto logInterval() const { return _log_interval; }
+      std::pair<std::string, std::string> dateAndTime() const { return dateAndTime(_elapsed_time); }
+      std::pair<std::string, std::string> dateAndTime(units::TIME_T elapsed_time) const { return utils::formatAnyDateTime(_init_date_time + elapsed_time, _datetime_format->first, _datetime_format->second, true); }
       const tree::MTree<KBody>& bodies() const { return _bodies; }
 
+      /**
+        *  \brief  Impacts detected so far, sorted by time. Impacts after the current time are discarded when the space is moved back 
+        *          (they are detected again), and all of them when it jumps. Not to be used while the simulation thread is running
+        */
+      const std::vector<Impact>& impacts() const { return _impacts; }
+
       /* *********************************************** Operations (END) ******************************************************* */
 
 
@@ -143,6 +384,11 @@ namespace physics
         * \brief  Bodies in the space: a hierarchical tree of bodies
         */
       tree::MTree<KBody> _bodies;
+
+      /**
+        * \brief  Context of the movement of the bodies (see KBody::Context). It is destroyed before the bodies
+        */
+      std::unique_ptr<KBody::Context> _context{ nullptr };
        
       /**
         *  \brief Space date/time format, determined by the properties DATE_FORMAT and TIME_FORMAT (see Space())
@@ -164,6 +410,169 @@ namespace physics
         */
       units::TIME_T _elapsed_time;
 
+      /**
+        *  \brief Interval of simulation time for generating statistical information, determined by the property LOG_INTERVAL (see Space())
+        */
+      units::TIME_T _log_interval;
+
+      /**
+        *  \brief Total number of executed ticks
+        */
+      uint64_t _ticks{ 0 };
+
+      /**
+        *  \brief Simulation thread and its state
+        */
+      std::thread _sim_thread;
+      std::atomic<bool> _stop_sim{ false };
+      bool _paused{ false };
+
+      /**
+        *  \brief Exception which stopped the simulation thread
+        */
+      std::exception_ptr _sim_exception{ nullptr };
+      std::atomic<bool> _sim_failed{ false };
+
+      /**
+        *  \brief Queue of commands for the simulation thread (and the commands being executed)
+        */
+      std::mutex _commands_mutex;
+      std::condition_variable _commands_cv;
+      std::vector<Command> _commands;
+      std::vector<Command> _commands_exec;
+
+      /**
+        *  \brief Snapshots published by the simulation thread
+        */
+      utils::TripleBuffer<Snapshot> _snapshots;
+
+      /**
+        *  \brief Bodies in the snapshots and their index
+        */
+      std::vector<const KBody*> _snapshot_bodies;
+      std::unordered_map<const KBody*, size_t> _snapshot_index;
+
+      /**
+        *  \brief Buffer with the positions of the bodies, used to build the spatial index of the snapshots
+        */
+      std::vector<geometry::Vec3<units::LENGTH_T>> _snapshot_positions;
+
+      /**
+        *  \brief Buffer with the states of the bodies read in the snapshots and in the collision detection (the passive bodies are calculated on demand, 
+        *         see KBody::Context::states())
+        */
+      std::vector<std::pair<PBody::PositionType, PBody::VelocityType>> _body_states;
+
+      /**
+        *  \brief Minimum real time between snapshots, determined by the property SNAPSHOT_INTERVAL (see Space())
+        */
+      std::chrono::milliseconds _snapshot_interval;
+
+      /**
+        *  \brief Simulation seconds per real second, determined by the property REAL_TIME_FACTOR (see Space()). 0: the ticks are not paced
+        */
+      double _real_time_factor{ 0 };
+
+      /**
+        *  \brief Maximum number of ticks propagated as a single step, determined by the property MAX_COALESCED_TICKS (see Space())
+        */
+      uint64_t _max_coalesced_ticks{ 1 };
+
+      /**
+        *  \brief Maximum real time (in seconds) the paced simulation can be behind before the owed simulation time is dropped
+        */
+      static constexpr double MAX_PACE_LAG{ 1.0 };
+
+      /**
+        *  \brief Pacing of the ticks: real time of the last update of the owed simulation time, the owed time (in simulation seconds) and 
+        *         whether the simulation is behind the real time
+        */
+      std::chrono::steady_clock::time_point _pace_time;
+      double _pace_debt{ 0 };
+      bool _lagging{ false };
+
+      /**
+        *  \brief Checkpoint of the space: state of the bodies and total number of executed ticks (restored with the bodies, so the statistics continue)
+        */
+      struct Checkpoint
+      {
+        KBody::Checkpoint bodies;
+        uint64_t          ticks{ 0 };
+      };
+
+      /**
+        *  \brief Checkpoints of the space (the number of checkpoints is determined by the property CHECKPOINTS, see Space())
+        */
+      std::unique_ptr<utils::RingBuffer<Checkpoint>> _checkpoints{ nullptr };
+
+      /**
+        *  \brief Simulation time between checkpoints, determined by the property CHECKPOINT_INTERVAL (see Space())
+        */
+      units::TIME_T _checkpoint_interval;
+
+      /**
+        *  \brief  Simulation time between collision detections, determined by the property COLLISION_INTERVAL (see Space()). 0: no detection
+        */
+      units::TIME_T _collision_interval;
+
+      /**
+        *  \brief  Collision detection: bodies, radii and states at the start of the current interval ([0]) and at its end ([1])
+        */
+      CollisionDetector _collision_detector;
+      units::TIME_T _collision_time{ 0 };
+      std::vector<const KBody*> _collision_bodies;
+      std::vector<units::LENGTH_T> _collision_radii;
+      std::vector<geometry::Vec3<units::LENGTH_T>> _collision_positions[2];
+      std::vector<geometry::Vec3<units::SPEED_T>> _collision_velocities[2];
+      std::vector<CollisionDetector::Impact> _collision_impacts;
+
+      /**
+        *  \brief  Maximum length of the segments of the trajectory of each body in the collision detection: a fraction of its orbital period
+        */
+      std::vector<double> _collision_max_segments;
+      static constexpr double COLLISION_SEGMENTS_PER_ORBIT{ 16.0 };
+
+      /**
+        *  \brief  Impacts detected so far
+        */
+      std::vector<Impact> _impacts;
+
+      /**
+          *  \brief  Simulation time between event detections, determined by the property EVENT_INTERVAL (see Space()). 0: every tick
+        */
+      units::TIME_T _event_interval;
+
+      /**
+        *  \brief  Event detection: registered event functions (definitions and bodies), bodies of the events, radii and states at the start of the current interval ([0]) 
+        *          and at its end ([1])
+        */
+      EventDetector _event_detector;
+      units::TIME_T _event_time{ 0 };
+      std::vector<EventDetector::Definition> _event_definitions;
+      std::vector<Event> _event_functions;
+      std::vector<const KBody*> _event_bodies;
+      std::vector<units::LENGTH_T> _event_radii;
+      std::vector<geometry::Vec3<units::LENGTH_T>> _event_positions[2];
+      std::vector<geometry::Vec3<units::SPEED_T>> _event_velocities[2];
+      std::vector<EventDetector::Event> _detected_events;
+
+      /**
+        *  \brief  Queue of the events, read with pollEvents()
+        */
+      std::mutex _events_mutex;
+      std::vector<Event> _events;
+
+      /**
+        *  \brief  Particle clouds (created from the property PARTICLE_CLOUDS, see Space(), or with addParticleCloud()). The positions of the 
+        *          particles are calculated by the pool of threads of the bodies (see KBody::Context::pool())
+        */
+      std::vector<std::unique_ptr<ParticleCloud>> _particle_clouds;
+
+      /**
+        *  \brief  Number of particles per task of the pool
+        */
+      static constexpr size_t PARTICLE_CHUNK{ 4096 };
+
 
       /* ********************************************** Data Members (END) ****************************************************** */
 
@@ -186,6 +595,16 @@ namespace physics
         *                            DB.PWD
         *                            DB.SCHEMA         --> DB Connection params
         *                            LOG_INTERVAL      --> interval of simulation time used to generate simulation statistical information (in simulation seconds)
+        *                            SNAPSHOT_INTERVAL --> minimum real time between snapshots published by the simulation thread (in milliseconds)
+        *                            REAL_TIME_FACTOR  --> simulation seconds per real second in the simulation thread (0 = as fast as possible)
+        *                            MAX_COALESCED_TICKS --> maximum number of owed ticks propagated as a single step (1 = no coalescing)
+        *                            CHECKPOINT_INTERVAL --> simulation time between checkpoints (in simulation seconds)
+        *                            CHECKPOINTS       --> maximum number of checkpoints (the oldest ones are discarded)
+        *                            STATE_FILE        --> (optional) state file saved by saveState(). If it exists, the bodies and the time are loaded from it
+        *                            COLLISION_INTERVAL --> simulation time between collision detections (in simulation seconds, 0 = no detection)
+        *                            EVENT_INTERVAL    --> simulation time between event detections (in simulation seconds, 0 = every tick)
+        *                            PARTICLE_CLOUDS   --> (optional) particle clouds with random elements, separated by ';': 
+        *                                                  parent,count,min_a,max_a,max_e,max_i (see ParticleCloud::generate())
         *         Initializes the Observer
         *         Initializes the Bodies
         *         The barycenter of the system is calculated once all the bodies are loaded
@@ -210,6 +629,76 @@ namespace physics
         */
       void createBodies(const utils::PropertiesFileReader& properties);
 
+      /**
+        *  \brief  Create bodies from a state file and continue from its time. The first checkpoint is the loaded state
+        *  @param  file_name  The state file, saved with the same INIT_DATE_TIME and integrator
+        *  @throw  string exception if the file was saved with another INIT_DATE_TIME
+        */
+      void loadState(const std::string& file_name);
+
+      /**
+        *  \brief  Runs several ticks as a single step: the bodies are moved directly to the end of the step (see KBody::Context::jumpTo())
+        */
+      void runTicks(uint64_t ticks);
+
+      /**
+        *  \brief  Main loop of the simulation thread
+        */
+      void simulate();
+
+      /**
+        *  \brief  Adds the simulation time owed since the last call and runs the owed ticks as a single step (or one tick, if they cannot be coalesced)
+        */
+      void runPaced();
+
+      /**
+        *  \brief  Executes a command in the simulation thread
+        */
+      void execute(const Command& command);
+
+      /**
+        *  \brief  Copies the current state into the write buffer of the snapshots and publishes it (building its spatial index)
+        */
+      void publish();
+
+      /**
+        *  \brief  Stores the state of the bodies as the newest checkpoint (the oldest one is discarded if there is no room)
+        */
+      void checkpoint();
+
+      /**
+        *  \brief  Creates the particle clouds of the property PARTICLE_CLOUDS
+        *  @throw  string exception if a cloud is not valid
+        */
+      void createParticleClouds(const std::string& clouds);
+
+      /**
+        *  \brief  Stores the state of the bodies as the start of the next collision detection interval
+        */
+      void resetCollisions();
+
+      /**
+        *  \brief  Detects the impacts since the start of the collision detection interval and starts the next interval. It must be called on a tick 
+        *          when all the bodies have been moved (see KBody::Context::synchronized())
+        */
+      void detectCollisions();
+
+      /**
+        *  \brief  Stores the state of the bodies of the events as the start of the next event detection interval
+        */
+      void resetEvents();
+
+      /**
+        *  \brief  Detects the events since the start of the event detection interval, queues them and starts the next interval. Only the 
+        *          bodies of the events are calculated at the current time (see KBody::state())
+        */
+      void detectEvents();
+
+      /**
+        *  \brief  Index of a body in the event detection (it is added if it is not there yet)
+        */
+      size_t eventBody(const KBody& body);
+
       /* *********************************************** Operations (END) ******************************************************* */
   };
 }
@@ -0,0 +1,87 @@
+#ifndef SPATIAL_INDEX_H
+#define SPATIAL_INDEX_H
+
+#include <vector>
+#include <algorithm>
+
+#include <physics/units.h>
+#include <geometry/basic_types.h>
+
+
+namespace physics
+{
+  /**
+    *  \brief  Spatial index of a set of points (e.g. the positions of the bodies), to find the points within a distance of any position (range query)
+    *          or the k points nearest to it (kNN query) without checking all the points.
+    *          It is a balanced k-d tree stored implicitly in a permutation of the points: every range of the permutation is a node, split at its 
+    *          median along the axis of its largest extent. Small ranges are leaves, which are checked linearly.
+    *          The points are copied, so the index can be used after the positions change (it is not updated: it must be built again). 
+    *          The vectors keep their capacity, so the index can be rebuilt periodically without allocations. The queries do not change the index, so they
+    *          can be executed in parallel.
+    *
+    *          (Lengths are measured in meters)
+    */
+  class SpatialIndex
+  {
+  public:
+    /**
+      *  \brief  Constructor
+      *  @param  leaf_size  Maximum number of points in a leaf node
+      */
+    SpatialIndex(size_t leaf_size = 8) : _leaf_size{ std::max(size_t(1), leaf_size) } {}
+
+    /**
+      *  \brief  Builds the index for a set of points, in O(N log N)
+      *  @param  positions  The points. The queries return their indexes in this vector
+      */
+    void build(const std::vector<geometry::Vec3<units::LENGTH_T>>& positions);
+
+    /**
+      *  \brief  Points within a distance of a position (range query)
+      *  @param  center  The position
+      *  @param  radius  The distance
+      *  @param  result  Cleared and filled with the indexes of the points (not sorted)
+      */
+    void range(const geometry::Vec3<units::LENGTH_T>& center, units::LENGTH_T radius, std::vector<size_t>& result) const;
+
+    /**
+      *  \brief  The k points nearest to a position (kNN query)
+      *  @param  center  The position
+      *  @param  k       Number of points (all the points if there are less than k)
+      *  @param  result  Cleared and filled with the indexes of the points, sorted by distance
+      */
+    void nearest(const geometry::Vec3<units::LENGTH_T>& center, size_t k, std::vector<size_t>& result) const;
+
+    /**
+      *  \brief  Number of points in the index
+      */
+    size_t size() const { return _points.size(); }
+
+
+  private:
+    size_t _leaf_size;
+
+    /**
+      *  \brief  Points in the order of the tree, their original indexes and the split axis of the node whose median is each point
+      */
+    std::vector<geometry::Vec3<units::LENGTH_T>> _points;
+    std::vector<size_t>   _indexes;
+    std::vector<uint8_t>  _axes;
+
+    /**
+      *  \brief  Splits the node [first, last) at its median (recursively)
+      */
+    void split(size_t first, size_t last);
+
+    void range(size_t first, size_t last, const geometry::Vec3<units::LENGTH_T>& center, double squared_radius, std::vector<size_t>& result) const;
+
+    /**
+      *  \brief  kNN query in the node [first, last). The heap contains the nearest points found so far: (squared distance, position in the tree)
+      */
+    void nearest(size_t first, size_t last, const geometry::Vec3<units::LENGTH_T>& center, size_t k, std::vector<std::pair<double, size_t>>& heap) const;
+
+  }; // END class SpatialIndex
+}
+
+
+#endif // SPATIAL_INDEX_H
@@ -0,0 +1,116 @@
+#ifndef STATE_FILE_H
+#define STATE_FILE_H
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+#include <files/mapped_file.h>
+#include <collections/mtree.h>
+
+#include <physics/k_body.h>
+
+
+namespace physics
+{
+  /**
+    *  \brief  Binary file with the state of a space: bodies, hierarchy, orbits and time, so a simulation can be continued without reading the DB.
+    *          The file is versioned and position independent (bodies are referenced by their index, names by their offset), and it is made of fixed 
+    *          size records, so it is mapped in memory and read in place, without parsing:
+    *             - Header
+    *             - Body records, in the iteration order of the tree of bodies (sorted by name). The parent of a body is the index of its record
+    *             - Names: the common and provisional names of every body, concatenated (without terminators)
+    *          The values are stored with the byte order of the machine which writes the file. Files with a different version, record size or 
+    *          magic number are rejected
+    */
+  class StateFile
+  {
+  public:
+    static constexpr char     MAGIC[8]{ 'S', 'P', 'A', 'C', 'E', 'S', 'T', 'T' };
+    static constexpr uint32_t VERSION{ 1 };
+
+    struct Header
+    {
+      char      magic[8];
+      uint32_t  version;
+      uint32_t  record_size;
+      int64_t   init_date_time;   /**< Initial date/time of the space (seconds since the epoch of the system clock) */
+      int64_t   elapsed_time;     /**< Time since the initial date/time (seconds) */
+      int64_t   tick;
+      uint64_t  ticks;            /**< Total number of executed ticks */
+      uint64_t  step_ticks;       /**< Ticks of the multi-rate stepping */
+      uint8_t   integrator;
+      uint8_t   reserved[7];
+      uint64_t  num_bodies;
+      uint64_t  bodies_offset;
+      uint64_t  names_offset;
+      uint64_t  names_size;
+    };
+
+    struct BodyRecord
+    {
+      uint64_t  name_offset;            /**< Offset of the common name in the names (followed by the provisional name) */
+      uint32_t  common_name_size;
+      uint32_t  provisional_name_size;
+      int64_t   parent;                 /**< Index of the parent (-1 for the root body) */
+      int64_t   id;
+      uint8_t   type;
+      uint8_t   parent_perturbator;
+      uint8_t   reserved[6];
+      double    reduced_mass;
+      double    radius;
+      double    position[3];
+      double    velocity[3];
+      double    barycenter_pos[3];
+      double    barycenter_vel[3];
+
+      // Orbit (see KeplerOrbit::Checkpoint)
+      double    a, e, i, asc_node, periapsis;
+      double    anomaly, ecc_anomaly, mean_anomaly, mean_anomaly_epoch;
+      int64_t   epoch, time, time_periapsis;
+      double    orbit_position[3];
+      double    orbit_velocity[3];
+    };
+
+    static_assert(sizeof(Header) == 96 && sizeof(BodyRecord) == 296, "Unexpected padding in the state file records");
+
+    /**
+      *  \brief  Writes the state of a tree of bodies (as they were moved by their context, see KBody::Context::checkpoint()) and the time of the space
+      *  @throw  runtime_error  If the file cannot be written
+      */
+    static void write(const std::string& file_name, tree::MTree<KBody>& bodies, KBody::Context& context, int64_t init_date_time, units::TIME_T elapsed_time, units::TIME_T tick, uint64_t ticks);
+
+    /**
+      *  \brief  Constructor: maps the file and validates its header and the size of its sections
+      *  @throw  runtime_error  If the file cannot be mapped or it is not a valid state file
+      */
+    explicit StateFile(const std::string& file_name);
+
+    const Header& header() const { return *reinterpret_cast<const Header*>(_file.data()); }
+
+    size_t size() const { return size_t(header().num_bodies); }
+
+    const BodyRecord& body(size_t index) const { return reinterpret_cast<const BodyRecord*>(_file.data() + header().bodies_offset)[index]; }
+
+    std::string_view commonName(size_t index) const { return std::string_view(names() + body(index).name_offset, body(index).common_name_size); }
+
+    std::string_view provisionalName(size_t index) const { return std::string_view(names() + body(index).name_offset + body(index).common_name_size, body(index).provisional_name_size); }
+
+    /**
+      *  \brief  Creates the bodies in an empty tree and sets them up with the stored state (see KBody::Context::adopt()). The class KBody must be initialized
+      *  @param  checkpoint  Filled with the stored state of the bodies (so it can be used as the first checkpoint)
+      *  @throw  runtime_error  If the bodies or their hierarchy are not valid, or they were stored with another integrator
+      */
+    void load(tree::MTree<KBody>& bodies, KBody::Context& context, KBody::Checkpoint& checkpoint) const;
+
+
+  private:
+    utils::MappedFile _file;
+
+    const char* names() const { return _file.data() + header().names_offset; }
+
+  }; // END class StateFile
+}
+
+
+#endif // STATE_FILE_H
@@ -0,0 +1,250 @@
+#include <physics/collision_detector.h>
+
+#include <stdexcept>
+#include <numeric>
+#include <algorithm>
+#include <cmath>
+
+using namespace physics;
+using namespace physics::units;
+using namespace geometry;
+
+
+/**
+  *  \brief  Iterations of the bisections in the narrow phase (the error is 2^-40 of the sampling step)
+  */
+static constexpr size_t BISECTION_ITERATIONS{ 40 };
+
+
+/*   void detect(...)   */
+/***********************/
+void CollisionDetector::detect(const std::vector<Vec3<LENGTH_T>>& positions_0, const std::vector<Vec3<SPEED_T>>& velocities_0,
+                               const std::vector<Vec3<LENGTH_T>>& positions_1, const std::vector<Vec3<SPEED_T>>& velocities_1,
+                               const std::vector<LENGTH_T>& radii, const std::vector<double>& max_segments, const Sampler& sampler, double interval, 
+                               std::vector<Impact>& impacts) {
+  const size_t num_bodies = positions_0.size();
+  if (velocities_0.size() != num_bodies || positions_1.size() != num_bodies || velocities_1.size() != num_bodies || radii.size() != num_bodies || 
+      (max_segments.size() && max_segments.size() != num_bodies))
+    throw std::invalid_argument("CollisionDetector: the number of states and radii do not match");
+
+  _candidates = 0;
+
+  // Segments of the trajectories and states at their ends (the inner ones from the sampler)
+  _segments.resize(num_bodies);
+  _first_state.resize(num_bodies);
+  _state_positions.clear();
+  _state_velocities.clear();
+  for (size_t body = 0; body < num_bodies; body++) {
+    uint32_t segments = 1;
+    if (max_segments.size() && sampler && max_segments[body] > 0) {
+      while (segments < MAX_SEGMENTS && interval > segments * max_segments[body])
+        segments *= 2;
+    }
+    _segments[body] = segments;
+    _first_state[body] = _state_positions.size();
+
+    _state_positions.push_back(positions_0[body]);
+    _state_velocities.push_back(velocities_0[body]);
+    for (uint32_t segment = 1; segment < segments; segment++) {
+      _state_positions.emplace_back();
+      _state_velocities.emplace_back();
+      sampler(body, interval * segment / segments, _state_positions.back(), _state_velocities.back());
+    }
+    _state_positions.push_back(positions_1[body]);
+    _state_velocities.push_back(velocities_1[body]);
+  }
+
+  // Boxes of the trajectories: the Bezier control points of each Hermite segment are P0, P0 + V0*T/3, P1 - V1*T/3 and P1
+  _boxes.resize(num_bodies);
+  for (size_t body = 0; body < num_bodies; body++) {
+    const double length = interval / _segments[body];
+    const Vec3<LENGTH_T> radius = Vec3<LENGTH_T>::Constant(radii[body]);
+    Box& box = _boxes[body];
+    box.min = box.max = _state_positions[_first_state[body]];
+    for (size_t state = _first_state[body]; state < _first_state[body] + _segments[body]; state++) {
+      const Vec3<LENGTH_T> control_1 = _state_positions[state] + _state_velocities[state] * (length / 3);
+      const Vec3<LENGTH_T> control_2 = _state_positions[state + 1] - _state_velocities[state + 1] * (length / 3);
+      box.min = box.min.cwiseMin(control_1).cwiseMin(control_2).cwiseMin(_state_positions[state + 1]);
+      box.max = box.max.cwiseMax(control_1).cwiseMax(control_2).cwiseMax(_state_positions[state + 1]);
+    }
+    box.min -= radius;
+    box.max += radius;
+  }
+
+  // Sort the boxes by their minimum x. The previous order is almost sorted, unless the number of bodies has changed or the bodies have jumped 
+  //    (then the insertion sort is abandoned when it has moved too many boxes)
+  auto less_x = [this](uint32_t body_1, uint32_t body_2) { return _boxes[body_1].min.x() < _boxes[body_2].min.x(); };
+  if (_order.size() != num_bodies) {
+    _order.resize(num_bodies);
+    std::iota(_order.begin(), _order.end(), 0);
+    std::sort(_order.begin(), _order.end(), less_x);
+  }
+  else {
+    size_t budget = 8 * num_bodies;
+    for (size_t index = 1; index < num_bodies; index++) {
+      uint32_t body = _order[index];
+      size_t position = index;
+      while (position > 0 && less_x(body, _order[position - 1]) && budget) {
+        _order[position] = _order[position - 1];
+        position--;
+        budget--;
+      }
+      _order[position] = body;
+
+      if (!budget) {
+        std::sort(_order.begin(), _order.end(), less_x);
+        break;
+      }
+    }
+  }
+
+  // Sweep along x: the active boxes are those which have not ended before the start of the current box
+  const size_t first_impact = impacts.size();
+  _active.clear();
+  for (uint32_t body : _order) {
+    const Box& box = _boxes[body];
+
+    size_t kept = 0;
+    for (uint32_t other : _active) {
+      if (_boxes[other].max.x() >= box.min.x())
+        _active[kept++] = other;
+    }
+    _active.resize(kept);
+
+    for (uint32_t other : _active) {
+      const Box& other_box = _boxes[other];
+      if (other_box.max.y() < box.min.y() || box.max.y() < other_box.min.y() || other_box.max.z() < box.min.z() || box.max.z() < other_box.min.z())
+        continue;
+
+      ++_candidates;
+
+      // Relative trajectory in each segment, in Hermite form converted to a cubic polynomial. The segments are tested in order until the first contact
+      const size_t body_1 = std::min<size_t>(body, other);
+      const size_t body_2 = std::max<size_t>(body, other);
+      const uint32_t segments = std::max(_segments[body_1], _segments[body_2]);
+      const double length = interval / segments;
+      Vec3<LENGTH_T> position_1, position_2;
+      Vec3<SPEED_T> velocity_1, velocity_2;
+      trajectoryState(body_1, 0.0, interval, position_1, velocity_1);
+      trajectoryState(body_2, 0.0, interval, position_2, velocity_2);
+      Vec3<LENGTH_T> p0 = position_1 - position_2;
+      Vec3<LENGTH_T> m0 = (velocity_1 - velocity_2) * length;
+      for (uint32_t segment = 0; segment < segments; segment++) {
+        const double s = double(segment + 1) / segments;
+        trajectoryState(body_1, s, interval, position_1, velocity_1);
+        trajectoryState(body_2, s, interval, position_2, velocity_2);
+        const Vec3<LENGTH_T> p1 = position_1 - position_2;
+        const Vec3<LENGTH_T> m1 = (velocity_1 - velocity_2) * length;
+        const Trajectory trajectory{ 2 * p0 + m0 - 2 * p1 + m1, -3 * p0 - 2 * m0 + 3 * p1 - m1, m0, p0 };
+
+        // Bodies in contact at the start of a segment were already in contact at the start of the interval (or their impact was found before)
+        Impact impact;
+        if (trajectory.d.squaredNorm() <= (radii[body_1] + radii[body_2]) * (radii[body_1] + radii[body_2]))
+          break;
+        if (narrowPhase(trajectory, radii[body_1] + radii[body_2], length, impact)) {
+          impact.body_1 = body_1;
+          impact.body_2 = body_2;
+          impact.time += segment * length;
+          impacts.push_back(impact);
+          break;
+        }
+        p0 = p1;
+        m0 = m1;
+      }
+    }
+
+    _active.push_back(body);
+  }
+
+  std::sort(impacts.begin() + first_impact, impacts.end(), [](const Impact& impact_1, const Impact& impact_2) { return impact_1.time < impact_2.time; });
+}
+
+
+/*   void trajectoryState(size_t body, double s, double interval, Vec3<LENGTH_T>& position, Vec3<SPEED_T>& velocity) const   */
+/**************************************************************************************************************************/
+void CollisionDetector::trajectoryState(size_t body, double s, double interval, Vec3<LENGTH_T>& position, Vec3<SPEED_T>& velocity) const {
+  // Segment containing s and the fraction u of the segment: the ends of the segments are returned exactly
+  const uint32_t segments = _segments[body];
+  const double scaled = s * segments;
+  const uint32_t segment = std::min(uint32_t(scaled), segments - 1);
+  const double u = scaled - segment;
+  const size_t state = _first_state[body] + segment;
+  if (u == 0) {
+    position = _state_positions[state];
+    velocity = _state_velocities[state];
+    return;
+  }
+
+  // Cubic Hermite basis functions and their derivatives
+  const double length = interval / segments;
+  const double u2 = u * u, u3 = u2 * u;
+  const Vec3<LENGTH_T>& p0 = _state_positions[state];
+  const Vec3<LENGTH_T>& p1 = _state_positions[state + 1];
+  const Vec3<LENGTH_T> m0 = _state_velocities[state] * length;
+  const Vec3<LENGTH_T> m1 = _state_velocities[state + 1] * length;
+  position = (2 * u3 - 3 * u2 + 1) * p0 + (u3 - 2 * u2 + u) * m0 + (3 * u2 - 2 * u3) * p1 + (u3 - u2) * m1;
+  velocity = ((6 * u2 - 6 * u) * p0 + (3 * u2 - 4 * u + 1) * m0 + (6 * u - 6 * u2) * p1 + (3 * u2 - 2 * u) * m1) / length;
+}
+
+
+/*   bool narrowPhase(const Trajectory& trajectory, LENGTH_T contact_distance, double interval, Impact& impact) const   */
+/**********************************************************************************************************************/
+bool CollisionDetector::narrowPhase(const Trajectory& trajectory, LENGTH_T contact_distance, double interval, Impact& impact) const {
+  const double contact = contact_distance * contact_distance;
+
+  // Squared distance and its derivative (halved): r(s) . r'(s)
+  auto value = [&trajectory](double s) { return trajectory.at(s).squaredNorm(); };
+  auto slope = [&trajectory](double s) { return trajectory.at(s).dot((3 * trajectory.a * s + 2 * trajectory.b) * s + trajectory.c); };
+
+  // Bodies in contact at the start of the interval were reported before
+  if (value(0) <= contact)
+    return false;
+
+  double closest = value(0);
+  double first_contact = -1;
+  double s_0 = 0;
+  double slope_0 = slope(0);
+  for (size_t sample = 1; sample <= _samples; sample++) {
+    const double s_1 = double(sample) / _samples;
+    const double slope_1 = slope(s_1);
+
+    // Closest point in the segment: a local minimum (the slope changes from negative to positive) or the end of the segment
+    double s_min = s_1;
+    if (slope_0 < 0 && slope_1 > 0) {
+      double low = s_0, high = s_1;
+      for (size_t iteration = 0; iteration < BISECTION_ITERATIONS; iteration++) {
+        double middle = 0.5 * (low + high);
+        if (slope(middle) < 0)
+          low = middle;
+        else
+          high = middle;
+      }
+      s_min = 0.5 * (low + high);
+    }
+    const double value_min = value(s_min);
+    closest = std::min({ closest, value_min, value(s_1) });
+
+    // First contact: the distance crosses the contact distance between the start of the segment and the closest point
+    if (first_contact < 0 && value_min <= contact) {
+      double low = s_0, high = s_min;
+      for (size_t iteration = 0; iteration < BISECTION_ITERATIONS; iteration++) {
+        double middle = 0.5 * (low + high);
+        if (value(middle) > contact)
+          low = middle;
+        else
+          high = middle;
+      }
+      first_contact = high;
+    }
+
+    s_0 = s_1;
+    slope_0 = slope_1;
+  }
+
+  if (first_contact < 0)
+    return false;
+
+  impact.time = first_contact * interval;
+  impact.distance = std::sqrt(closest);
+  return true;
+}
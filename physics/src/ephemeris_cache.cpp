@@ -0,0 +1,264 @@
+#include <physics/ephemeris_cache.h>
+
+#include <stdexcept>
+#include <cmath>
+#include <algorithm>
+
+#include <geometry/constants.h>
+
+using namespace physics;
+using namespace physics::units;
+using namespace geometry;
+
+
+/*   CONSTRUCTOR   */
+/*******************/
+EphemerisCache::EphemerisCache(size_t num_bodies, Propagator propagator, TIME_T segment_length, size_t degree, size_t memory_budget, size_t num_threads)
+  : _num_bodies{ num_bodies }, _propagator{ std::move(propagator) }, _segment_length{ double(segment_length.count()) }, _degree{ degree }, _memory_budget{ memory_budget } {
+  if (_segment_length <= 0)
+    throw std::invalid_argument("EphemerisCache: the segment length must be positive");
+  if (_degree == 0)
+    throw std::invalid_argument("EphemerisCache: the degree must be positive");
+
+  // Chebyshev nodes, x(k) = cos(PI * (k + 0.5) / N), and the cosines used in the fit, T(j)(x(k)) = cos(PI * j * (k + 0.5) / N), with N = degree + 1
+  const size_t N = _degree + 1;
+  _nodes.resize(N);
+  _cosines.resize(N * N);
+  for (size_t k = 0; k < N; k++) {
+    _nodes[k] = cos(PI * (k + 0.5) / N);
+    for (size_t j = 0; j < N; j++)
+      _cosines[j * N + k] = cos(PI * j * (k + 0.5) / N);
+  }
+
+  for (size_t i = 0; i < num_threads; i++)
+    _workers.emplace_back(&EphemerisCache::work, this);
+}
+
+
+/*   DESTRUCTOR   */
+/******************/
+EphemerisCache::~EphemerisCache() {
+  {
+    std::lock_guard<std::mutex> lock(_requests_mutex);
+    _stop = true;
+  }
+  _requests_cv.notify_all();
+
+  for (auto& worker : _workers)
+    worker.join();
+}
+
+
+/*   State evaluate(size_t body, double time)   */
+/************************************************/
+EphemerisCache::State EphemerisCache::evaluate(size_t body, double time) {
+  if (body >= _num_bodies)
+    throw std::out_of_range("EphemerisCache: invalid body index");
+
+  Key key{ body, int64_t(std::floor(time / _segment_length)) };
+  uint64_t generation;
+  Coefficients coefficients = find(key, generation);
+  if (!coefficients)
+    coefficients = insert(key, fit(key), generation);
+
+  // Time in the segment, scaled to [-1, 1]
+  const double x = 2 * (time - key.second * _segment_length) / _segment_length - 1;
+
+  // Clenshaw's recurrence, for the 6 series at once: b(j) = 2x * b(j+1) - b(j+2) + c(j);  f(x) = x * b(1) - b(2) + c(0)
+  const double* c = coefficients->data();
+  double b1[6]{ 0, 0, 0, 0, 0, 0 }, b2[6]{ 0, 0, 0, 0, 0, 0 };
+  for (size_t j = _degree; j > 0; j--) {
+    for (size_t series = 0; series < 6; series++) {
+      double b0 = 2 * x * b1[series] - b2[series] + c[j * 6 + series];
+      b2[series] = b1[series];
+      b1[series] = b0;
+    }
+  }
+  double result[6];
+  for (size_t series = 0; series < 6; series++)
+    result[series] = x * b1[series] - b2[series] + c[series];
+
+  return State{ Vec3<LENGTH_T>{ result[0], result[1], result[2] }, Vec3<SPEED_T>{ result[3], result[4], result[5] } };
+}
+
+
+/*   std::future<void> prefetch(size_t body, double first_time, double last_time)   */
+/************************************************************************************/
+std::future<void> EphemerisCache::prefetch(size_t body, double first_time, double last_time) {
+  if (body >= _num_bodies)
+    throw std::out_of_range("EphemerisCache: invalid body index");
+
+  int64_t first_segment = int64_t(std::floor(first_time / _segment_length));
+  int64_t last_segment = int64_t(std::floor(last_time / _segment_length));
+  auto prefetch = std::make_shared<Prefetch>();
+  auto done = prefetch->done.get_future();
+  if (last_segment < first_segment) {
+    prefetch->done.set_value();
+    return done;
+  }
+
+  if (_workers.empty()) {
+    for (int64_t segment = first_segment; segment <= last_segment; segment++) {
+      Key key{ body, segment };
+      uint64_t generation;
+      if (!find(key, generation))
+        insert(key, fit(key), generation);
+    }
+    prefetch->done.set_value();
+    return done;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(_requests_mutex);
+    prefetch->pending = size_t(last_segment - first_segment + 1);
+    for (int64_t segment = first_segment; segment <= last_segment; segment++)
+      _requests.emplace_back(Key{ body, segment }, prefetch);
+  }
+  _requests_cv.notify_all();
+
+  return done;
+}
+
+
+/*   void clear()   */
+/********************/
+void EphemerisCache::clear() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _segments.clear();
+  _memory = 0;
+  ++_generation;
+}
+
+
+/*   size_t memoryUsage() const   */
+/**********************************/
+size_t EphemerisCache::memoryUsage() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _memory;
+}
+
+
+/*   size_t size() const   */
+/***************************/
+size_t EphemerisCache::size() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _segments.size();
+}
+
+
+/*   Coefficients fit(const Key& key) const   */
+/**********************************************/
+EphemerisCache::Coefficients EphemerisCache::fit(const Key& key) const {
+  // c(j) = 2/N * sum(k) f(t(k)) * T(j)(x(k)), where t(k) is the time of the node x(k) in the segment. c(0) is halved
+  const size_t N = _degree + 1;
+  auto coefficients = std::make_shared<std::vector<double>>(6 * N, 0.0);
+
+  const double half_length = 0.5 * _segment_length;
+  const double middle = key.second * _segment_length + half_length;
+  for (size_t k = 0; k < N; k++) {
+    State state = _propagator(key.first, middle + half_length * _nodes[k]);
+    const double values[6]{ state.first.x(), state.first.y(), state.first.z(), state.second.x(), state.second.y(), state.second.z() };
+    for (size_t j = 0; j < N; j++) {
+      for (size_t series = 0; series < 6; series++)
+        (*coefficients)[j * 6 + series] += values[series] * _cosines[j * N + k];
+    }
+  }
+
+  for (size_t j = 0; j < N; j++) {
+    for (size_t series = 0; series < 6; series++)
+      (*coefficients)[j * 6 + series] *= (j == 0 ? 1.0 : 2.0) / N;
+  }
+
+  return coefficients;
+}
+
+
+/*   Coefficients find(const Key& key, uint64_t& generation)   */
+/***************************************************************/
+EphemerisCache::Coefficients EphemerisCache::find(const Key& key, uint64_t& generation) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  generation = _generation;
+  auto segment = _segments.find(key);
+  if (segment == _segments.end())
+    return nullptr;
+
+  segment->second.last_use = ++_use_counter;
+  return segment->second.coefficients;
+}
+
+
+/*   Coefficients insert(const Key& key, Coefficients coefficients, uint64_t generation)   */
+/*******************************************************************************************/
+EphemerisCache::Coefficients EphemerisCache::insert(const Key& key, Coefficients coefficients, uint64_t generation) {
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  // The orbits may have changed since the segment was fitted
+  if (generation != _generation)
+    return coefficients;
+
+  // Another thread may have fitted the same segment in the meantime
+  auto segment = _segments.find(key);
+  if (segment != _segments.end()) {
+    segment->second.last_use = ++_use_counter;
+    return segment->second.coefficients;
+  }
+
+  _segments.emplace(key, Segment{ coefficients, ++_use_counter });
+  _memory += segmentMemory();
+
+  // Evict the least recently used segments: those used before the last use of the segment at 1/8 of the LRU order (the new one is never evicted)
+  if (_memory > _memory_budget && _segments.size() > 1) {
+    _evict_buffer.clear();
+    for (auto& entry : _segments)
+      _evict_buffer.push_back(entry.second.last_use);
+    auto limit = _evict_buffer.begin() + std::max(size_t(1), _evict_buffer.size() / 8) - 1;
+    std::nth_element(_evict_buffer.begin(), limit, _evict_buffer.end());
+    const uint64_t last_use_limit = std::min(*limit, _use_counter - 1);
+
+    for (auto entry = _segments.begin(); entry != _segments.end(); ) {
+      if (entry->second.last_use <= last_use_limit) {
+        entry = _segments.erase(entry);
+        _memory -= segmentMemory();
+      }
+      else
+        ++entry;
+    }
+  }
+
+  return coefficients;
+}
+
+
+/*   void work()   */
+/*******************/
+void EphemerisCache::work() {
+  while (true) {
+    std::pair<Key, std::shared_ptr<Prefetch>> request;
+    {
+      std::unique_lock<std::mutex> lock(_requests_mutex);
+      _requests_cv.wait(lock, [this] { return _stop || !_requests.empty(); });
+      if (_stop)
+        return;
+      request = std::move(_requests.front());
+      _requests.pop_front();
+    }
+
+    // Errors in the propagator are reported when the segment is evaluated, since it is fitted again
+    uint64_t generation;
+    if (!find(request.first, generation)) {
+      try {
+        insert(request.first, fit(request.first), generation);
+      }
+      catch (...) {
+      }
+    }
+
+    bool done;
+    {
+      std::lock_guard<std::mutex> lock(_requests_mutex);
+      done = (--request.second->pending == 0);
+    }
+    if (done)
+      request.second->done.set_value();
+  }
+}
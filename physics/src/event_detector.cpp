@@ -0,0 +1,161 @@
+#include <physics/event_detector.h>
+
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+
+#include <Eigen/Geometry>
+
+using namespace physics;
+using namespace physics::units;
+using namespace geometry;
+
+
+/**
+  *  \brief  Maximum iterations of the root finding, and width of the bracket (relative to the interval) which stops it
+  */
+static constexpr size_t ROOT_ITERATIONS{ 100 };
+static constexpr double ROOT_TOLERANCE{ 1e-12 };
+
+
+/*   std::string eventName(Type type, bool rising)   */
+/*****************************************************/
+std::string EventDetector::eventName(Type type, bool rising) {
+  switch (type) {
+  case APSIS:
+    return rising ? "PERIAPSIS" : "APOAPSIS";
+  case SOI:
+    return rising ? "SOI EXIT" : "SOI ENTRY";
+  case DISTANCE:
+    return rising ? "DISTANCE ABOVE" : "DISTANCE BELOW";
+  case CONJUNCTION:
+    return "CONJUNCTION";
+  default:
+    return rising ? "ECLIPSE END" : "ECLIPSE START";
+  }
+}
+
+
+/*   void detect(...)   */
+/***********************/
+void EventDetector::detect(const std::vector<Definition>& definitions,
+                           const std::vector<Vec3<LENGTH_T>>& positions_0, const std::vector<Vec3<SPEED_T>>& velocities_0,
+                           const std::vector<Vec3<LENGTH_T>>& positions_1, const std::vector<Vec3<SPEED_T>>& velocities_1,
+                           const std::vector<LENGTH_T>& radii, double interval, std::vector<Event>& events) {
+  const size_t num_bodies = positions_0.size();
+  if (velocities_0.size() != num_bodies || positions_1.size() != num_bodies || velocities_1.size() != num_bodies || radii.size() != num_bodies)
+    throw std::invalid_argument("EventDetector: the number of states and radii do not match");
+  for (const Definition& definition : definitions) {
+    if (definition.body >= num_bodies || (definition.type != APSIS && definition.other >= num_bodies) ||
+        (definition.type != SOI && definition.type != DISTANCE && definition.reference >= num_bodies))
+      throw std::invalid_argument("EventDetector: an event uses a body which does not exist");
+  }
+
+  // Trajectories, in Hermite form converted to cubic polynomials
+  _trajectories.resize(num_bodies);
+  for (size_t body = 0; body < num_bodies; body++) {
+    const Vec3<LENGTH_T>& p0 = positions_0[body];
+    const Vec3<LENGTH_T>& p1 = positions_1[body];
+    const Vec3<LENGTH_T> m0 = velocities_0[body] * interval;
+    const Vec3<LENGTH_T> m1 = velocities_1[body] * interval;
+    _trajectories[body] = Trajectory{ 2 * p0 + m0 - 2 * p1 + m1, -3 * p0 - 2 * m0 + 3 * p1 - m1, m0, p0 };
+  }
+
+  const size_t first_event = events.size();
+  _values.resize(_samples + 1);
+  for (size_t index = 0; index < definitions.size(); index++) {
+    const Definition& definition = definitions[index];
+    for (size_t sample = 0; sample <= _samples; sample++)
+      _values[sample] = value(definition, radii, double(sample) / _samples);
+
+    // Every sign change brackets a root (0 is positive)
+    for (size_t sample = 0; sample < _samples; sample++) {
+      const double value_0 = _values[sample];
+      const double value_1 = _values[sample + 1];
+      if ((value_0 < 0) == (value_1 < 0))
+        continue;
+
+      const double s = root(definition, radii, double(sample) / _samples, value_0, double(sample + 1) / _samples, value_1);
+
+      // The roots of the conjunction function are also the oppositions
+      if (definition.type == CONJUNCTION) {
+        const Vec3<LENGTH_T> reference = _trajectories[definition.reference].at(s);
+        if ((_trajectories[definition.body].at(s) - reference).dot(_trajectories[definition.other].at(s) - reference) < 0)
+          continue;
+      }
+
+      events.push_back(Event{ index, s * interval, value_0 < 0 });
+    }
+  }
+
+  std::sort(events.begin() + first_event, events.end(), [](const Event& event_1, const Event& event_2) { return event_1.time < event_2.time; });
+}
+
+
+/*   double value(const Definition& definition, const std::vector<LENGTH_T>& radii, double s) const   */
+/******************************************************************************************************/
+double EventDetector::value(const Definition& definition, const std::vector<LENGTH_T>& radii, double s) const {
+  const Vec3<LENGTH_T> position = _trajectories[definition.body].at(s);
+
+  switch (definition.type) {
+  case APSIS: {
+    // The derivative with respect to s is proportional to the velocity
+    const Trajectory& reference = _trajectories[definition.reference];
+    const Vec3<LENGTH_T> relative = position - reference.at(s);
+    return relative.dot(_trajectories[definition.body].derivative(s) - reference.derivative(s)) / relative.squaredNorm();
+  }
+  case SOI:
+  case DISTANCE:
+    return (_trajectories[definition.other].at(s) - position).norm() - definition.distance;
+  case CONJUNCTION: {
+    const Vec3<LENGTH_T> reference = _trajectories[definition.reference].at(s);
+    const Vec3<LENGTH_T> body = position - reference;
+    const Vec3<LENGTH_T> other = _trajectories[definition.other].at(s) - reference;
+    const double projections = std::sqrt((body.x() * body.x() + body.y() * body.y()) * (other.x() * other.x() + other.y() * other.y()));
+    return projections > 0 ? (body.x() * other.y() - body.y() * other.x()) / projections : 0;
+  }
+  case ECLIPSE: {
+    const Vec3<LENGTH_T> occulter = _trajectories[definition.other].at(s) - position;
+    const Vec3<LENGTH_T> source = _trajectories[definition.reference].at(s) - position;
+    const LENGTH_T l_occulter = occulter.norm();
+    const LENGTH_T l_source = source.norm();
+    const double angle = std::atan2(occulter.cross(source).norm(), occulter.dot(source));
+    const double apparent_radii = std::asin(std::min(1.0, radii[definition.other] / l_occulter)) + std::asin(std::min(1.0, radii[definition.reference] / l_source));
+    // An occulter behind the light source does not eclipse it
+    return l_occulter < l_source ? angle - apparent_radii : angle + apparent_radii;
+  }
+  }
+  return 0;
+}
+
+
+/*   double root(...) const   */
+/******************************/
+double EventDetector::root(const Definition& definition, const std::vector<LENGTH_T>& radii, double s_0, double value_0, double s_1, double value_1) const {
+  // Illinois method: regula falsi, halving the value kept at the same end of the bracket twice in a row (superlinear convergence)
+  int side{ 0 };
+  double s = s_0;
+  for (size_t iteration = 0; iteration < ROOT_ITERATIONS; iteration++) {
+    s = (s_0 * value_1 - s_1 * value_0) / (value_1 - value_0);
+    if (s_1 - s_0 < ROOT_TOLERANCE)
+      break;
+
+    const double value_s = value(definition, radii, s);
+    if ((value_s < 0) == (value_1 < 0)) {
+      s_1 = s;
+      value_1 = value_s;
+      if (side == -1)
+        value_0 /= 2;
+      side = -1;
+    }
+    else {
+      s_0 = s;
+      value_0 = value_s;
+      if (side == 1)
+        value_1 /= 2;
+      side = 1;
+    }
+  }
+
+  return s;
+}
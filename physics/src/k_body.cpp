@@ -1,5 +1,9 @@
 #include <physics/k_body.h>
 
+#include <algorithm>
+#include <numeric>
+#include <limits>
+
 #include <files/properties_file_reader.h>
 #include <logger.h>
 
@@ -15,7 +19,6 @@ static const std::string  __PROPS_FILE_NAME__{ "config/body.cfg" }; /**< Locatio
 
 
 bool KBody::_initialized{ false };
-bool KBody::_barycenters_set{ false };
 double KBody::_barycenter_ratio_limit{ 0 };
 
 
@@ -30,7 +33,42 @@ void KBody::initialize() {
 }
 
 
-void KBody::barycenters(tree::MTree<KBody>& bodies) {
+KBody::Context::Context() {
+  // Read properties file
+  utils::PropertiesFileReader properties(__PROPS_FILE_NAME__);
+
+  // Initialize variables
+  _pool = std::make_unique<utils::ThreadPool>(properties.property<size_t>("THREADS"));
+
+  auto integrator = std::find(INTEGRATOR_NAME.begin(), INTEGRATOR_NAME.end(), properties.property("INTEGRATOR"));
+  if (integrator == INTEGRATOR_NAME.end())
+    throw std::invalid_argument("Invalid INTEGRATOR: " + properties.property("INTEGRATOR"));
+  _integrator = Integrator(integrator - INTEGRATOR_NAME.begin());
+
+  _minor_bodies_interaction = properties.property<int>("MINOR_BODIES_INTERACTION") != 0;
+  _octree.openingAngle(properties.property<double>("OPENING_ANGLE"));
+  _lazy_passive_bodies = properties.property<int>("LAZY_PASSIVE_BODIES") != 0;
+  _ephemeris_segment_length = units::TIME_T{ properties.property<int64_t>("PASSIVE_EPHEMERIS_SEGMENT") };
+  _ephemeris_degree = properties.property<size_t>("PASSIVE_EPHEMERIS_DEGREE");
+  _ephemeris_memory = properties.property<size_t>("PASSIVE_EPHEMERIS_MEMORY") * 1024 * 1024;
+
+  _perturbation_threshold = properties.property<double>("PERTURBATION_THRESHOLD");
+  _hill_radii = properties.property<double>("HILL_RADII");
+  _interaction_window = units::TIME_T{ properties.property<int64_t>("INTERACTION_WINDOW") };
+  _rectification_threshold = properties.property<double>("RECTIFICATION_THRESHOLD");
+  _encounter_hill_radii = properties.property<double>("ENCOUNTER_HILL_RADII");
+  _encounter_integrator = DormandPrince(properties.property<double>("ENCOUNTER_TOLERANCE"));
+
+  _steps_per_orbit = properties.property<double>("STEPS_PER_ORBIT");
+  //      The maximum step is rounded down to a power of 2
+  size_t max_step_ticks = properties.property<size_t>("MAX_STEP_TICKS");
+  _max_step_ticks = 1;
+  while (_max_step_ticks * 2 <= max_step_ticks)
+    _max_step_ticks *= 2;
+}
+
+
+void KBody::Context::barycenters(tree::MTree<KBody>& bodies) {
   // Barycenter of the main star and the perturbator bodies
   barycenter(bodies, bodies.root());
 
@@ -60,10 +98,182 @@ void KBody::barycenters(tree::MTree<KBody>& bodies) {
     }
   }
 
+  // Once the CS is inertial, the orbits can be propagated in batch
+  bindBatch(bodies);
+
   _barycenters_set = true;
 }
 
 
+void KBody::Context::bindBatch(tree::MTree<KBody>& bodies) {
+  _batch.clear();
+  _batch_bodies.clear();
+  _batch_families.clear();
+  _batch_perturbators.clear();
+  _batch_minor_bodies.clear();
+  _minor_masses.clear();
+  _batch_steps.clear();
+  _family_steps.clear();
+  _lazy_bodies.clear();
+
+  //      Passive bodies are not propagated in the batch: their state is calculated on demand (see state())
+  auto passive = [this, &bodies](KBody& body) {
+    body._lazy = _lazy_passive_bodies && body.TYPE == MINOR_BODY && !body._parent_perturbator && !bodies.children(body.matchingKey()).hasNext();
+    if (body._lazy)
+      _lazy_bodies.push_back(&body);
+    return body._lazy;
+  };
+
+  //      1. First level under the root body, sorted by step. With the WISDOM_HOLMAN and ENCKE integrators they are kicked in every tick, so their step is always 1
+  //         (the ships are not propagated in the batch)
+  std::vector<KBody*> level_bodies;
+  auto iter = bodies.children(bodies.root().matchingKey());
+  while (iter.hasNext()) {
+    auto& body = iter.next();
+    if (body.TYPE == SHIP)
+      continue;
+    body._lazy = false;
+    if (_integrator == KEPLER && passive(body))
+      continue;
+    body._step_ticks = (_integrator == KEPLER) ? scheduleStep(*body._orbit) : 1;
+    level_bodies.push_back(&body);
+  }
+  std::stable_sort(level_bodies.begin(), level_bodies.end(), [](const KBody* body_1, const KBody* body_2) { return body_1->_step_ticks < body_2->_step_ticks; });
+
+  for (KBody* body : level_bodies) {
+    body->_batch_slot = _batch.add(*body->_orbit);
+    if (body->_parent_perturbator)
+      _batch_perturbators.push_back(_batch_bodies.size());
+    else if (body->TYPE == MINOR_BODY || body->TYPE == DWARF_PLANET) {
+      _batch_minor_bodies.push_back(_batch_bodies.size());
+      _minor_masses.push_back(body->reduced_mass);
+    }
+    _batch_bodies.push_back(body);
+    _batch_steps.push_back(body->_step_ticks);
+  }
+  _batch_first_level = _batch_bodies.size();
+  _kicks.resize(_batch_first_level);
+  _deviations.resize(_batch_first_level);
+  _encounters.assign(_batch_first_level, nullptr);
+  _last_encounters.assign(_batch_first_level, nullptr);
+  _encounter_states.resize(_batch_first_level);
+  _encounter_steps.assign(_batch_first_level, 0.0);
+  _encounter_failures.assign(_batch_first_level, 0);
+  _interactions.resize(_batch_first_level);
+  _interactions_set = false;
+  _minor_positions.resize(_batch_minor_bodies.size());
+
+  //      The deviations from the reference orbits are taken from the current state of the bodies (ENCKE). With the WISDOM_HOLMAN integrator the orbits 
+  //      are recalculated in democratic heliocentric coordinates: position relative to the root body, barycentric velocity and the mass of the root body 
+  //      (see kick()). A state which is not bound to the root body is kept as a deviation from the orbit
+  for (size_t index = 0; index < _batch_first_level; index++) {
+    KBody* body = _batch_bodies[index];
+    Deviation& deviation = _deviations[index];
+    deviation = Deviation{ Vec3<units::LENGTH_T>{ 0.0, 0.0, 0.0 }, Vec3<units::SPEED_T>{ 0.0, 0.0, 0.0 } };
+    if (_integrator == KEPLER)
+      continue;
+
+    Vec3<units::LENGTH_T> position = body->_position.vec() - body->_parent->_position.vec();
+    Vec3<units::SPEED_T> velocity = body->_velocity;
+    if (_integrator == ENCKE)
+      velocity -= body->_parent->_velocity;
+    if (_integrator == WISDOM_HOLMAN && 0.5 * velocity.squaredNorm() < body->_parent->reduced_mass / position.norm()) {
+      body->_orbit->conic(body->_parent->reduced_mass, position, velocity, _time);
+      _batch.load(body->_batch_slot, *body->_orbit);
+    }
+    else
+      deviation = Deviation{ position - body->_orbit->position().vec(), velocity - body->_orbit->velocity() };
+  }
+
+  //      2. Second level under the root body, grouped by family. The families are sorted by the step of their fastest body
+  std::vector<std::pair<size_t, KBody*>> families;
+  for (KBody* body : level_bodies) {
+    size_t family_step = _max_step_ticks;
+    bool family{ false };
+    auto iter_children = bodies.children(body->matchingKey());
+    while (iter_children.hasNext()) {
+      auto& child_body = iter_children.next();
+      if (child_body.TYPE == SHIP || passive(child_body))
+        continue;
+      family_step = std::min(family_step, scheduleStep(*child_body._orbit));
+      family = true;
+    }
+    if (family)
+      families.emplace_back(family_step, body);
+  }
+  std::stable_sort(families.begin(), families.end(), [](const auto& family_1, const auto& family_2) { return family_1.first < family_2.first; });
+
+  for (auto& family : families) {
+    size_t family_first = _batch_bodies.size();
+    auto iter_children = bodies.children(family.second->matchingKey());
+    while (iter_children.hasNext()) {
+      auto& child_body = iter_children.next();
+      if (child_body.TYPE == SHIP || child_body._lazy)
+        continue;
+      child_body._step_ticks = family.first;
+      child_body._batch_slot = _batch.add(*child_body._orbit);
+      _batch_bodies.push_back(&child_body);
+    }
+    _batch_families.emplace_back(family_first, _batch_bodies.size());
+    _family_steps.push_back(family.first);
+  }
+
+  //      3. Ships, at any level, and the bodies whose sphere of influence can capture them. All the bodies are bound to the context
+  _ships.clear();
+  _soi_bodies.clear();
+  auto iter_all = bodies.begin();
+  while (iter_all.hasNext()) {
+    auto& body = iter_all.next();
+    body._context = this;
+    if (body.TYPE == SHIP)
+      _ships.push_back(&body);
+    else if (body._parent && (body.TYPE == PLANET || body.TYPE == DWARF_PLANET || body.TYPE == SATELLITE || body.TYPE == STAR))
+      _soi_bodies[body._parent].push_back(&body);
+  }
+  _ship_transitions.resize(_ships.size());
+
+  //      4. Ephemerides of the passive bodies with bounded orbits, long enough to be interpolated in segments
+  _ephemeris.reset();
+  std::vector<const KeplerOrbit*> ephemeris_orbits;
+  for (KBody* body : _lazy_bodies) {
+    body->_ephemeris_index = NO_EPHEMERIS;
+    if (_ephemeris_segment_length.count() > 0 && body->_orbit->bound() && 
+        body->_orbit->period().count() >= EPHEMERIS_SEGMENTS_PER_ORBIT * _ephemeris_segment_length.count()) {
+      body->_ephemeris_index = ephemeris_orbits.size();
+      ephemeris_orbits.push_back(body->_orbit.get());
+    }
+  }
+  if (ephemeris_orbits.size()) {
+    auto propagator = [ephemeris_orbits](size_t index, double time) {
+      auto state = ephemeris_orbits[index]->stateAt(time);
+      return EphemerisCache::State{ state.first.vec(), state.second };
+    };
+    _ephemeris = std::make_unique<EphemerisCache>(ephemeris_orbits.size(), propagator, _ephemeris_segment_length, _ephemeris_degree, _ephemeris_memory);
+    _ephemeris_segment = std::numeric_limits<int64_t>::min();
+  }
+
+  if (_lazy_bodies.size()) {
+    DebugLog(_lazy_bodies.size() << " passive bodies calculated on demand (" << ephemeris_orbits.size() << " interpolated)");
+  }
+
+  _ticks = 0;
+  _synchronized = std::all_of(_batch_bodies.begin(), _batch_bodies.end(), [this](const KBody* body) { return body->_orbit->time() == _time; });
+}
+
+
+size_t KBody::Context::scheduleStep(const KeplerOrbit& orbit) {
+  if (_schedule_tick.count() <= 0 || !(orbit.e() < 1))
+    return 1;
+
+  double max_step = double(orbit.period().count()) / (_steps_per_orbit * double(_schedule_tick.count()));
+  size_t step = 1;
+  while (step * 2 <= _max_step_ticks && step * 2 <= max_step)
+    step *= 2;
+
+  return step;
+}
+
+
 void KBody::barycenter(tree::MTree<KBody>& bodies, KBody& parent_body) {
   // Barycenter position and velocity are defined as:
   //      Bpos = sum(m(i) / M * r(i)); 
@@ -106,40 +316,889 @@ void KBody::barycenter(tree::MTree<KBody>& bodies, KBody& parent_body) {
 }
 
 
-void KBody::gravInteraction(tree::MTree<KBody>& bodies, const units::TIME_T& delta_t) {
-  // *********************************************************************************************
-  // APPROXIMATION 0 : Interaction only with the parent body, according to its Keplerian orbit 
-  // *********************************************************************************************
-  // Nothing to do: new position and velocity can be calculated during the execution of the movement
-  //      1. First level under the root body
-  auto iter = bodies.children(bodies.root().matchingKey());
+void KBody::Context::gravInteraction(tree::MTree<KBody>& bodies, const units::TIME_T& delta_t) {
+  if (!_barycenters_set)
+    throw std::runtime_error("Barycenters not set. Bodies can't be moved");
+
+  // The bodies are moved from the state of their last move, not from the states placed to read them
+  unplaceLagging(bodies);
+
+  // The steps depend on the tick: whenever it changes, all the bodies are moved to the current time and the steps are assigned again
+  if (delta_t != _schedule_tick) {
+    if (!_synchronized) {
+      move(bodies, _time, _batch_first_level, _batch_families.size());
+      moveShips(bodies);
+    }
+    _schedule_tick = delta_t;
+    bindBatch(bodies);
+  }
+
+  // Bodies due in this tick: those whose step divides the number of ticks. Since the steps are powers of 2, sorted in the batch, 
+  //    they are the first bodies with step <= the greatest power of 2 dividing the number of ticks
+  ++_ticks;
+  size_t due_step = size_t(_ticks & (~_ticks + 1));
+  size_t level_1_due = std::upper_bound(_batch_steps.begin(), _batch_steps.end(), due_step) - _batch_steps.begin();
+  size_t families_due = std::upper_bound(_family_steps.begin(), _family_steps.end(), due_step) - _family_steps.begin();
+  _synchronized = (level_1_due == _batch_first_level && families_due == _batch_families.size());
+
+  if (_integrator != KEPLER) {
+    if (!_interactions_set || std::chrono::abs(_time - _interactions_time) >= _interaction_window)
+      updateInteractions();
+    if (_encounter_hill_radii > 0)
+      detectEncounters();
+
+    // Kick (half tick) - Drift (Kepler orbits, whole tick) - Kick (half tick)
+    //      With the WISDOM_HOLMAN integrator each kick includes the linear drift of the positions relative to the root body (see kick())
+    //      With the ENCKE integrator the deviations drift with the reference orbits, and the orbits are rectified after the kick if they have grown too much
+    //      The bodies in a close encounter are not kicked: they are integrated through the whole tick
+    kick(0.5 * delta_t.count(), true);
+    move(bodies, _time + delta_t, level_1_due, families_due);
+    if (_integrator == ENCKE)
+      drift(double(delta_t.count()));
+    kick(0.5 * delta_t.count(), false);
+    if (_integrator == ENCKE)
+      rectify(false);
+    if (_encounter_hill_radii > 0)
+      integrateEncounters(double(delta_t.count()));
+    placeFirstLevel();
+  }
+  else
+    move(bodies, _time + delta_t, level_1_due, families_due);
+
+  moveShips(bodies);
+
+  // When the time enters a new segment of the ephemerides, the next segment of the passive bodies is fitted in the background
+  if (_ephemeris) {
+    int64_t segment = _time.count() / _ephemeris_segment_length.count();
+    if (segment != _ephemeris_segment) {
+      _ephemeris_segment = segment;
+      double next_segment = double((segment + 1) * _ephemeris_segment_length.count());
+      for (size_t index = 0; index < _ephemeris->numBodies(); index++)
+        _ephemeris->prefetch(index, next_segment, next_segment);
+    }
+  }
+}
+
+
+void KBody::Context::synchronize(tree::MTree<KBody>& bodies) {
+  if (!_barycenters_set)
+    return;
+
+  if (!_synchronized && !_placed)
+    placeLagging(bodies);
+}
+
+
+void KBody::Context::placeLagging(tree::MTree<KBody>& bodies) {
+  // The states of the bodies are saved, so they can be restored before the bodies are moved again (see unplaceLagging())
+  KBody& root = bodies.root();
+  _saved_states.clear();
+  _saved_states.emplace_back(root._position, root._velocity);
+  for (const KBody* body : _batch_bodies)
+    _saved_states.emplace_back(body->_position, body->_velocity);
+  for (const KBody* ship : _ships)
+    _saved_states.emplace_back(ship->_position, ship->_velocity);
+  _placed = true;
+
+  // The states of the lagging orbits are calculated at the current time, without moving (or recalculating) the orbits, so the next moves 
+  //    do not depend on when the bodies were synchronized
+  auto orbitState = [this](const KBody* body) {
+    if (body->_orbit->time() == _time)
+      return std::make_pair(body->_orbit->position(), body->_orbit->velocity());
+    return body->_orbit->stateAt(_time);
+  };
+  auto place = [this, &orbitState](KBody* body) {
+    auto state = orbitState(body);
+    body->_position = body->_parent->_position + state.first.vec();
+    body->_velocity = body->_parent->_velocity + state.second;
+  };
+
+  //      1. First level bodies (KEPLER: with the WISDOM_HOLMAN and ENCKE integrators they are moved in every tick). The change of the orbits of the 
+  //         perturbators since their last move is applied to them and to the root body, then the rest of the bodies are placed relative to the root body
+  if (_integrator == KEPLER) {
+    for (size_t index : _batch_perturbators) {
+      KBody* body = _batch_bodies[index];
+      if (body->_orbit->time() != _time) {
+        auto state = body->_orbit->stateAt(_time);
+        body->applyOrbitChange({ state.first.vec() - body->_orbit->position().vec(), state.second - body->_orbit->velocity() });
+      }
+    }
+    parallelFor(0, _batch_first_level, [this, &place](size_t first, size_t last) {
+      for (size_t index = first; index < last; index++) {
+        if (!_batch_bodies[index]->_parent_perturbator)
+          place(_batch_bodies[index]);
+      }
+    });
+  }
+
+  //      2. Second level bodies, relative to their parents
+  parallelFor(0, _batch_families.size(), [this, &place](size_t first, size_t last) {
+    for (size_t family = first; family < last; family++) {
+      for (size_t index = _batch_families[family].first; index < _batch_families[family].second; index++) {
+        if (!_batch_bodies[index]->_parent_perturbator)
+          place(_batch_bodies[index]);
+      }
+    }
+  }, 1);
+
+  //      3. Ships (moved in every tick), relative to their parents
+  parallelFor(0, _ships.size(), [this, &place](size_t first, size_t last) {
+    for (size_t index = first; index < last; index++)
+      place(_ships[index]);
+  });
+}
+
+
+void KBody::Context::unplaceLagging(tree::MTree<KBody>& bodies) {
+  if (!_placed)
+    return;
+
+  size_t index{ 0 };
+  KBody& root = bodies.root();
+  root._position = _saved_states[index].first;
+  root._velocity = _saved_states[index++].second;
+  for (KBody* body : _batch_bodies) {
+    body->_position = _saved_states[index].first;
+    body->_velocity = _saved_states[index++].second;
+  }
+  for (KBody* ship : _ships) {
+    ship->_position = _saved_states[index].first;
+    ship->_velocity = _saved_states[index++].second;
+  }
+  _placed = false;
+}
+
+
+std::pair<PBody::PositionType, PBody::VelocityType> KBody::state() const {
+  if (!_context || ((_context->_synchronized || _context->_placed) && !_lazy))
+    return { _position, _velocity };
+
+  // The lagging bodies are calculated at the current time as they would be placed (see placeLagging()), without the rest of the bodies. The 
+  //    orbits are not moved
+  //      1. Root body: the change of the orbits of the lagging perturbators since their last move
+  if (!_parent) {
+    PositionType position{ _position };
+    VelocityType velocity{ _velocity };
+    for (size_t index : _context->_batch_perturbators) {
+      const KBody* body = _context->_batch_bodies[index];
+      if (body->_orbit->time() != _context->_time) {
+        auto orbit_state = body->_orbit->stateAt(_context->_time);
+        auto pair_mass = reduced_mass + body->reduced_mass;
+        position -= body->reduced_mass / pair_mass * (orbit_state.first.vec() - body->_orbit->position().vec());
+        velocity -= body->reduced_mass / pair_mass * (orbit_state.second - body->_orbit->velocity());
+      }
+    }
+    return { position, velocity };
+  }
+
+  //      2. First level bodies with the WISDOM_HOLMAN and ENCKE integrators (moved in every tick) and second level perturbators (not placed)
+  if ((_context->_integrator != KEPLER && !_parent->_parent && !_lazy) || (_parent_perturbator && _parent->_parent))
+    return { _position, _velocity };
+
+  std::pair<PositionType, VelocityType> orbit_state;
+  if (_ephemeris_index != NO_EPHEMERIS) {
+    auto interpolated = _context->_ephemeris->evaluate(_ephemeris_index, double(_context->_time.count()));
+    orbit_state = { PositionType{ interpolated.first }, interpolated.second };
+  }
+  else
+    orbit_state = (_orbit->time() == _context->_time) ? std::make_pair(_orbit->position(), _orbit->velocity()) : _orbit->stateAt(_context->_time);
+
+  //      3. First level perturbators (KEPLER): the change of their orbits since their last move (see applyOrbitChange())
+  if (_parent_perturbator) {
+    auto pair_mass = _parent->reduced_mass + reduced_mass;
+    return { PositionType{ _position.vec() + _parent->reduced_mass / pair_mass * (orbit_state.first.vec() - _orbit->position().vec()) },
+             _velocity + _parent->reduced_mass / pair_mass * (orbit_state.second - _orbit->velocity()) };
+  }
+
+  //      4. Rest of the bodies (and passive bodies): their orbits relative to their parents (which are never passive)
+  auto parent_state = _parent->state();
+  return { PositionType{ parent_state.first.vec() + orbit_state.first.vec() }, parent_state.second + orbit_state.second };
+}
+
+
+std::pair<PBody::PositionType, PBody::VelocityType> KBody::stateAt(double time) const {
+  auto current = state();
+  if (!_context || time == double(_context->_time.count()))
+    return current;
+
+  auto change = stateChange(time);
+  return { PositionType{ current.first.vec() + change.first }, current.second + change.second };
+}
+
+
+std::pair<Vec3<units::LENGTH_T>, Vec3<units::SPEED_T>> KBody::stateChange(double time) const {
+  // Change of an orbit between the current time and the time
+  auto orbit_change = [this, time](const KeplerOrbit& orbit) {
+    auto orbit_state = orbit.stateAt(time);
+    auto current_state = (orbit.time() == _context->_time) ? std::make_pair(orbit.position(), orbit.velocity()) : orbit.stateAt(_context->_time);
+    return std::make_pair(Vec3<units::LENGTH_T>{ orbit_state.first.vec() - current_state.first.vec() }, Vec3<units::SPEED_T>{ orbit_state.second - current_state.second });
+  };
+  //      With the WISDOM_HOLMAN integrator the positions relative to the root body also drift with the momentum of the perturbators (see kick())
+  const Vec3<units::LENGTH_T> linear_drift = (_context->_integrator == WISDOM_HOLMAN) ? Vec3<units::LENGTH_T>{ _context->driftVelocity(false) * (time - double(_context->_time.count())) } : 
+                                                                             Vec3<units::LENGTH_T>{ 0.0, 0.0, 0.0 };
+
+  //      1. Root body: it moves around the barycenter with its perturbators (pairwise with the KEPLER integrator, see state(); all together 
+  //         with the WISDOM_HOLMAN and ENCKE integrators, see placeFirstLevel())
+  if (!_parent) {
+    Vec3<units::LENGTH_T> position{ 0.0, 0.0, 0.0 };
+    Vec3<units::SPEED_T> velocity{ 0.0, 0.0, 0.0 };
+    units::REDUCED_MASS_T total_mass{ reduced_mass };
+    for (size_t index : _context->_batch_perturbators) {
+      const KBody* body = _context->_batch_bodies[index];
+      auto change = orbit_change(*body->_orbit);
+      if (_context->_integrator == KEPLER) {
+        auto ratio = body->reduced_mass / (reduced_mass + body->reduced_mass);
+        position -= ratio * change.first;
+        velocity -= ratio * change.second;
+      }
+      else {
+        total_mass += body->reduced_mass;
+        position -= body->reduced_mass * (change.first + linear_drift);
+        velocity -= body->reduced_mass * change.second;
+      }
+    }
+    if (_context->_integrator != KEPLER) {
+      position /= total_mass;
+      velocity /= (_context->_integrator == WISDOM_HOLMAN) ? reduced_mass : total_mass;
+    }
+    return { position, velocity };
+  }
+
+  auto parent_change = _parent->stateChange(time);
+  auto change = orbit_change(*_orbit);
+
+  //      2. First level bodies with the WISDOM_HOLMAN and ENCKE integrators: placed relative to the root body (see placeFirstLevel())
+  if (_context->_integrator != KEPLER && !_parent->_parent && !_lazy) {
+    if (_context->_integrator == WISDOM_HOLMAN)
+      return { parent_change.first + change.first + linear_drift, change.second };
+    return { parent_change.first + change.first, parent_change.second + change.second };
+  }
+
+  //      3. Rest of the bodies: the change of the state of the parent plus the change of the orbit relative to it
+  return { parent_change.first + change.first, parent_change.second + change.second };
+}
+
+
+void KBody::Context::states(const std::vector<const KBody*>& bodies, std::vector<std::pair<PositionType, VelocityType>>& states) {
+  states.resize(bodies.size());
+  parallelFor(0, bodies.size(), [&bodies, &states](size_t first, size_t last) {
+    for (size_t index = first; index < last; index++)
+      states[index] = bodies[index]->state();
+  });
+}
+
+
+void KBody::Context::kick(double delta_t, bool first_half) {
+  // WISDOM_HOLMAN: democratic heliocentric coordinates (positions relative to the root body, barycentric velocities), which are canonical, so the 
+  //      integrator is symplectic. The Hamiltonian is split in the Kepler orbits around the mass of the root body, the interactions and the 
+  //      momentum of the root body, which drifts the positions linearly: dr = sum(m(j) * v(j)) / m(root) * dt. Each kick is combined with this 
+  //      linear drift: before the kick in the first half of the tick, after the kick (with the new momentum) in the second half
+  const bool democratic = (_integrator == WISDOM_HOLMAN);
+  if (democratic && first_half)
+    _linear_drift = driftVelocity(false) * delta_t;
+  else
+    _linear_drift.setZero();
+
+  // Accelerations caused by the first level perturbators: 
+  //      a(i) = sum(j != i) Gm(j) * [ (r(j) - r(i)) / |r(j) - r(i)|^3 - r(j) / |r(j)|^3 ]
+  //      The second (indirect) term is the acceleration of the root body, since the heliocentric CS is not inertial (ENCKE). It is not needed with 
+  //      barycentric velocities (WISDOM_HOLMAN)
+  //      Only the perturbators in the interaction list of each body are evaluated
+  parallelFor(0, _batch_first_level, [this, delta_t, democratic](size_t first, size_t last) {
+    for (size_t index = first; index < last; index++) {
+      Vec3<units::LENGTH_T> position = _batch_bodies[index]->_orbit->position().vec() + _deviations[index].first + _linear_drift;
+      Vec3<units::ACCELERATION_T> acceleration{ 0.0, 0.0, 0.0 };
+      for (size_t pert_index : _interactions[index]) {
+        const KBody* perturbator = _batch_bodies[pert_index];
+        Vec3<units::LENGTH_T> pert_position = perturbator->_orbit->position().vec() + _deviations[pert_index].first + _linear_drift;
+        Vec3<units::LENGTH_T> distance = pert_position - position;
+        units::LENGTH_T l_distance = distance.norm();
+        acceleration += perturbator->reduced_mass * distance / (l_distance * l_distance * l_distance);
+        if (!democratic) {
+          units::LENGTH_T l_pert_position = pert_position.norm();
+          acceleration -= perturbator->reduced_mass * pert_position / (l_pert_position * l_pert_position * l_pert_position);
+        }
+      }
+      _kicks[index] = acceleration * delta_t;
+    }
+  });
+
+  // Mutual interaction of the minor bodies, approximated with the octree (rebuilt with the current positions)
+  if (_minor_bodies_interaction && _batch_minor_bodies.size() > 1) {
+    parallelFor(0, _batch_minor_bodies.size(), [this](size_t first, size_t last) {
+      for (size_t minor = first; minor < last; minor++)
+        _minor_positions[minor] = _batch_bodies[_batch_minor_bodies[minor]]->_orbit->position().vec() + _deviations[_batch_minor_bodies[minor]].first + _linear_drift;
+    });
+
+    _octree.build(_minor_positions, _minor_masses);
+
+    parallelFor(0, _batch_minor_bodies.size(), [this, delta_t](size_t first, size_t last) {
+      for (size_t minor = first; minor < last; minor++)
+        _kicks[_batch_minor_bodies[minor]] += _octree.acceleration(_minor_positions[minor], minor) * delta_t;
+    });
+  }
+
+  // The kicks change the deviations (ENCKE) or the orbits (WISDOM_HOLMAN) of the bodies which are not in a close encounter (see kickBody())
+  if (democratic && !first_half)
+    _linear_drift = driftVelocity(true) * delta_t;
+
+  parallelFor(0, _batch_first_level, [this, delta_t](size_t first, size_t last) {
+    for (size_t index = first; index < last; index++) {
+      if (!_encounters[index])
+        kickBody(index, _kicks[index], _linear_drift, delta_t);
+    }
+  });
+}
+
+
+void KBody::Context::kickBody(size_t index, const Vec3<units::SPEED_T>& kick, const Vec3<units::LENGTH_T>& linear_drift, double delta_t) {
+  KBody* body = _batch_bodies[index];
+  Deviation& deviation = _deviations[index];
+
+  // With the ENCKE integrator the kicks change the deviations only, adding the difference between the attraction of the root body at the true position 
+  //      (r = r_ref + dr) and at the reference position:  mu / r_ref^3 * (f(q) * r - dr),  where f(q) = 1 - (r_ref / r)^3 is evaluated without 
+  //      cancellation (Battin): q = dr * (dr - 2r) / r^2,  f(q) = -q * (3 + 3q + q^2) / (1 + (1 + q)^(3/2))
+  if (_integrator == ENCKE) {
+    Vec3<units::LENGTH_T> ref_position = body->_orbit->position().vec();
+    Vec3<units::LENGTH_T> position = ref_position + deviation.first;
+    double q = deviation.first.dot(deviation.first - 2 * position) / position.squaredNorm();
+    double f = -q * (3 + q * (3 + q)) / (1 + std::pow(1 + q, 1.5));
+    units::LENGTH_T l_ref_position = ref_position.norm();
+    deviation.second += kick + body->_orbit->mu() / (l_ref_position * l_ref_position * l_ref_position) * (f * position - deviation.first) * delta_t;
+    deviation.first += linear_drift;
+    return;
+  }
+
+  // The kicks (and the linear drift) change the orbits only: the state of the bodies is set from the orbits after the whole tick (see placeFirstLevel()). 
+  //      If the new state is not bound to the root body, it is kept as a deviation from the orbit (see detectEncounters())
+  try {
+    body->_orbit->rectify(deviation.first + linear_drift, deviation.second + kick);
+    _batch.load(body->_batch_slot, *body->_orbit);
+    deviation.first.setZero();
+    deviation.second.setZero();
+  }
+  catch (const KeplerOrbit::ExcBodyNotBound&) {
+    deviation.first += linear_drift;
+    deviation.second += kick;
+  }
+}
+
+
+Vec3<units::SPEED_T> KBody::Context::driftVelocity(bool kicked) {
+  Vec3<units::SPEED_T> momentum{ 0.0, 0.0, 0.0 };
+  for (size_t index : _batch_perturbators) {
+    momentum += _batch_bodies[index]->reduced_mass * (_batch_bodies[index]->_orbit->velocity() + _deviations[index].second);
+    if (kicked)
+      momentum += _batch_bodies[index]->reduced_mass * _kicks[index];
+  }
+  return _batch_first_level ? Vec3<units::SPEED_T>{ momentum / _batch_bodies[0]->_parent->reduced_mass } : momentum;
+}
+
+
+void KBody::Context::drift(double delta_t) {
+  parallelFor(0, _batch_first_level, [this, delta_t](size_t first, size_t last) {
+    for (size_t index = first; index < last; index++)
+      _deviations[index].first += _deviations[index].second * delta_t;
+  });
+}
+
+
+void KBody::Context::rectify(bool all) {
+  parallelFor(0, _batch_first_level, [this, all](size_t first, size_t last) {
+    for (size_t index = first; index < last; index++) {
+      // The bodies in a close encounter are rectified at the end of their integration
+      if (!all && _encounters[index])
+        continue;
+      KBody* body = _batch_bodies[index];
+      Deviation& deviation = _deviations[index];
+      // While the true state is not bound to the root body (e.g. after a close encounter), it is kept as a deviation from the reference orbit
+      if (all || deviation.first.norm() > _rectification_threshold * body->_orbit->position().vec().norm()) {
+        try {
+          body->_orbit->rectify(deviation.first, deviation.second);
+          _batch.load(body->_batch_slot, *body->_orbit);
+          deviation.first.setZero();
+          deviation.second.setZero();
+        }
+        catch (const KeplerOrbit::ExcBodyNotBound&) {
+        }
+      }
+    }
+  });
+}
+
+
+void KBody::Context::detectEncounters() {
+  std::swap(_encounters, _last_encounters);
+
+  // The encounters are integrated relative to the root body: with the WISDOM_HOLMAN integrator the barycentric velocity is converted to heliocentric
+  const Vec3<units::SPEED_T> drift_velocity = (_integrator == WISDOM_HOLMAN) ? driftVelocity(false) : Vec3<units::SPEED_T>{ 0.0, 0.0, 0.0 };
+
+  parallelFor(0, _batch_first_level, [this, &drift_velocity](size_t first, size_t last) {
+    for (size_t index = first; index < last; index++) {
+      const KBody* body = _batch_bodies[index];
+      const KBody* encounter{ nullptr };
+      if (!body->_parent_perturbator) {
+        Vec3<units::LENGTH_T> position = body->_orbit->position().vec() + _deviations[index].first;
+        for (size_t pert_index : _interactions[index]) {
+          const KBody* perturbator = _batch_bodies[pert_index];
+          Vec3<units::LENGTH_T> pert_position = perturbator->_orbit->position().vec() + _deviations[pert_index].first;
+          if ((pert_position - position).norm() < _encounter_hill_radii * perturbator->hillRadius()) {
+            encounter = perturbator;
+            break;
+          }
+        }
+        // The WISDOM_HOLMAN integrator has no deviations: the encounter continues until the state is bound to the root body again
+        if (!encounter && _integrator == WISDOM_HOLMAN && !_deviations[index].second.isZero(0))
+          encounter = _last_encounters[index];
+        if (encounter) {
+          _encounter_states[index] = DormandPrince::State{ position, body->_orbit->velocity() + _deviations[index].second + drift_velocity };
+          // A new encounter starts with the step of the whole tick: the integrator reduces it at the close approach
+          if (encounter != _last_encounters[index])
+            _encounter_steps[index] = 0.0;
+        }
+      }
+      _encounters[index] = encounter;
+    }
+  });
+
+  for (size_t index = 0; index < _batch_first_level; index++) {
+    if (_encounters[index] == _last_encounters[index])
+      continue;
+    if (_last_encounters[index]) {
+      InfoLog(_batch_bodies[index]->name() + " ends its close encounter with " + _last_encounters[index]->name());
+    }
+    if (_encounters[index]) {
+      InfoLog(_batch_bodies[index]->name() + " starts a close encounter with " + _encounters[index]->name());
+    }
+  }
+}
+
+
+void KBody::Context::integrateEncounters(double delta_t) {
+  const double end_time = double(_time.count());
+  const Vec3<units::SPEED_T> drift_velocity = (_integrator == WISDOM_HOLMAN) ? driftVelocity(false) : Vec3<units::SPEED_T>{ 0.0, 0.0, 0.0 };
+
+  parallelFor(0, _batch_first_level, [this, delta_t, end_time, &drift_velocity](size_t first, size_t last) {
+    for (size_t index = first; index < last; index++) {
+      if (!_encounters[index])
+        continue;
+      KBody* body = _batch_bodies[index];
+
+      // Acceleration relative to the root body (direct and indirect terms of the perturbators). The perturbators follow their orbits during the tick 
+      //      (plus the linear drift, with the WISDOM_HOLMAN integrator), and their attraction is limited to the value at their surface (the impacts 
+      //      are detected elsewhere)
+      const units::REDUCED_MASS_T mu = body->_parent->reduced_mass + body->reduced_mass;
+      const std::vector<size_t>& interactions = _interactions[index];
+      auto acceleration = [this, mu, &interactions, end_time, &drift_velocity](double time, const Vec3<units::LENGTH_T>& position) {
+        units::LENGTH_T l_position = position.norm();
+        Vec3<units::ACCELERATION_T> acceleration = -mu / (l_position * l_position * l_position) * position;
+        for (size_t pert_index : interactions) {
+          const KBody* perturbator = _batch_bodies[pert_index];
+          Vec3<units::LENGTH_T> pert_position = perturbator->_orbit->stateAt(time).first.vec() + _deviations[pert_index].first + drift_velocity * (time - end_time);
+          Vec3<units::LENGTH_T> distance = pert_position - position;
+          units::LENGTH_T l_distance = std::max(distance.norm(), units::LENGTH_T(perturbator->radius));
+          units::LENGTH_T l_pert_position = pert_position.norm();
+          acceleration += perturbator->reduced_mass * (distance / (l_distance * l_distance * l_distance) - pert_position / (l_pert_position * l_pert_position * l_pert_position));
+        }
+        return acceleration;
+      };
+
+      // The step proposed at the end of the previous tick is kept for each body during its encounter
+      DormandPrince::State state = _encounter_states[index];
+      double& step = _encounter_steps[index];
+      if (step <= 0.0)
+        step = delta_t;
+      _encounter_failures[index] = (_encounter_integrator.integrate(state, end_time - delta_t, end_time, step, acceleration) == 0);
+      if (_encounter_failures[index]) {
+        step = 0.0;
+        continue;
+      }
+      state.velocity -= drift_velocity;
+
+      // The orbit is rectified with the integrated state, so the body continues with its Kepler orbit when the encounter ends. 
+      //      While the state is not bound to the root body (the perturbator accelerates it during the encounter), it is kept as a deviation
+      //      from the orbit
+      Deviation& deviation = _deviations[index];
+      try {
+        body->_orbit->rectify(state.position - body->_orbit->position().vec(), state.velocity - body->_orbit->velocity());
+        _batch.load(body->_batch_slot, *body->_orbit);
+        deviation.first.setZero();
+        deviation.second.setZero();
+      }
+      catch (const KeplerOrbit::ExcBodyNotBound&) {
+        deviation = Deviation{ state.position - body->_orbit->position().vec(), state.velocity - body->_orbit->velocity() };
+      }
+    }
+  }, 1);   // Chunks of 1 body: the encounters are few and their cost is very different
+
+  // If the integration fails (too many steps), the perturbation of the tick is approximated with the kicks: the kick and the linear drift of the 
+  //      second half of the tick (the last ones calculated) are applied for the whole tick, plus the displacement of the kick of the first half
+  for (size_t index = 0; index < _batch_first_level; index++) {
+    if (!_encounters[index] || !_encounter_failures[index])
+      continue;
+    WarnLog(_batch_bodies[index]->name() + " close encounter with " + _encounters[index]->name() + " not integrated (maximum number of steps): kicked instead");
+    kickBody(index, 2 * _kicks[index], 2 * _linear_drift + _kicks[index] * delta_t, delta_t);
+    _encounter_failures[index] = 0;
+  }
+}
+
+
+void KBody::Context::updateInteractions() {
+  if (_batch_first_level == 0)
+    return;
+
+  const KBody& root = *_batch_bodies[0]->_parent;
+  const double window = double(_interaction_window.count());
+
+  parallelFor(0, _batch_first_level, [this, &root, window](size_t first, size_t last) {
+    for (size_t index = first; index < last; index++) {
+      const KBody* body = _batch_bodies[index];
+      Vec3<units::LENGTH_T> position = body->_orbit->position().vec() + _deviations[index].first;
+      units::LENGTH_T l_position = position.norm();
+      units::ACCELERATION_T central_acceleration = root.reduced_mass / (l_position * l_position);
+
+      auto& interactions = _interactions[index];
+      interactions.clear();
+      for (size_t pert_index : _batch_perturbators) {
+        if (pert_index == index)
+          continue;
+        const KBody* perturbator = _batch_bodies[pert_index];
+        Vec3<units::LENGTH_T> pert_position = perturbator->_orbit->position().vec() + _deviations[pert_index].first;
+        Vec3<units::LENGTH_T> distance = pert_position - position;
+        units::LENGTH_T l_distance = distance.norm();
+
+        // Closest distance during the window (approaching at the current relative velocity)
+        units::SPEED_T l_rel_velocity = (perturbator->_orbit->velocity() - body->_orbit->velocity()).norm();
+        units::LENGTH_T l_min_distance = std::max(l_distance - l_rel_velocity * window, units::LENGTH_T(perturbator->radius));
+
+        if (l_min_distance < _hill_radii * perturbator->hillRadius()) {
+          interactions.push_back(pert_index);
+          continue;
+        }
+
+        // Upper bound of the perturbation during the window: current perturbation (direct and indirect terms) plus the increase of the direct term
+        units::LENGTH_T l_pert_position = pert_position.norm();
+        Vec3<units::ACCELERATION_T> acceleration = perturbator->reduced_mass * (distance / (l_distance * l_distance * l_distance) - pert_position / (l_pert_position * l_pert_position * l_pert_position));
+        units::ACCELERATION_T max_acceleration = acceleration.norm() + perturbator->reduced_mass * (1 / (l_min_distance * l_min_distance) - 1 / (l_distance * l_distance));
+        if (max_acceleration >= _perturbation_threshold * central_acceleration)
+          interactions.push_back(pert_index);
+      }
+    }
+  });
+
+  _interactions_time = _time;
+  _interactions_set = true;
+
+  DebugLog("Interaction lists updated: " << std::accumulate(_interactions.begin(), _interactions.end(), size_t(0), [](size_t total, const std::vector<size_t>& list) { return total + list.size(); }) 
+           << " of " << _batch_first_level * _batch_perturbators.size() << " perturbations evaluated");
+}
+
+
+void KBody::Context::placeFirstLevel() {
+  if (_batch_first_level == 0)
+    return;
+
+  // The root body is placed so the barycenter with the first level perturbators stays at the origin of the inertial CS:
+  //      R(root) = - sum(m(i) * r(i)) / M,   V(root) = - sum(m(i) * v(i)) / M,   where M = m(root) + sum(m(i)) and r(i), v(i) are relative to the root body
+  //      (the state of the orbit plus the deviation from it)
+  //      With the WISDOM_HOLMAN integrator the velocities of the orbits are barycentric: V(root) = - sum(m(i) * v(i)) / m(root)
+  KBody& root = *_batch_bodies[0]->_parent;
+  units::REDUCED_MASS_T total_mass{ root.reduced_mass };
+  Vec3<units::LENGTH_T> moment_pos{ 0.0, 0.0, 0.0 };
+  Vec3<units::SPEED_T> moment_vel{ 0.0, 0.0, 0.0 };
+  for (size_t index : _batch_perturbators) {
+    const KBody* body = _batch_bodies[index];
+    total_mass += body->reduced_mass;
+    moment_pos += body->reduced_mass * (body->_orbit->position().vec() + _deviations[index].first);
+    moment_vel += body->reduced_mass * (body->_orbit->velocity() + _deviations[index].second);
+  }
+  root._position = PositionType{ -moment_pos / total_mass };
+  if (_integrator == WISDOM_HOLMAN)
+    root._velocity = -moment_vel / root.reduced_mass;
+  else
+    root._velocity = -moment_vel / total_mass;
+
+  //      The first level bodies are placed according to their orbits
+  const Vec3<units::SPEED_T> origin_velocity = (_integrator == WISDOM_HOLMAN) ? Vec3<units::SPEED_T>{ 0.0, 0.0, 0.0 } : root._velocity;
+  parallelFor(0, _batch_first_level, [this, &root, &origin_velocity](size_t first, size_t last) {
+    for (size_t index = first; index < last; index++) {
+      KBody* body = _batch_bodies[index];
+      body->_position = root._position + body->_orbit->position().vec() + _deviations[index].first;
+      body->_velocity = origin_velocity + body->_orbit->velocity() + _deviations[index].second;
+    }
+  });
+
+  //      The second level bodies follow their parents (their orbits are not changed)
+  parallelFor(0, _batch_families.size(), [this](size_t first, size_t last) {
+    for (size_t family = first; family < last; family++) {
+      for (size_t index = _batch_families[family].first; index < _batch_families[family].second; index++) {
+        if (!_batch_bodies[index]->_parent_perturbator)
+          _batch_bodies[index]->applyOrbitChange({ Vec3<units::LENGTH_T>{ 0.0, 0.0, 0.0 }, Vec3<units::SPEED_T>{ 0.0, 0.0, 0.0 } });
+      }
+    }
+  }, 1);
+}
+
+
+void KBody::Context::checkpoint(tree::MTree<KBody>& bodies, Checkpoint& checkpoint) {
+  // The bodies are stored as they were moved, so the restored bodies continue exactly
+  unplaceLagging(bodies);
+
+  checkpoint.time = _time;
+  checkpoint.ticks = _ticks;
+  checkpoint.bodies.clear();
+  auto iter = bodies.begin();
   while (iter.hasNext()) {
     auto& body = iter.next();
-    body.keplerMove(delta_t);
+    auto state = body._lazy ? body.state() : std::make_pair(body._position, body._velocity);
+    checkpoint.bodies.push_back(Checkpoint::Entry{ state.first, state.second, body._orbit->checkpoint(), body._parent });
+  }
+  checkpoint.deviations.assign(_deviations.begin(), _deviations.end());
+}
 
-    //      2. Second level under the root body
-    auto iter_children = bodies.children(body.matchingKey());
-    while (iter_children.hasNext()) {
-      auto& child_body = iter_children.next();
-      child_body.keplerMove(delta_t);
 
-      //      3. Third level under the root body
-      // TBD !!!
+void KBody::Context::restore(tree::MTree<KBody>& bodies, const Checkpoint& checkpoint) {
+  if (checkpoint.bodies.size() != bodies.size())
+    throw std::invalid_argument("The checkpoint does not match the bodies");
+
+  size_t index{ 0 };
+  auto iter = bodies.begin();
+  while (iter.hasNext()) {
+    auto& body = iter.next();
+    const auto& entry = checkpoint.bodies[index++];
+    if (entry.parent != body._parent) {
+      if (body.TYPE != SHIP || !entry.parent)
+        throw std::invalid_argument("The checkpoint does not match the bodies");
+      bodies.moveNode(body.matchingKey(), entry.parent->matchingKey());
+      body._parent = entry.parent;
+    }
+    body._position = entry.position;
+    body._velocity = entry.velocity;
+    if (body.TYPE == SHIP)
+      body._orbit->restore(entry.orbit, body._parent->reduced_mass + body.reduced_mass);
+    else
+      body._orbit->restore(entry.orbit);
+  }
+
+  // The batch is reloaded from the restored orbits
+  for (KBody* body : _batch_bodies)
+    _batch.load(body->_batch_slot, *body->_orbit);
+  _batch.time(checkpoint.time);
+  std::fill(_encounters.begin(), _encounters.end(), nullptr);
+  std::fill(_last_encounters.begin(), _last_encounters.end(), nullptr);
+  if (checkpoint.deviations.size() == _deviations.size())
+    std::copy(checkpoint.deviations.begin(), checkpoint.deviations.end(), _deviations.begin());
+
+  _time = checkpoint.time;
+  _ticks = checkpoint.ticks;
+  if (_ephemeris) {
+    _ephemeris->clear();
+    _ephemeris_segment = std::numeric_limits<int64_t>::min();
+  }
+  _synchronized = std::all_of(_batch_bodies.begin(), _batch_bodies.end(), [this](const KBody* body) { return body->_orbit->time() == _time; });
+  _placed = false;
+  _interactions_set = false;
+}
+
+
+void KBody::Context::adopt(tree::MTree<KBody>& bodies, const std::vector<Setup>& setups, const Checkpoint& checkpoint) {
+  if (_barycenters_set)
+    throw std::runtime_error("Barycenters are defined. The bodies can't be set up again");
+
+  if (setups.size() != bodies.size())
+    throw std::invalid_argument("The setups do not match the bodies");
+
+  size_t index{ 0 };
+  auto iter = bodies.begin();
+  while (iter.hasNext()) {
+    auto& body = iter.next();
+    const auto& setup = setups[index++];
+    body._parent_perturbator = setup.parent_perturbator;
+    body._barycenter_pos = setup.barycenter_pos;
+    body._barycenter_vel = setup.barycenter_vel;
+  }
+
+  // The batch is bound once the orbits have been restored (the batch is still empty when they are restored)
+  restore(bodies, checkpoint);
+  bindBatch(bodies);
+  _batch.time(checkpoint.time);
+  _ticks = checkpoint.ticks;
+
+  _barycenters_set = true;
+}
+
+
+void KBody::Context::jumpTo(tree::MTree<KBody>& bodies, const units::TIME_T& time) {
+  if (!_barycenters_set)
+    throw std::runtime_error("Barycenters not set. Bodies can't be moved");
+
+  unplaceLagging(bodies);
+
+  // The deviations cannot be propagated without the intermediate states: they are added to the reference orbits before the jump (ENCKE)
+  if (_integrator == ENCKE)
+    rectify(true);
+
+  //      The states which are not bound to the root body are kept as deviations (WISDOM_HOLMAN, ENCKE): they follow the conics of the states 
+  //      through the jump
+  std::vector<std::pair<size_t, std::pair<PositionType, VelocityType>>> unbound_states;
+  for (size_t index = 0; index < _batch_first_level; index++) {
+    const Deviation& deviation = _deviations[index];
+    if (deviation.first.isZero(0.0) && deviation.second.isZero(0.0))
+      continue;
+    const KBody* body = _batch_bodies[index];
+    KeplerOrbit conic;
+    conic.conic(body->_orbit->mu(), body->_orbit->position().vec() + deviation.first, body->_orbit->velocity() + deviation.second, _time);
+    unbound_states.emplace_back(index, conic.stateAt(time));
+  }
+
+  move(bodies, time, _batch_first_level, _batch_families.size());
+  for (const auto& unbound_state : unbound_states) {
+    const KBody* body = _batch_bodies[unbound_state.first];
+    _deviations[unbound_state.first] = Deviation{ unbound_state.second.first.vec() - body->_orbit->position().vec(), unbound_state.second.second - body->_orbit->velocity() };
+  }
+  if (_integrator != KEPLER)
+    placeFirstLevel();
+  moveShips(bodies);
+  _ticks = 0;
+  _synchronized = true;
+}
+
+
+void KBody::Context::moveShips(tree::MTree<KBody>& bodies) {
+  if (_ships.empty())
+    return;
+
+  // 1. The conics are propagated to the current time and the SOI transitions are detected, without changing the tree
+  parallelFor(0, _ships.size(), [this](size_t first, size_t last) {
+    for (size_t index = first; index < last; index++) {
+      _ships[index]->_orbit->moveTo(_time);
+      _ship_transitions[index] = _ships[index]->soiTransition();
     }
-    
+  });
+
+  // 2. The ships changing their SOI are moved in the tree, one by one
+  for (size_t index = 0; index < _ships.size(); index++) {
+    if (_ship_transitions[index])
+      _ships[index]->reparent(bodies, *_ship_transitions[index]);
   }
 
+  // 3. The ships are placed relative to their parents
+  parallelFor(0, _ships.size(), [this](size_t first, size_t last) {
+    for (size_t index = first; index < last; index++) {
+      KBody* ship = _ships[index];
+      ship->_position = ship->_parent->_position + ship->_orbit->position().vec();
+      ship->_velocity = ship->_parent->_velocity + ship->_orbit->velocity();
+    }
+  });
+}
+
+
+KBody* KBody::soiTransition() const {
+  const Vec3<units::LENGTH_T> position = _orbit->position().vec();
+
+  // Exit: the ship is out of the SOI of its parent (the SOI of the root body has no limit)
+  if (_parent->_parent && position.norm() > _parent->soiRadius())
+    return _parent->_parent;
+
+  // Entry: the ship is inside the SOI of a body orbiting its parent (the deepest one, relative to the SOI radius, if there are several)
+  KBody* new_parent{ nullptr };
+  auto soi_bodies = _context->_soi_bodies.find(_parent);
+  if (soi_bodies != _context->_soi_bodies.end()) {
+    double min_ratio{ 1.0 };
+    for (KBody* body : soi_bodies->second) {
+      double ratio = (position - body->_orbit->stateAt(_context->_time).first.vec()).norm() / body->soiRadius();
+      if (ratio < min_ratio) {
+        min_ratio = ratio;
+        new_parent = body;
+      }
+    }
+  }
+  return new_parent;
+}
+
+
+void KBody::reparent(tree::MTree<KBody>& bodies, KBody& new_parent) {
+  // State relative to the new parent, calculated from the orbits at the current time
+  Vec3<units::LENGTH_T> position = _orbit->position().vec();
+  Vec3<units::SPEED_T> velocity = _orbit->velocity();
+  if (&new_parent == _parent->_parent) {
+    auto parent_state = _parent->_orbit->stateAt(_context->_time);
+    position += parent_state.first.vec();
+    velocity += parent_state.second;
+    InfoLog("Ship " + name() + " leaves the sphere of influence of " + _parent->name());
+  }
+  else {
+    auto new_parent_state = new_parent._orbit->stateAt(_context->_time);
+    position -= new_parent_state.first.vec();
+    velocity -= new_parent_state.second;
+    InfoLog("Ship " + name() + " enters the sphere of influence of " + new_parent.name());
+  }
+
+  bodies.moveNode(matchingKey(), new_parent.matchingKey());
+  _parent = &new_parent;
+  _orbit->conic(new_parent.reduced_mass + reduced_mass, position, velocity, _context->_time);
+}
+
+
+void KBody::Context::move(tree::MTree<KBody>& bodies, const units::TIME_T& time, size_t level_1_due, size_t families_due) {
+  // *********************************************************************************************
+  // APPROXIMATION 0 : Interaction only with the parent body, according to its Keplerian orbit 
+  // *********************************************************************************************
+  // New positions and velocities relative to the parents are calculated for all the due orbits at once, directly from their epochs
+  size_t families_last = families_due ? _batch_families[families_due - 1].second : _batch_first_level;
+  parallelFor(0, level_1_due, [this, &time](size_t first, size_t last) { _batch.moveTo(first, last, time); });
+  parallelFor(_batch_first_level, families_last, [this, &time](size_t first, size_t last) { _batch.moveTo(first, last, time); });
+  _batch.time(time);
+  _time = time;
+
+  // Then the changes are applied to every due body, in phases. The bodies in each phase are moved in parallel, unless they share the body they perturbate
+  //      1. First level bodies which perturbate the root body (all of them move the root body)
+  for (size_t index = 0; index < level_1_due; index++) {
+    if (_batch_bodies[index]->_parent_perturbator)
+      _batch_bodies[index]->batchMove();
+  }
+
+  //      2. Rest of the first level bodies, once the root body has been moved
+  parallelFor(0, level_1_due, [this](size_t first, size_t last) {
+    for (size_t index = first; index < last; index++) {
+      if (!_batch_bodies[index]->_parent_perturbator)
+        _batch_bodies[index]->batchMove();
+    }
+  });
+
+  //      3. Second level bodies, once their parents have been moved: one task per family, since the children can perturbate their parent
+  //         (third level under the root body: TBD !!!)
+  parallelFor(0, families_due, [this](size_t first, size_t last) {
+    for (size_t family = first; family < last; family++) {
+      for (size_t index = _batch_families[family].first; index < _batch_families[family].second; index++)
+        _batch_bodies[index]->batchMove();
+    }
+  }, 1);
+
+
+  // With the WISDOM_HOLMAN and ENCKE integrators the orbits of the first level bodies (and their deviations) determine the state of the bodies 
+  //    (the interactions are applied as kicks): the caller places them once the tick is complete (see placeFirstLevel()). The first level bodies 
+  //    are due in every tick, so the bodies moved to synchronize them are second level bodies, placed relative to their parents
+  if (_integrator != KEPLER)
+    return;
 
   // After all bodies have been moved, their keplerian orbits must be recalculated for all the children bodies 
   //    which parents have a barycenter not matching its position
   if (bodies.root().barycenterPos() != bodies.root().position() ||
     bodies.root().barycenterVel() != bodies.root().velocity()) {
 
-    iter.rewind();
-    while (iter.hasNext()) {
-      auto& body = iter.next();
-      body._orbit.reset(new KeplerOrbit(body.parent(), body));
-    }
+    //      1. First level under the root body (the first bodies in the batch): the orbits of the due perturbators are recalculated in place and reloaded 
+    //         in the batch. Only the perturbators are displaced from their orbits (by the root body, which is moved by the rest of the perturbators): the rest 
+    //         of the bodies are placed relative to the root body, so their orbits would not change (the same for the passive bodies, which are not moved)
+    parallelFor(0, level_1_due, [this](size_t first, size_t last) {
+      for (size_t index = first; index < last; index++) {
+        auto body = _batch_bodies[index];
+        if (!body->_parent_perturbator)
+          continue;
+        body->_orbit->osculate(*body->_parent, *body, _time);
+        _batch.load(body->_batch_slot, *body->_orbit);
+      }
+    });
     //      2. Second level under the root body
     // TBD !!!
   }
@@ -190,7 +1249,7 @@ void KBody::commonConstructor() {
   if (!_initialized)
     throw std::runtime_error("General Body configuration not initialized");
 
-  if(_barycenters_set)
+  if (_parent && _parent->_context)
     throw std::runtime_error("Barycenters are defined. No more bodies can be created");
 
   if (!_parent)
@@ -199,6 +1258,12 @@ void KBody::commonConstructor() {
   if (!validateTypes(_parent->TYPE, TYPE))
     throw std::invalid_argument("Parent and child body types are not compatible");
 
+  // Ships follow patched conics: the orbit can be hyperbolic and they never perturbate their parent
+  if (TYPE == SHIP) {
+    _orbit->conic(_parent->reduced_mass + reduced_mass, _position.vec() - _parent->_position.vec(), _velocity - _parent->_velocity, units::TIME_T(0));
+    return;
+  }
+
   // Create the keplerian orbit
   _orbit.reset(new KeplerOrbit(*_parent, *this));
 
@@ -226,6 +1291,12 @@ std::string KBody::uniqueName(BodyType type, int64_t id, const std::string& name
 
 
 bool KBody::validateTypes(BodyType parent_type, BodyType child_type) {
+  // Ships can orbit any body, but no body can orbit a ship
+  if (child_type == SHIP)
+    return parent_type != SHIP;
+  if (parent_type == SHIP)
+    return false;
+
   if (parent_type == STAR) {
     if (child_type != SATELLITE)
       return true;
@@ -243,14 +1314,37 @@ bool KBody::validateTypes(BodyType parent_type, BodyType child_type) {
 }
 
 
+units::LENGTH_T KBody::hillRadius() const {
+  units::LENGTH_T distance = (_orbit->e() < 1) ? _orbit->a() * (1 - _orbit->e()) : _orbit->position().vec().norm();
+  return distance * std::cbrt(reduced_mass / (3 * (_parent->reduced_mass + reduced_mass)));
+}
+
+
+units::LENGTH_T KBody::soiRadius() const {
+  units::LENGTH_T distance = (_orbit->e() < 1) ? _orbit->a() : _orbit->position().vec().norm();
+  return distance * std::pow(reduced_mass / _parent->reduced_mass, 0.4);
+}
+
+
 void KBody::keplerMove(const units::TIME_T& delta_t) {
   // *********************************************************************************************************
   // APPROXIMATION 0 : Movement due to interaction only with the parent body, according to its Keplerian orbit 
   // *********************************************************************************************************
   // Keplerian orbits have as a result a new anomaly(pos and vel relative to the parent)
   // The change in the parent CS is returned
-  auto change = _orbit->forward(delta_t);
+  applyOrbitChange(_orbit->forward(delta_t));
+}
+
+
+void KBody::batchMove() {
+  PBody::PositionType old_position = _orbit->position();
+  PBody::VelocityType old_velocity = _orbit->velocity();
+  _context->_batch.store(_batch_slot, *_orbit);
+  applyOrbitChange({ _orbit->position().vec() - old_position.vec(), _orbit->velocity() - old_velocity });
+}
+
 
+void KBody::applyOrbitChange(const std::pair<Vec3<units::LENGTH_T>, Vec3<units::SPEED_T>>& change) {
   // If this body is a perturbator of the parent
   if (_parent_perturbator) {
     // Apply this relative change to the position and velocity in the inertial Barycenter CS
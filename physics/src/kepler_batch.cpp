@@ -0,0 +1,131 @@
+#include <physics/kepler_batch.h>
+
+#include <cmath>
+
+using namespace physics;
+using namespace physics::units;
+using namespace geometry;
+
+/*   size_t add(const KeplerOrbit& orbit)   */
+/********************************************/
+size_t KeplerBatch::add(const KeplerOrbit& orbit) {
+  for (auto vec : { &_a, &_b, &_e, &_mean_motion, &_epoch, &_mean_anomaly_epoch, &_px, &_py, &_pz, &_qx, &_qy, &_qz, &_mean_anomaly, &_ecc_anomaly,
+                    &_x, &_y, &_vxp, &_vyp, &_rx, &_ry, &_rz, &_vx, &_vy, &_vz })
+    vec->push_back(0.0);
+
+  size_t slot = size() - 1;
+  load(slot, orbit);
+
+  return slot;
+}
+
+
+/*   void load(size_t slot, const KeplerOrbit& orbit)   */
+/********************************************************/
+void KeplerBatch::load(size_t slot, const KeplerOrbit& orbit) {
+  if (slot >= size())
+    throw std::out_of_range("Invalid Kepler batch slot");
+
+  _a[slot] = orbit._a;
+  _e[slot] = orbit._e;
+  _b[slot] = orbit._a * sqrt(1 - orbit._e * orbit._e);
+  _mean_motion[slot] = orbit.meanMotion();
+  _epoch[slot] = double(orbit._epoch.count());
+  _mean_anomaly_epoch[slot] = orbit._mean_anomaly_epoch;
+
+  _px[slot] = orbit._perifocal_p.x();
+  _py[slot] = orbit._perifocal_p.y();
+  _pz[slot] = orbit._perifocal_p.z();
+  _qx[slot] = orbit._perifocal_q.x();
+  _qy[slot] = orbit._perifocal_q.y();
+  _qz[slot] = orbit._perifocal_q.z();
+
+  _mean_anomaly[slot] = orbit._mean_anomaly;
+  _ecc_anomaly[slot] = orbit._ecc_anomaly;
+
+  _rx[slot] = orbit._position.x();
+  _ry[slot] = orbit._position.y();
+  _rz[slot] = orbit._position.z();
+  _vx[slot] = orbit._velocity.x();
+  _vy[slot] = orbit._velocity.y();
+  _vz[slot] = orbit._velocity.z();
+}
+
+
+/*   void clear()   */
+/********************/
+void KeplerBatch::clear() {
+  for (auto vec : { &_a, &_b, &_e, &_mean_motion, &_epoch, &_mean_anomaly_epoch, &_px, &_py, &_pz, &_qx, &_qy, &_qz, &_mean_anomaly, &_ecc_anomaly,
+                    &_x, &_y, &_vxp, &_vyp, &_rx, &_ry, &_rz, &_vx, &_vy, &_vz })
+    vec->clear();
+}
+
+
+/*   void moveTo(size_t first, size_t last, units::TIME_T time)   */
+/******************************************************************/
+void KeplerBatch::moveTo(size_t first, size_t last, TIME_T time) {
+  const double t = double(time.count());
+
+  // STAGE 1: anomalies and state in the perifocal CS
+  for (size_t s = first; s < last; ++s) {
+    const double e = _e[s];
+    const double n = _mean_motion[s];
+
+    //    a- New mean anomaly, M = M(epoch) + n * (time - epoch) (kept in [0, 2*PI))
+    ANGLE_T mean_anomaly = _mean_anomaly_epoch[s] + n * (t - _epoch[s]);
+    mean_anomaly -= std::floor(mean_anomaly / TWO_PI) * TWO_PI;
+
+    //    b- New ecc_anomaly, solving Kepler's equation
+    ANGLE_T ecc_anomaly = KeplerOrbit::solveKepler(mean_anomaly, e);
+
+    _mean_anomaly[s] = mean_anomaly;
+    _ecc_anomaly[s] = ecc_anomaly;
+
+    //    c- Position and velocity in the orbital plane (x axis pointing to the periapsis)
+    //          x = a * (cos E - e), y = b * sin E
+    //          dE/dt = n / (1 - e*cos E)
+    const double cos_E = cos(ecc_anomaly);
+    const double sin_E = sin(ecc_anomaly);
+    const double ecc_rate = n / (1 - e * cos_E);
+    _x[s] = _a[s] * (cos_E - e);
+    _y[s] = _b[s] * sin_E;
+    _vxp[s] = -_a[s] * sin_E * ecc_rate;
+    _vyp[s] = _b[s] * cos_E * ecc_rate;
+  }
+
+  // STAGE 2: rotation to the primary CS
+  rotate(first, last);
+}
+
+
+/*   void store(size_t slot, KeplerOrbit& orbit) const   */
+/*********************************************************/
+void KeplerBatch::store(size_t slot, KeplerOrbit& orbit) const {
+  orbit._mean_anomaly = _mean_anomaly[slot];
+  orbit._ecc_anomaly = _ecc_anomaly[slot];
+
+  // True anomaly from the position in the orbital plane
+  orbit._anomaly = atan2(_y[slot], _x[slot]);
+  if (orbit._anomaly < 0)
+    orbit._anomaly += TWO_PI;
+
+  orbit._time_periapsis = TIME_T(TIME_T::rep(_mean_anomaly[slot] / _mean_motion[slot]));
+  orbit._time = _time;
+
+  orbit._position = PBody::PositionType(_rx[slot], _ry[slot], _rz[slot]);
+  orbit._velocity = PBody::VelocityType(_vx[slot], _vy[slot], _vz[slot]);
+}
+
+
+/*   void rotate(size_t first, size_t last)   */
+/**********************************************/
+void KeplerBatch::rotate(size_t first, size_t last) {
+  for (size_t s = first; s < last; ++s) {
+    _rx[s] = _x[s] * _px[s] + _y[s] * _qx[s];
+    _ry[s] = _x[s] * _py[s] + _y[s] * _qy[s];
+    _rz[s] = _x[s] * _pz[s] + _y[s] * _qz[s];
+    _vx[s] = _vxp[s] * _px[s] + _vyp[s] * _qx[s];
+    _vy[s] = _vxp[s] * _py[s] + _vyp[s] * _qy[s];
+    _vz[s] = _vxp[s] * _pz[s] + _vyp[s] * _qz[s];
+  }
+}
@@ -1,17 +1,29 @@
 #include <physics/kepler_orbit.h>
 
+#include <algorithm>
+
 #include <logger.h>
 
 using namespace physics;
 using namespace physics::units;
 using namespace geometry;
 
-constexpr auto PRECISION_ANOMALY_CALC = 0.1;
+constexpr ANGLE_T KEPLER_TOLERANCE = 1e-12;  /**< Precision of the eccentric anomaly calculated by solveKepler(), in radians */
+constexpr int     KEPLER_MAX_ITERATIONS = 16;
+
+
+/*   KeplerOrbit(const PBody& prim_body, const PBody& sec_body, units::TIME_T epoch)   */
+/*************************************************************************************/
+KeplerOrbit::KeplerOrbit(const PBody& prim_body, const PBody& sec_body, TIME_T epoch) {
+  osculate(prim_body, sec_body, epoch);
+}
 
 
-/*   KeplerOrbit(const PBody& prim_body, const PBody& sec_body)   */
-/******************************************************************/
-KeplerOrbit::KeplerOrbit(const PBody& prim_body, const PBody& sec_body) {
+/*   void osculate(const PBody& prim_body, const PBody& sec_body, units::TIME_T epoch)   */
+/***************************************************************************************/
+void KeplerOrbit::osculate(const PBody& prim_body, const PBody& sec_body, TIME_T epoch) {
+  _epoch = epoch;
+  _time = epoch;
 
   // 0. Check that both bodies are really gravitationally bound and not in collision
   Vec3<LENGTH_T> v_rel_position = sec_body.position().vec() - prim_body.position().vec();
@@ -46,6 +58,49 @@ KeplerOrbit::KeplerOrbit(const PBody& prim_body, const PBody& sec_body) {
   if (kin_energy >= pot_energy)
     throw ExcBodyNotBound("Body " + sec_body.name() + " is not gravitationally bound to " + prim_body.name());
 
+  //    mu = G * (m1+m2)
+  _mu = sec_body.reduced_mass + prim_body.reduced_mass;
+
+  elements(v_rel_position, v_rel_velocity);
+}
+
+
+/*   void conic(REDUCED_MASS_T mu, const Vec3<LENGTH_T>& rel_position, const Vec3<SPEED_T>& rel_velocity, TIME_T epoch)   */
+/***********************************************************************************************************************/
+void KeplerOrbit::conic(REDUCED_MASS_T mu, const Vec3<LENGTH_T>& rel_position, const Vec3<SPEED_T>& rel_velocity, TIME_T epoch) {
+  _epoch = epoch;
+  _time = epoch;
+  _mu = mu;
+
+  elements(rel_position, rel_velocity);
+}
+
+
+/*   void rectify(const Vec3<LENGTH_T>& delta_position, const Vec3<SPEED_T>& delta_velocity)   */
+/**********************************************************************************************/
+void KeplerOrbit::rectify(const Vec3<LENGTH_T>& delta_position, const Vec3<SPEED_T>& delta_velocity) {
+  Vec3<LENGTH_T> v_rel_position = _position.vec() + delta_position;
+  Vec3<SPEED_T> v_rel_velocity = _velocity + delta_velocity;
+
+  // Binding check: the specific orbital energy must be negative
+  if (0.5 * v_rel_velocity.squaredNorm() >= _mu / v_rel_position.norm())
+    throw ExcBodyNotBound("Orbit is not gravitationally bound after the rectification");
+
+  _epoch = _time;
+
+  elements(v_rel_position, v_rel_velocity);
+}
+
+
+/*   void elements(const Vec3<LENGTH_T>& v_rel_position, const Vec3<SPEED_T>& v_rel_velocity)   */
+/***********************************************************************************************/
+void KeplerOrbit::elements(const Vec3<LENGTH_T>& v_rel_position, const Vec3<SPEED_T>& v_rel_velocity) {
+  // Elements which are not calculated in all the cases (they keep the default value)
+  _asc_node = 0.0;
+  _periapsis = 0.0;
+
+  LENGTH_T l_rel_position = v_rel_position.norm();
+  SPEED_T l_rel_velocity_squared = v_rel_velocity.squaredNorm();
 
   // 1. Calculate inclination of the orbital plane
   //    H = (R x V) is orthogonal to the orbital plane.
@@ -70,8 +125,7 @@ KeplerOrbit::KeplerOrbit(const PBody& prim_body, const PBody& sec_body) {
     _e = 1;
      
     //    a = r*mu / (2*mu - r * v * v)
-    REDUCED_MASS_T g_mass = sec_body.reduced_mass + prim_body.reduced_mass;
-    _a = l_rel_position * g_mass / (2 * g_mass - l_rel_position * l_rel_velocity_squared);
+    _a = l_rel_position * _mu / (2 * _mu - l_rel_position * l_rel_velocity_squared);
 
     //    anomaly = PI (and it is always PI, in this case)
     _anomaly = PI;
@@ -79,6 +133,8 @@ KeplerOrbit::KeplerOrbit(const PBody& prim_body, const PBody& sec_body) {
     //    periapsis = 3 * PI / 2
     _periapsis = 3 * HALF_PI;
 
+    perifocalBasis();
+
     return;
   }
 
@@ -102,13 +158,12 @@ KeplerOrbit::KeplerOrbit(const PBody& prim_body, const PBody& sec_body) {
 
   // 3. Calculate eccentricity
   //    e = sqrt(H/mu*(H*v*v/mu-2*vt)+1)
-  //    mu = G * (m1+m2)
   auto u_rel_position = v_rel_position.normalized();
   auto rad_velocity = u_rel_position.dot(v_rel_velocity);
-  auto tan_velocity = sqrt(l_rel_velocity_squared - rad_velocity * rad_velocity);
+  auto tan_velocity = sqrt(std::max(0.0, l_rel_velocity_squared - rad_velocity * rad_velocity));
 
-  _mu = sec_body.reduced_mass + prim_body.reduced_mass;
-  _e = sqrt(l_H / _mu * (l_H*l_rel_velocity_squared / _mu - 2 * tan_velocity) + 1);
+  //    (for almost circular orbits the rounding errors can give a slightly negative value of e*e)
+  _e = sqrt(std::max(0.0, l_H / _mu * (l_H*l_rel_velocity_squared / _mu - 2 * tan_velocity) + 1));
 
 
   // 4. Calculate semimajor axis (e cannot be 1: already checked above: see 0. and 1.)
@@ -136,8 +191,9 @@ KeplerOrbit::KeplerOrbit(const PBody& prim_body, const PBody& sec_body) {
 
     // Calculate argument of periapsis
     //    cos (periapsis+anomaly) = r.normalized * u_asc_node (normalized vector in the direction of the asc. node)
+    //    (the rounding errors can give a cosine slightly greater than 1 at the nodes)
     geometry::Vec3<ANGLE_T> u_asc_node{ cos(_asc_node), sin(_asc_node), 0.0 };
-    ANGLE_T added_angle = acos(u_rel_position.dot(u_asc_node));
+    ANGLE_T added_angle = acos(std::clamp(u_rel_position.dot(u_asc_node), -1.0, 1.0));
     // There are 2 possible solutions: added_angle  or 2*PI-added_angle.
     // TO determine which one is the correct one, it is possible to use the projection of r over a perpendicular
     //      vector to asc_node in the xy plane
@@ -151,7 +207,7 @@ KeplerOrbit::KeplerOrbit(const PBody& prim_body, const PBody& sec_body) {
   else {
     //    cos Z = u_rel_pos * u_asc_node
     geometry::Vec3<ANGLE_T> u_asc_node{ cos(_asc_node), sin(_asc_node), 0.0 };
-    _anomaly = acos(u_rel_position.dot(u_asc_node));
+    _anomaly = acos(std::clamp(u_rel_position.dot(u_asc_node), -1.0, 1.0));
 
     //    The solution to this equation can have 2 values: anomaly, PI - anomaly
     //    Comparing the y component of the u_asc_node and the u_rel_position determines the right value: if u_rel_pos.y + u_asc_node.y < 0 then anomaly is between PI and 2*PI 
@@ -161,6 +217,10 @@ KeplerOrbit::KeplerOrbit(const PBody& prim_body, const PBody& sec_body) {
 
   // Set the additional orbit parameters
   extParams();
+  _mean_anomaly_epoch = _mean_anomaly;
+
+  // Set the orientation of the orbit (perifocal basis), reused in every position calculation
+  perifocalBasis();
 
   // Set the caratesian coordinates relative to the primary
   cartesianParams();
@@ -168,71 +228,217 @@ KeplerOrbit::KeplerOrbit(const PBody& prim_body, const PBody& sec_body) {
   return;
 }
 
-/*    std::pair<PBody::PositionType, PBody::VelocityType> forward(units::TIME_T delta_time)   */
-/**********************************************************************************************/
-std::pair<Vec3<LENGTH_T>, Vec3<SPEED_T>> KeplerOrbit::forward(TIME_T delta_time) {
-  // Calculate anomaly in time+delta_time
-  //    Store previous values of ecc_anomaly and time from periapsis (as a double!)
-  ANGLE_T old_ecc_anomaly = _ecc_anomaly;
-  ANGLE_T old_mean_anomaly = _mean_anomaly;
-  double fact = sqrt(_a * _a * _a / _mu);
-  double old_time_periapsis = fact * (old_ecc_anomaly - _e * sin(old_ecc_anomaly));
-
-  //    a- New mean anomaly, M1 = M + 2*PI / T * delta_time
-  ANGLE_T delta_M = TWO_PI / period().count() * delta_time.count();
-  _mean_anomaly += delta_M;
-
-  //    b- New ecc_anomaly (APPROXIMATION!!!), E1 = E + 2*PI/T/(1-e*cos(E))*delta_time
-  _ecc_anomaly = _ecc_anomaly + delta_M / (1 - _e * cos(_ecc_anomaly));
-
-  //    c- Check that the approximation is good enough
-  //       (Compare times from new E and actual time from periapsis + delta_time)
-  double new_time_periapsis = fact * (_ecc_anomaly - _e * sin(_ecc_anomaly));
-
+/*    std::pair<PBody::PositionType, PBody::VelocityType> moveTo(units::TIME_T time)   */
+/**************************************************************************************/
+std::pair<Vec3<LENGTH_T>, Vec3<SPEED_T>> KeplerOrbit::moveTo(TIME_T time) {
   // Store the old state
   PBody::PositionType old_position = _position;
   PBody::VelocityType old_velocity = _velocity;
 
-  if ( std::abs(new_time_periapsis - old_time_periapsis - delta_time.count()) > PRECISION_ANOMALY_CALC) {
-    DebugLog("time_periapsis: " << old_time_periapsis);
-    DebugLog("New time_periapsis: " << new_time_periapsis);
-    ErrorLog("ANOMALY CALCULATION ERROR: delta_time and delta_periapsis: " << delta_time.count() << " - " << (new_time_periapsis - old_time_periapsis));
-    if (delta_time.count() == 1)
-      throw std::runtime_error("ANOMALY CALCULATION ERROR");
-    // Rollback
-    _mean_anomaly = old_mean_anomaly;
-    _ecc_anomaly = old_ecc_anomaly;
-    DebugLog("Calculating in 2 steps: " + std::to_string(delta_time.count() / 2 + delta_time.count() % 2) + ", " + std::to_string(delta_time.count() / 2));
-
-    forward(delta_time / 2 + delta_time % 2);
-    forward(delta_time / 2);
-    
-    DebugLog("Finished calculating in 2 steps.");
+  // Calculate anomaly in the new time
+  //    a- New mean anomaly, from the mean anomaly at the epoch
+  _mean_anomaly = meanAnomalyAt(double(time.count()));
+
+  //    b- New ecc_anomaly, solving Kepler's equation
+  //    c- Calculate new true anomaly, tan (anomaly/2) = sqrt( (1+e)/(1-e) )*tan(E/2)
+  //       (hyperbolic orbits: tan (anomaly/2) = sqrt( (e+1)/(e-1) )*tanh(H/2))
+  if (_e < 1) {
+    _ecc_anomaly = solveKepler(_mean_anomaly, _e);
+    _anomaly = 2 * atan(sqrt((1 + _e) / (1 - _e)) * tan(_ecc_anomaly / 2));
   }
   else {
-    //    d- Calculate new true anomaly, tan (anomaly/2) = sqrt( (1+e)/(1-e) )*tan(E/2)
-    _anomaly = 2 * atan(sqrt((1 + _e) / (1 - _e)) * tan(_ecc_anomaly / 2));
-    if (_anomaly < 0)
-      _anomaly = TWO_PI + _anomaly;
-
-    _time_periapsis = TIME_T(TIME_T::rep(new_time_periapsis));
+    _ecc_anomaly = solveKeplerHyperbolic(_mean_anomaly, _e);
+    _anomaly = 2 * atan(sqrt((_e + 1) / (_e - 1)) * tanh(_ecc_anomaly / 2));
+  }
+  if (_anomaly < 0)
+    _anomaly = TWO_PI + _anomaly;
 
-    // Set the new caratesian coordinates relative to the parent body
-    cartesianParams();
+  _time_periapsis = TIME_T(TIME_T::rep(_mean_anomaly / meanMotion()));
+  _time = time;
 
-  }
+  // Set the new caratesian coordinates relative to the parent body
+  cartesianParams();
 
   // Return the change in the state
   return std::pair<Vec3<LENGTH_T>, Vec3<SPEED_T>>(_position.vec() - old_position.vec(), _velocity - old_velocity);
 }
 
 
+/*   Checkpoint checkpoint() const   */
+/*************************************/
+KeplerOrbit::Checkpoint KeplerOrbit::checkpoint() const {
+  return Checkpoint{ _a, _e, _i, _asc_node, _periapsis, _anomaly, _ecc_anomaly, _mean_anomaly, _mean_anomaly_epoch, _epoch, _time, _time_periapsis, _position, _velocity };
+}
+
+
+/*   void restore(const Checkpoint& checkpoint)   */
+/**************************************************/
+void KeplerOrbit::restore(const Checkpoint& checkpoint) {
+  _a = checkpoint.a;
+  _e = checkpoint.e;
+  _i = checkpoint.i;
+  _asc_node = checkpoint.asc_node;
+  _periapsis = checkpoint.periapsis;
+  _anomaly = checkpoint.anomaly;
+  _ecc_anomaly = checkpoint.ecc_anomaly;
+  _mean_anomaly = checkpoint.mean_anomaly;
+  _mean_anomaly_epoch = checkpoint.mean_anomaly_epoch;
+  _epoch = checkpoint.epoch;
+  _time = checkpoint.time;
+  _time_periapsis = checkpoint.time_periapsis;
+  _position = checkpoint.position;
+  _velocity = checkpoint.velocity;
+
+  perifocalBasis();
+}
+
+
+/*    std::pair<PBody::PositionType, PBody::VelocityType> stateAt(double time) const   */
+/**************************************************************************************/
+std::pair<PBody::PositionType, PBody::VelocityType> KeplerOrbit::stateAt(double time) const {
+  if (_e >= 1) {
+    // Hyperbolic orbits: x = a * (cosh H - e), y = -a * sqrt(e*e - 1) * sinh H, dH/dt = n / (e*cosh H - 1)
+    ANGLE_T hyp_anomaly = solveKeplerHyperbolic(meanAnomalyAt(time), _e);
+    LENGTH_T b = -_a * sqrt(_e * _e - 1);
+    double cosh_H = cosh(hyp_anomaly);
+    double sinh_H = sinh(hyp_anomaly);
+    double hyp_rate = meanMotion() / (_e * cosh_H - 1);
+
+    PBody::PositionType position{ _a * (cosh_H - _e) * _perifocal_p + b * sinh_H * _perifocal_q };
+    PBody::VelocityType velocity{ _a * sinh_H * hyp_rate * _perifocal_p + b * cosh_H * hyp_rate * _perifocal_q };
+
+    return std::pair<PBody::PositionType, PBody::VelocityType>(position, velocity);
+  }
+
+  ANGLE_T ecc_anomaly = solveKepler(meanAnomalyAt(time), _e);
+
+  // Position and velocity in the orbital plane (x axis pointing to the periapsis), from the eccentric anomaly:
+  //      x = a * (cos E - e), y = b * sin E
+  //      dE/dt = n / (1 - e*cos E)
+  LENGTH_T b = _a * sqrt(1 - _e * _e);
+  double cos_E = cos(ecc_anomaly);
+  double sin_E = sin(ecc_anomaly);
+  double ecc_rate = meanMotion() / (1 - _e * cos_E);
+
+  PBody::PositionType position{ _a * (cos_E - _e) * _perifocal_p + b * sin_E * _perifocal_q };
+  PBody::VelocityType velocity{ -_a * sin_E * ecc_rate * _perifocal_p + b * cos_E * ecc_rate * _perifocal_q };
+
+  return std::pair<PBody::PositionType, PBody::VelocityType>(position, velocity);
+}
+
+
+/*   units::ANGLE_T meanAnomalyAt(double time) const   */
+/******************************************************/
+ANGLE_T KeplerOrbit::meanAnomalyAt(double time) const {
+  // M = M(epoch) + n * (time - epoch), with the mean motion n = 2*PI / T (kept in [0, 2*PI))
+  ANGLE_T mean_anomaly = _mean_anomaly_epoch + meanMotion() * (time - double(_epoch.count()));
+  if (_e >= 1)
+    return mean_anomaly;
+
+  return mean_anomaly - std::floor(mean_anomaly / TWO_PI) * TWO_PI;
+}
+
+
+/*   units::ANGLE_T solveKepler(units::ANGLE_T mean_anomaly, units::LENGTH_T e)   */
+/**********************************************************************************/
+ANGLE_T KeplerOrbit::solveKepler(ANGLE_T mean_anomaly, LENGTH_T e) {
+  double sin_E, cos_E;
+  return solveKepler(mean_anomaly, e, KEPLER_TOLERANCE, sin_E, cos_E);
+}
+
+
+/*   units::ANGLE_T solveKepler(units::ANGLE_T mean_anomaly, units::LENGTH_T e, units::ANGLE_T tolerance, double& sin_E, double& cos_E)   */
+/**************************************************************************************************************************************/
+ANGLE_T KeplerOrbit::solveKepler(ANGLE_T mean_anomaly, LENGTH_T e, ANGLE_T tolerance, double& sin_E, double& cos_E) {
+  // Reduce the mean anomaly to [-PI, PI), keeping the number of complete revolutions
+  ANGLE_T revs = std::floor((mean_anomaly + PI) / TWO_PI);
+  ANGLE_T M = mean_anomaly - revs * TWO_PI;
+
+  // The solution is always between M and M + e (or M - e and M, for negative values of M)
+  ANGLE_T lower = (M >= 0) ? M : M - e;
+  ANGLE_T upper = (M >= 0) ? M + e : M;
+
+  // Danby's starter: E0 = M + 0.85 * e * sign(sin M)
+  ANGLE_T E = (M >= 0) ? M + 0.85 * e : M - 0.85 * e;
+
+  // Halley iterations: E1 = E - f / (f' - f * f'' / (2 * f')), with f = E - e*sin(E) - M
+  for (int iter = 0; iter < KEPLER_MAX_ITERATIONS; iter++) {
+    sin_E = sin(E);
+    cos_E = cos(E);
+    double e_sin_E = e * sin_E;
+    double f = E - e_sin_E - M;
+    double df = 1 - e * cos_E;
+
+    // Narrow the bracket of the solution (f is monotonically increasing)
+    if (f > 0)
+      upper = E;
+    else
+      lower = E;
+
+    ANGLE_T delta = f / df;
+    delta = f / (df - 0.5 * delta * e_sin_E);
+    E -= delta;
+    // The sine and cosine of the solution are corrected with the last step, instead of calculating them again (the error is below the 
+    //      tolerance squared)
+    if (std::abs(delta) < tolerance) {
+      double sin_E_old = sin_E;
+      sin_E -= delta * cos_E;
+      cos_E += delta * sin_E_old;
+      return E + revs * TWO_PI;
+    }
+
+    // Fall back to bisection if the step leaves the bracket (only possible for e close to 1). A step just beyond the bracket (by less than the 
+    //      tolerance) is the rounding of a solution at its limit (M close to 0 or PI), and it converges in the next iteration
+    if (E < lower - tolerance || E > upper + tolerance)
+      E = 0.5 * (lower + upper);
+  }
+
+  sin_E = sin(E);
+  cos_E = cos(E);
+  return E + revs * TWO_PI;
+}
+
+
+/*   units::ANGLE_T solveKeplerHyperbolic(units::ANGLE_T mean_anomaly, units::LENGTH_T e)   */
+/********************************************************************************************/
+ANGLE_T KeplerOrbit::solveKeplerHyperbolic(ANGLE_T mean_anomaly, LENGTH_T e) {
+  // Starter: H0 = sign(M) * ln(2 * |M| / e + 1.8)
+  ANGLE_T H = std::copysign(log(2 * std::abs(mean_anomaly) / e + 1.8), mean_anomaly);
+
+  // Halley iterations: H1 = H - f / (f' - f * f'' / (2 * f')), with f = e*sinh(H) - H - M
+  for (int iter = 0; iter < 4 * KEPLER_MAX_ITERATIONS; iter++) {
+    double e_sinh_H = e * sinh(H);
+    double f = e_sinh_H - H - mean_anomaly;
+    double df = e * cosh(H) - 1;
+
+    ANGLE_T delta = f / df;
+    delta = f / (df - 0.5 * delta * e_sinh_H);
+    H -= delta;
+    if (std::abs(delta) < KEPLER_TOLERANCE * std::max(1.0, std::abs(H)))
+      break;
+  }
+
+  return H;
+}
+
+
 /*   void KeplerOrbit::extParams()   */
 /*************************************/
 void KeplerOrbit::extParams() {
   ANGLE_T cos_anomaly = std::cos(_anomaly);
   ANGLE_T e_cos_anomaly = _e * cos_anomaly;
 
+  // Hyperbolic orbits:
+  //    tanh(H/2) = sqrt((e-1)/(e+1)) * tan(anomaly/2)
+  //    M = e*sinh H - H  (negative before the periapsis)
+  if (_e >= 1) {
+    ANGLE_T anomaly = (_anomaly > PI) ? _anomaly - TWO_PI : _anomaly;
+    _ecc_anomaly = 2 * atanh(sqrt((_e - 1) / (_e + 1)) * tan(anomaly / 2));
+    _mean_anomaly = _e * sinh(_ecc_anomaly) - _ecc_anomaly;
+    _time_periapsis = TIME_T(TIME_T::rep(_mean_anomaly / meanMotion()));
+    return;
+  }
+
   // Eccentric anomaly
   //    cos E = (e+cos(anomaly)) / (1+e*cos(anomaly))
   //    sin E = (sqr(1-e*e)*sin(anomaly)) / (1+e*cos(anomaly))
@@ -252,6 +458,34 @@ void KeplerOrbit::extParams() {
 }
 
 
+/*    void KeplerOrbit::perifocalBasis()   */
+/*******************************************/
+void KeplerOrbit::perifocalBasis() {
+  perifocalBasis(_i, _asc_node, _periapsis, _perifocal_p, _perifocal_q);
+}
+
+
+/*    void KeplerOrbit::perifocalBasis(units::ANGLE_T i, units::ANGLE_T asc_node, units::ANGLE_T periapsis, Vec3& p, Vec3& q)   */
+/*******************************************************************************************************************************/
+void KeplerOrbit::perifocalBasis(ANGLE_T i, ANGLE_T asc_node, ANGLE_T periapsis, Vec3<LENGTH_T>& p, Vec3<LENGTH_T>& q) {
+  // ROTATION Matrices, used to determine the orientation of the orbit
+  //      1. Around the z axis by asc_node
+  //      2. Around the asc_node axis by i
+  //          (orb_u_z is the result of rotating u_z around the asc_node axis by i)
+  //      3. Around the orb_u_z axis by periapsis
+  Mat3<LENGTH_T> rot_z_asc_node = Eigen::AngleAxis<LENGTH_T>(asc_node, Vec3<LENGTH_T>::UnitZ()).toRotationMatrix();
+  Vec3<LENGTH_T> u_asc_node{ cos(asc_node), sin(asc_node), 0.0 };
+  Mat3<LENGTH_T> rot_u_asc_node_i = Eigen::AngleAxis<LENGTH_T>(i, u_asc_node).toRotationMatrix();
+  Vec3<LENGTH_T> orb_u_z = rot_u_asc_node_i * Vec3<LENGTH_T>::UnitZ();
+  Mat3<LENGTH_T> rot_orb_z_periapsis = Eigen::AngleAxis<LENGTH_T>(periapsis, orb_u_z).toRotationMatrix();
+
+  // The 3 rotations applied to the x and y axes of the orbital plane provide the perifocal basis
+  Mat3<LENGTH_T> rot = rot_orb_z_periapsis * rot_u_asc_node_i * rot_z_asc_node;
+  p = rot.col(0);
+  q = rot.col(1);
+}
+
+
 /*    void KeplerOrbit::cartesianParams()   */
 /********************************************/
 void KeplerOrbit::cartesianParams() {
@@ -269,34 +503,6 @@ void KeplerOrbit::cartesianParams() {
   LENGTH_T sin_anomaly = sin(_anomaly);
   LENGTH_T one_plus_e_cos_anomaly = 1 + _e * cos_anomaly;
   LENGTH_T radius = p / one_plus_e_cos_anomaly;
-    
-  _position.x() = radius * cos_anomaly;
-  _position.y() = radius * sin_anomaly;
-  _position.z() = 0;
-
-
-  // ROTATION Matrices, used to determine position and velocity
-  //      1. Around the z axis by asc_node
-  //      2. Around the asc_node axis by i
-  //          (orb_u_z is the result of rotating u_z around the asc_node axis by i)
-  //      3. Around the orb_u_z axis by periapsis
-      //           IMPROVEMENTS!!!!! 
-    //                - reuse rotation matrix
-  Mat3<LENGTH_T> _rot_z_asc_node; // Rotation matrix around the z axis by asc_node
-  Mat3<LENGTH_T> _rot_u_asc_node_i; // Rotation matrix around the asc_node axis by i
-  Mat3<LENGTH_T> _rot_orb_z_periapsis; // Rotation matrix around the z axis of the orbit plane by periapsis
-  _rot_z_asc_node = Eigen::AngleAxis<LENGTH_T>(_asc_node, Vec3<LENGTH_T>::UnitZ()).toRotationMatrix();
-  Vec3<LENGTH_T> u_asc_node{ cos(_asc_node), sin(_asc_node), 0.0 };
-  _rot_u_asc_node_i = Eigen::AngleAxis<LENGTH_T>(_i, u_asc_node).toRotationMatrix();
-  Vec3<LENGTH_T> orb_u_z = _rot_u_asc_node_i * Vec3<LENGTH_T>::UnitZ();
-  _rot_orb_z_periapsis = Eigen::AngleAxis<LENGTH_T>(_periapsis, orb_u_z).toRotationMatrix();
-
-
-  // Rotate the coordinates 3 times:
-  //      1. Around the z axis by asc_node
-  //      2. Around the asc_node axis by i
-  //      3. Around the orb_u_z axis by periapsis
-  _position = _rot_orb_z_periapsis * (_rot_u_asc_node_i * (_rot_z_asc_node * _position.vec()));
 
 
   // BEGIN: Calculate velocity in the orbital plane:
@@ -308,19 +514,11 @@ void KeplerOrbit::cartesianParams() {
   //    Tangential velocity (tangential to the radius vector)
   SPEED_T tan_v = sqrt(_mu / p) * one_plus_e_cos_anomaly;
 
-  _velocity.x() = rad_v * cos_anomaly - tan_v * sin_anomaly;
-  _velocity.y() = rad_v * sin_anomaly + tan_v * cos_anomaly;
-  _velocity.z() = 0;
-
   // END: Calculate velocity in the orbital plane
 
-  // Rotate the coordinates 3 times:
-  //      1. Around the z axis by asc_node
-  //      2. Around the asc_node axis by i
-  //          (orb_u_z is the result of rotating u_z around the asc_node axis by i)
-  //      3. Around the orb_u_z axis by periapsis
-  _velocity = _rot_orb_z_periapsis * (_rot_u_asc_node_i * (_rot_z_asc_node * _velocity));
-
+  // Express position and velocity in the primary CS using the cached perifocal basis (equivalent to the 3 rotations)
+  _position = radius * (cos_anomaly * _perifocal_p + sin_anomaly * _perifocal_q);
+  _velocity = (rad_v * cos_anomaly - tan_v * sin_anomaly) * _perifocal_p + (rad_v * sin_anomaly + tan_v * cos_anomaly) * _perifocal_q;
 }
 
 
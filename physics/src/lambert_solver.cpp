@@ -0,0 +1,230 @@
+#include <physics/lambert_solver.h>
+
+#include <stdexcept>
+#include <cmath>
+#include <algorithm>
+
+#include <Eigen/Geometry>
+
+#include <geometry/constants.h>
+
+using namespace physics;
+using namespace physics::units;
+using namespace geometry;
+
+
+/*   size_t solve(const Problem& problem, size_t max_revolutions, Solution* solutions)   */
+/*****************************************************************************************/
+size_t LambertSolver::solve(const Problem& problem, size_t max_revolutions, Solution* solutions) {
+  if (problem.tof <= 0 || problem.mu <= 0)
+    throw std::invalid_argument("LambertSolver: the time of flight and the reduced mass must be positive");
+
+  const LENGTH_T R1 = problem.r1.norm();
+  const LENGTH_T R2 = problem.r2.norm();
+  if (R1 <= 0 || R2 <= 0)
+    throw std::invalid_argument("LambertSolver: the positions cannot be 0");
+
+  for (size_t i = 0; i < solutionsPerProblem(max_revolutions); i++)
+    solutions[i].valid = false;
+
+  // 1. Geometry of the transfer: chord c, semiperimeter s and the radial and tangential unit vectors at both positions
+  const LENGTH_T c = (problem.r2 - problem.r1).norm();
+  const LENGTH_T s = (c + R1 + R2) / 2;
+  const Vec3<LENGTH_T> ir1 = problem.r1 / R1;
+  const Vec3<LENGTH_T> ir2 = problem.r2 / R2;
+  Vec3<LENGTH_T> ih = ir1.cross(ir2);
+  const double ih_norm = ih.norm();
+  // The plane of the transfer is not defined if the positions are aligned with the primary body
+  if (ih_norm < 1e-12)
+    return 0;
+  ih /= ih_norm;
+
+  //    lambda = +-sqrt(1 - c/s): negative for a transfer angle above PI
+  const double lambda2 = 1 - c / s;
+  double lambda = sqrt(std::max(0.0, lambda2));
+  Vec3<LENGTH_T> it1, it2;
+  if (ih.z() < 0) {
+    lambda = -lambda;
+    it1 = ir1.cross(ih);
+    it2 = ir2.cross(ih);
+  }
+  else {
+    it1 = ih.cross(ir1);
+    it2 = ih.cross(ir2);
+  }
+  it1.normalize();
+  it2.normalize();
+  if (!problem.prograde) {
+    lambda = -lambda;
+    it1 = -it1;
+    it2 = -it2;
+  }
+  const double lambda3 = lambda * lambda2;
+
+  // 2. Non-dimensional time of flight and maximum number of revolutions
+  const double T = sqrt(2 * problem.mu / (s * s * s)) * problem.tof;
+  size_t N_max = size_t(T / PI);
+  const double T00 = acos(lambda) + lambda * sqrt(1 - lambda2);
+  const double T1 = 2.0 / 3.0 * (1 - lambda3);
+
+  //    With N_max revolutions, the minimum time of flight (where dT/dx = 0) can be above T. It is found with Halley iterations
+  if (N_max > 0 && T < T00 + N_max * PI) {
+    double x_old{ 0 }, T_min{ T00 + N_max * PI };
+    for (size_t iter = 0; iter < MAX_ITERATIONS; iter++) {
+      double dT, ddT, dddT;
+      derivatives(x_old, T_min, lambda, dT, ddT, dddT);
+      double x_new = (dT != 0) ? x_old - dT * ddT / (ddT * ddT - dT * dddT / 2) : x_old;
+      bool converged = std::abs(x_old - x_new) < 1e-13;
+      x_old = x_new;
+      T_min = timeOfFlight(x_old, lambda, N_max);
+      if (converged)
+        break;
+    }
+    if (T_min > T)
+      N_max--;
+  }
+  N_max = std::min(N_max, max_revolutions);
+
+  // 3. Solutions for x
+  //    Direct transfer, from an initial guess of T(x) in 3 regions
+  double x0;
+  if (T >= T00)
+    x0 = -(T - T00) / (T - T00 + 4);
+  else if (T <= T1)
+    x0 = T1 * (T1 - T) / (2.0 / 5.0 * (1 - lambda2 * lambda3) * T) + 1;
+  else
+    x0 = pow(T / T00, 0.69314718055994529 / log(T1 / T00)) - 1;
+  double x[64];
+  x[0] = householder(T, x0, lambda, 0, 1e-5);
+
+  //    Multiple revolutions: the left and right branches (initial guesses from the approximation of T(x) for large N)
+  N_max = std::min(N_max, size_t(31));
+  for (size_t N = 1; N <= N_max; N++) {
+    double tmp = pow((N * PI + PI) / (8 * T), 2.0 / 3.0);
+    x[2 * N - 1] = householder(T, (tmp - 1) / (tmp + 1), lambda, N, 1e-8);
+    tmp = pow(8 * T / (N * PI), 2.0 / 3.0);
+    x[2 * N] = householder(T, (tmp - 1) / (tmp + 1), lambda, N, 1e-8);
+  }
+
+  // 4. Velocities: radial and tangential components
+  const double gamma = sqrt(problem.mu * s / 2);
+  const double rho = (R1 - R2) / c;
+  const double sigma = sqrt(std::max(0.0, 1 - rho * rho));
+  size_t valid{ 0 };
+  for (size_t i = 0; i < 2 * N_max + 1; i++) {
+    const double y = sqrt(1 - lambda2 + lambda2 * x[i] * x[i]);
+    const double v_r1 = gamma * ((lambda * y - x[i]) - rho * (lambda * y + x[i])) / R1;
+    const double v_r2 = -gamma * ((lambda * y - x[i]) + rho * (lambda * y + x[i])) / R2;
+    const double v_t = gamma * sigma * (y + lambda * x[i]);
+
+    Solution& solution = solutions[i];
+    solution.v1 = v_r1 * ir1 + v_t / R1 * it1;
+    solution.v2 = v_r2 * ir2 + v_t / R2 * it2;
+    solution.revolutions = uint32_t((i + 1) / 2);
+    solution.valid = std::isfinite(solution.v1.squaredNorm()) && std::isfinite(solution.v2.squaredNorm());
+    if (solution.valid)
+      valid++;
+  }
+
+  return valid;
+}
+
+
+/*   void solve(const std::vector<Problem>& problems, size_t max_revolutions, std::vector<Solution>& solutions)   */
+/******************************************************************************************************************/
+void LambertSolver::solve(const std::vector<Problem>& problems, size_t max_revolutions, std::vector<Solution>& solutions) {
+  const size_t per_problem = solutionsPerProblem(max_revolutions);
+  solutions.resize(problems.size() * per_problem);
+
+  _pool.parallelFor(0, problems.size(), CHUNK, [&](size_t first, size_t last) {
+    for (size_t index = first; index < last; index++)
+      solve(problems[index], max_revolutions, &solutions[index * per_problem]);
+  });
+}
+
+
+/*   double timeOfFlight(double x, double lambda, size_t N)   */
+/**************************************************************/
+double LambertSolver::timeOfFlight(double x, double lambda, size_t N) {
+  const double battin{ 0.01 };
+  const double lagrange{ 0.2 };
+  const double distance = std::abs(x - 1);
+
+  // Lagrange: T = (a^(3/2) * ((alpha - sin alpha) - (beta - sin beta) + 2*PI*N)) / 2, with a = 1 / (1 - x^2) (hyperbolic functions if a < 0)
+  if (distance >= battin && distance < lagrange) {
+    const double a = 1 / (1 - x * x);
+    if (a > 0) {
+      const double alpha = 2 * acos(x);
+      const double beta = std::copysign(2 * asin(sqrt(lambda * lambda / a)), lambda);
+      return a * sqrt(a) * ((alpha - sin(alpha)) - (beta - sin(beta)) + 2 * PI * N) / 2;
+    }
+    const double alpha = 2 * acosh(x);
+    const double beta = std::copysign(2 * asinh(sqrt(-lambda * lambda / a)), lambda);
+    return -a * sqrt(-a) * ((beta - sinh(beta)) - (alpha - sinh(alpha))) / 2;
+  }
+
+  const double E = x * x - 1;
+  const double rho = std::abs(E);
+  const double z = sqrt(1 + lambda * lambda * E);
+
+  // Battin: T = (eta^3 * Q + 4 * lambda * eta) / 2 + N*PI / rho^(3/2), with the hypergeometric function Q = 4/3 * F(3, 1, 5/2, S1)
+  if (distance < battin) {
+    const double eta = z - lambda * x;
+    const double S1 = 0.5 * (1 - lambda - x * eta);
+    double F{ 1 }, term{ 1 };
+    for (size_t j = 0; std::abs(term) > 1e-11; j++) {
+      term *= (3 + j) * (1 + j) / (2.5 + j) * S1 / (j + 1);
+      F += term;
+    }
+    const double Q = 4.0 / 3.0 * F;
+    return (eta * eta * eta * Q + 4 * lambda * eta) / 2 + N * PI / pow(rho, 1.5);
+  }
+
+  // Lancaster-Blanchard: T = (x - lambda * z - d / y) / E
+  const double y = sqrt(rho);
+  const double g = x * z - lambda * E;
+  double d;
+  if (E < 0)
+    d = N * PI + acos(std::max(-1.0, std::min(1.0, g)));
+  else
+    d = log(y * (z - lambda * x) + g);
+  return (x - lambda * z - d / y) / E;
+}
+
+
+/*   void derivatives(double x, double T, double lambda, double& dT, double& ddT, double& dddT)   */
+/**************************************************************************************************/
+void LambertSolver::derivatives(double x, double T, double lambda, double& dT, double& ddT, double& dddT) {
+  const double lambda2 = lambda * lambda;
+  const double lambda3 = lambda2 * lambda;
+  const double umx2 = 1 - x * x;
+  const double y = sqrt(1 - lambda2 * umx2);
+  const double y2 = y * y;
+  const double y3 = y2 * y;
+
+  dT = (3 * T * x - 2 + 2 * lambda3 * x / y) / umx2;
+  ddT = (3 * T + 5 * x * dT + 2 * (1 - lambda2) * lambda3 / y3) / umx2;
+  dddT = (7 * x * ddT + 8 * dT - 6 * (1 - lambda2) * lambda2 * lambda3 * x / y3 / y2) / umx2;
+}
+
+
+/*   double householder(double T, double x, double lambda, size_t N, double tolerance)   */
+/*****************************************************************************************/
+double LambertSolver::householder(double T, double x, double lambda, size_t N, double tolerance) {
+  for (size_t iter = 0; iter < MAX_ITERATIONS; iter++) {
+    const double tof = timeOfFlight(x, lambda, N);
+    double dT, ddT, dddT;
+    derivatives(x, tof, lambda, dT, ddT, dddT);
+
+    // x1 = x - delta * (dT^2 - delta * ddT / 2) / (dT * (dT^2 - delta * ddT) + dddT * delta^2 / 6), with delta = T(x) - T
+    const double delta = tof - T;
+    const double dT2 = dT * dT;
+    const double x_new = x - delta * (dT2 - delta * ddT / 2) / (dT * (dT2 - delta * ddT) + dddT * delta * delta / 6);
+    const bool converged = std::abs(x_new - x) < tolerance;
+    x = x_new;
+    if (converged)
+      break;
+  }
+
+  return x;
+}
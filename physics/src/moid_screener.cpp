@@ -0,0 +1,199 @@
+#include <physics/moid_screener.h>
+
+#include <stdexcept>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+#include <geometry/constants.h>
+
+using namespace physics;
+using namespace physics::units;
+using namespace geometry;
+
+
+/*   Ellipse(const KeplerOrbit& orbit)   */
+/*****************************************/
+MoidScreener::Ellipse::Ellipse(const KeplerOrbit& orbit) {
+  const LENGTH_T a = orbit.a();
+  const LENGTH_T e = orbit.e();
+  if (a <= 0 || e < 0 || e >= 1)
+    throw std::invalid_argument("MoidScreener: the orbits must be elliptic");
+
+  p = a * orbit.perifocalP();
+  q = a * sqrt(1 - e * e) * orbit.perifocalQ();
+  c = -e * p;
+  perihelion = a * (1 - e);
+  aphelion = a * (1 + e);
+  this->a = a;
+}
+
+
+/*   CONSTRUCTOR   */
+/*******************/
+MoidScreener::MoidScreener(size_t num_threads, size_t grid_size) : _pool{ num_threads }, _grid_size{ grid_size } {
+  if (_grid_size < 4)
+    throw std::invalid_argument("MoidScreener: the grid size must be at least 4");
+
+  _cos.resize(_grid_size);
+  _sin.resize(_grid_size);
+  for (size_t i = 0; i < _grid_size; i++) {
+    _cos[i] = cos(TWO_PI * i / _grid_size);
+    _sin[i] = sin(TWO_PI * i / _grid_size);
+  }
+}
+
+
+/*   LENGTH_T moid(const KeplerOrbit& orbit_1, const KeplerOrbit& orbit_2) const   */
+/***********************************************************************************/
+LENGTH_T MoidScreener::moid(const KeplerOrbit& orbit_1, const KeplerOrbit& orbit_2) const {
+  std::vector<Vec3<LENGTH_T>> points;
+  std::vector<double> grid;
+  return moid(Ellipse(orbit_1), Ellipse(orbit_2), std::numeric_limits<LENGTH_T>::infinity(), points, grid);
+}
+
+
+/*   void screen(...)   */
+/************************/
+void MoidScreener::screen(const std::vector<const KeplerOrbit*>& bodies, const std::vector<const KeplerOrbit*>& targets, LENGTH_T threshold,
+                          std::vector<Candidate>& candidates) {
+  candidates.clear();
+  _calculated = 0;
+
+  std::vector<Ellipse> target_ellipses;
+  target_ellipses.reserve(targets.size());
+  for (auto target : targets)
+    target_ellipses.emplace_back(*target);
+
+  _pool.parallelFor(0, bodies.size(), CHUNK, [&](size_t first, size_t last) {
+    std::vector<Vec3<LENGTH_T>> points;
+    std::vector<double> grid;
+    std::vector<Candidate> chunk_candidates;
+    size_t calculated{ 0 };
+
+    for (size_t body = first; body < last; body++) {
+      const Ellipse ellipse(*bodies[body]);
+      for (size_t target = 0; target < target_ellipses.size(); target++) {
+        // The distance between the orbits is at least the gap between their ranges of distances to the primary
+        if (ellipse.perihelion > target_ellipses[target].aphelion + threshold || target_ellipses[target].perihelion > ellipse.aphelion + threshold)
+          continue;
+
+        ++calculated;
+        LENGTH_T distance = moid(ellipse, target_ellipses[target], threshold, points, grid);
+        if (distance <= threshold)
+          chunk_candidates.push_back(Candidate{ body, target, distance });
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    candidates.insert(candidates.end(), chunk_candidates.begin(), chunk_candidates.end());
+    _calculated += calculated;
+  });
+
+  // The chunks are finished in any order
+  std::sort(candidates.begin(), candidates.end(), [](const Candidate& c1, const Candidate& c2) {
+    return c1.body < c2.body || (c1.body == c2.body && c1.target < c2.target);
+  });
+}
+
+
+/*   LENGTH_T moid(const Ellipse& ellipse_1, const Ellipse& ellipse_2, ...) const   */
+/**********************************************************************************/
+LENGTH_T MoidScreener::moid(const Ellipse& ellipse_1, const Ellipse& ellipse_2, LENGTH_T threshold, std::vector<Vec3<LENGTH_T>>& points, 
+                            std::vector<double>& grid) const {
+  const size_t N = _grid_size;
+
+  // Points of both orbits: [0, N) in the first one and [N, 2N) in the second one
+  points.resize(2 * N);
+  for (size_t i = 0; i < N; i++) {
+    points[i] = ellipse_1.point(_cos[i], _sin[i]);
+    points[N + i] = ellipse_2.point(_cos[i], _sin[i]);
+  }
+
+  grid.resize(N * N);
+  for (size_t i = 0; i < N; i++) {
+    for (size_t j = 0; j < N; j++)
+      grid[i * N + j] = (points[i] - points[N + j]).squaredNorm();
+  }
+
+  // Every local minimum of the grid (the anomalies are periodic) is refined, unless it is too far: the speed along an orbit, |r'(E)|, is at most a,
+  // so any point of the orbits is within a * PI / N of a point of the grid
+  double min_squared_distance = *std::min_element(grid.begin(), grid.end());
+  const double limit = threshold + (ellipse_1.a + ellipse_2.a) * PI / N;
+  const double squared_limit = limit * limit;
+  for (size_t i = 0; i < N; i++) {
+    for (size_t j = 0; j < N; j++) {
+      const double value = grid[i * N + j];
+      bool minimum{ value <= squared_limit };
+      for (size_t di = N - 1; di <= N + 1 && minimum; di++) {
+        for (size_t dj = N - 1; dj <= N + 1 && minimum; dj++)
+          minimum = grid[((i + di) % N) * N + (j + dj) % N] >= value;
+      }
+      if (minimum)
+        min_squared_distance = std::min(min_squared_distance, refine(ellipse_1, ellipse_2, TWO_PI * i / N, TWO_PI * j / N, value));
+    }
+  }
+
+  return sqrt(min_squared_distance);
+}
+
+
+/*   double refine(const Ellipse& ellipse_1, const Ellipse& ellipse_2, double E1, double E2, double squared_distance) const   */
+/*****************************************************************************************************************************/
+double MoidScreener::refine(const Ellipse& ellipse_1, const Ellipse& ellipse_2, double E1, double E2, double squared_distance) const {
+  // Minimum of f(E1, E2) = |r1(E1) - r2(E2)|^2 / 2, with r'(E) = -sin(E) * p + cos(E) * q and r''(E) = -cos(E) * p - sin(E) * q
+  for (size_t iteration = 0; iteration < NEWTON_ITERATIONS; iteration++) {
+    const double cos_1 = cos(E1), sin_1 = sin(E1), cos_2 = cos(E2), sin_2 = sin(E2);
+    const Vec3<LENGTH_T> delta = ellipse_1.point(cos_1, sin_1) - ellipse_2.point(cos_2, sin_2);
+    const Vec3<LENGTH_T> d1 = -sin_1 * ellipse_1.p + cos_1 * ellipse_1.q;
+    const Vec3<LENGTH_T> d2 = -sin_2 * ellipse_2.p + cos_2 * ellipse_2.q;
+    const Vec3<LENGTH_T> dd1 = -cos_1 * ellipse_1.p - sin_1 * ellipse_1.q;
+    const Vec3<LENGTH_T> dd2 = -cos_2 * ellipse_2.p - sin_2 * ellipse_2.q;
+
+    const double g1 = delta.dot(d1);
+    const double g2 = -delta.dot(d2);
+    double h11 = d1.squaredNorm() + delta.dot(dd1);
+    double h22 = d2.squaredNorm() - delta.dot(dd2);
+    const double h12 = -d1.dot(d2);
+
+    // Far from the minimum the Hessian may not be positive definite: then the Gauss-Newton approximation is used
+    if (h11 <= 0 || h11 * h22 - h12 * h12 <= 0) {
+      h11 = d1.squaredNorm();
+      h22 = d2.squaredNorm();
+    }
+    const double det = h11 * h22 - h12 * h12;
+    if (det <= 0)
+      break;
+
+    double step_1 = -(h22 * g1 - h12 * g2) / det;
+    double step_2 = -(h11 * g2 - h12 * g1) / det;
+
+    // The step is limited to the spacing of the grid, and halved until the distance decreases
+    const double max_step = TWO_PI / _grid_size;
+    const double step = std::max(std::abs(step_1), std::abs(step_2));
+    if (step > max_step) {
+      step_1 *= max_step / step;
+      step_2 *= max_step / step;
+    }
+
+    bool improved{ false };
+    for (size_t halving = 0; halving < 16 && !improved; halving++) {
+      const double new_squared_distance = (ellipse_1.point(cos(E1 + step_1), sin(E1 + step_1)) - ellipse_2.point(cos(E2 + step_2), sin(E2 + step_2))).squaredNorm();
+      if (new_squared_distance < squared_distance) {
+        squared_distance = new_squared_distance;
+        E1 += step_1;
+        E2 += step_2;
+        improved = true;
+      }
+      else {
+        step_1 *= 0.5;
+        step_2 *= 0.5;
+      }
+    }
+
+    if (!improved || std::max(std::abs(step_1), std::abs(step_2)) < 1e-12)
+      break;
+  }
+
+  return squared_distance;
+}
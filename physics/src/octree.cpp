@@ -0,0 +1,166 @@
+#include <physics/octree.h>
+
+#include <stdexcept>
+#include <numeric>
+#include <cmath>
+
+using namespace physics;
+using namespace physics::units;
+using namespace geometry;
+
+
+/*   void build(const std::vector<Vec3<LENGTH_T>>& positions, const std::vector<REDUCED_MASS_T>& masses)   */
+/*********************************************************************************************************/
+void Octree::build(const std::vector<Vec3<LENGTH_T>>& positions, const std::vector<REDUCED_MASS_T>& masses) {
+  if (positions.size() != masses.size())
+    throw std::invalid_argument("Octree: the number of positions and masses do not match");
+
+  _positions = &positions;
+  _masses = &masses;
+
+  _nodes.clear();
+  _order.resize(positions.size());
+  _buffer.resize(positions.size());
+  std::iota(_order.begin(), _order.end(), 0);
+
+  if (positions.empty())
+    return;
+
+  // Root node: the smallest cube containing all the bodies
+  Vec3<LENGTH_T> min_corner = positions[0];
+  Vec3<LENGTH_T> max_corner = positions[0];
+  for (auto& position : positions) {
+    min_corner = min_corner.cwiseMin(position);
+    max_corner = max_corner.cwiseMax(position);
+  }
+
+  Node root;
+  root.center = 0.5 * (min_corner + max_corner);
+  root.half_size = 0.5 * (max_corner - min_corner).maxCoeff();
+  root.children = 0;
+  root.first = 0;
+  root.count = uint32_t(positions.size());
+  _nodes.push_back(root);
+
+  split(0, 0);
+}
+
+
+/*   Vec3<ACCELERATION_T> acceleration(const Vec3<LENGTH_T>& position, size_t exclude) const   */
+/*********************************************************************************************/
+Vec3<ACCELERATION_T> Octree::acceleration(const Vec3<LENGTH_T>& position, size_t exclude) const {
+  Vec3<ACCELERATION_T> acceleration{ 0.0, 0.0, 0.0 };
+  if (_nodes.empty())
+    return acceleration;
+
+  // Depth first traversal: each visited node adds at most 8 nodes to the stack
+  uint32_t stack[8 * MAX_DEPTH + 8];
+  size_t top{ 0 };
+  stack[top++] = 0;
+
+  while (top) {
+    const Node& node = _nodes[stack[--top]];
+
+    //    Leaf node: direct calculation for its bodies
+    if (node.children == 0) {
+      for (uint32_t i = node.first; i < node.first + node.count; i++) {
+        uint32_t body = _order[i];
+        if (body == exclude)
+          continue;
+        Vec3<LENGTH_T> distance = (*_positions)[body] - position;
+        LENGTH_T l_distance_squared = distance.squaredNorm();
+        if (l_distance_squared > 0)
+          acceleration += (*_masses)[body] / (l_distance_squared * sqrt(l_distance_squared)) * distance;
+      }
+      continue;
+    }
+
+    //    Distant node (and not containing the position): its bodies are approximated by a single body at the center of mass
+    Vec3<LENGTH_T> distance = node.mass_center - position;
+    LENGTH_T l_distance = distance.norm();
+    bool inside = (position - node.center).cwiseAbs().maxCoeff() <= node.half_size;
+    if (!inside && 2 * node.half_size < _opening_angle * l_distance) {
+      acceleration += node.mass / (l_distance * l_distance * l_distance) * distance;
+      continue;
+    }
+
+    //    Otherwise, visit the children
+    for (uint32_t child = node.children; child < node.children + 8; child++) {
+      if (_nodes[child].count)
+        stack[top++] = child;
+    }
+  }
+
+  return acceleration;
+}
+
+
+/*   void split(uint32_t node, size_t depth)   */
+/***********************************************/
+void Octree::split(uint32_t node_index, size_t depth) {
+  // Copy of the node, since the vector can be reallocated when the children are added
+  Node node = _nodes[node_index];
+
+  //    Leaf node: mass and center of mass of its bodies
+  if (node.count <= _leaf_size || depth >= MAX_DEPTH) {
+    REDUCED_MASS_T mass{ 0 };
+    Vec3<LENGTH_T> moment{ 0.0, 0.0, 0.0 };
+    for (uint32_t i = node.first; i < node.first + node.count; i++) {
+      REDUCED_MASS_T body_mass = (*_masses)[_order[i]];
+      mass += body_mass;
+      moment += body_mass * (*_positions)[_order[i]];
+    }
+    _nodes[node_index].mass = mass;
+    _nodes[node_index].mass_center = (mass > 0) ? Vec3<LENGTH_T>(moment / mass) : node.center;
+    return;
+  }
+
+  //    Sort the bodies of the node by octant (counting sort). Octant bits: x (1), y (2), z (4), set if the coordinate is >= the center
+  auto octant = [&node](const Vec3<LENGTH_T>& position) {
+    return (position.x() >= node.center.x() ? 1 : 0) | (position.y() >= node.center.y() ? 2 : 0) | (position.z() >= node.center.z() ? 4 : 0);
+  };
+
+  uint32_t counts[8]{ 0 };
+  for (uint32_t i = node.first; i < node.first + node.count; i++)
+    counts[octant((*_positions)[_order[i]])]++;
+
+  uint32_t offsets[8];
+  offsets[0] = node.first;
+  for (int oct = 1; oct < 8; oct++)
+    offsets[oct] = offsets[oct - 1] + counts[oct - 1];
+
+  uint32_t next[8];
+  std::copy(offsets, offsets + 8, next);
+  for (uint32_t i = node.first; i < node.first + node.count; i++)
+    _buffer[next[octant((*_positions)[_order[i]])]++] = _order[i];
+  std::copy(_buffer.begin() + node.first, _buffer.begin() + node.first + node.count, _order.begin() + node.first);
+
+  //    Children: 8 consecutive nodes
+  uint32_t children = uint32_t(_nodes.size());
+  _nodes[node_index].children = children;
+  for (int oct = 0; oct < 8; oct++) {
+    Node child;
+    child.half_size = 0.5 * node.half_size;
+    child.center = node.center + Vec3<LENGTH_T>((oct & 1) ? child.half_size : -child.half_size,
+                                                (oct & 2) ? child.half_size : -child.half_size,
+                                                (oct & 4) ? child.half_size : -child.half_size);
+    child.mass = 0;
+    child.mass_center = child.center;
+    child.children = 0;
+    child.first = offsets[oct];
+    child.count = counts[oct];
+    _nodes.push_back(child);
+  }
+
+  //    Mass and center of mass, from the children
+  REDUCED_MASS_T mass{ 0 };
+  Vec3<LENGTH_T> moment{ 0.0, 0.0, 0.0 };
+  for (uint32_t child = children; child < children + 8; child++) {
+    if (_nodes[child].count)
+      split(child, depth + 1);
+    mass += _nodes[child].mass;
+    moment += _nodes[child].mass * _nodes[child].mass_center;
+  }
+  _nodes[node_index].mass = mass;
+  _nodes[node_index].mass_center = (mass > 0) ? Vec3<LENGTH_T>(moment / mass) : node.center;
+}
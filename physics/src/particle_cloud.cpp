@@ -0,0 +1,95 @@
+#include <physics/particle_cloud.h>
+
+#include <stdexcept>
+#include <cmath>
+#include <random>
+
+#include <geometry/constants.h>
+#include <physics/kepler_orbit.h>
+
+using namespace physics;
+using namespace physics::units;
+
+
+/**
+  *  \brief  Tolerance of Kepler's equation. The positions are single precision, so the eccentric anomaly is less precise than in the orbits 
+  *          of the bodies (see KeplerOrbit::solveKepler())
+  */
+static constexpr double KEPLER_TOLERANCE{ 1e-8 };
+
+
+/*   void add(...)   */
+/********************/
+void ParticleCloud::add(LENGTH_T a, double e, ANGLE_T i, ANGLE_T raan, ANGLE_T arg_periapsis, ANGLE_T mean_anomaly, TIME_T epoch) {
+  if (a <= 0 || e < 0 || e >= 1)
+    throw std::invalid_argument("ParticleCloud: the orbits of the particles must be elliptical");
+
+  const double mean_motion = std::sqrt(_mu / (a * a * a));
+  const LENGTH_T b = a * std::sqrt(1 - e * e);
+
+  // Perifocal basis: P points to the periapsis, Q is P rotated 90 degrees in the direction of the movement
+  geometry::Vec3<LENGTH_T> p, q;
+  KeplerOrbit::perifocalBasis(i, raan, arg_periapsis, p, q);
+
+  _e.push_back(e);
+  _mean_motion.push_back(mean_motion);
+  _mean_anomaly_0.push_back(mean_anomaly - mean_motion * double(epoch.count()));
+  _ax.push_back(a * p.x());
+  _ay.push_back(a * p.y());
+  _az.push_back(a * p.z());
+  _bx.push_back(b * q.x());
+  _by.push_back(b * q.y());
+  _bz.push_back(b * q.z());
+}
+
+
+/*   void generate(...)   */
+/*************************/
+void ParticleCloud::generate(size_t count, LENGTH_T min_a, LENGTH_T max_a, double max_e, ANGLE_T max_i, uint32_t seed) {
+  if (min_a <= 0 || max_a < min_a || max_e < 0 || max_e >= 1 || max_i < 0)
+    throw std::invalid_argument("ParticleCloud: invalid ranges of the elements");
+
+  std::mt19937 generator(seed);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+  reserve(size() + count);
+  for (size_t particle = 0; particle < count; particle++) {
+    // Uniform in the area of the annulus: a^2 is uniform
+    const LENGTH_T a = std::sqrt(min_a * min_a + uniform(generator) * (max_a * max_a - min_a * min_a));
+    const double e = uniform(generator) * max_e;
+    const ANGLE_T i = uniform(generator) * max_i;
+    const ANGLE_T raan = uniform(generator) * TWO_PI;
+    const ANGLE_T arg_periapsis = uniform(generator) * TWO_PI;
+    add(a, e, i, raan, arg_periapsis, uniform(generator) * TWO_PI);
+  }
+}
+
+
+/*   void reserve(size_t count)   */
+/**********************************/
+void ParticleCloud::reserve(size_t count) {
+  for (auto vec : { &_e, &_mean_motion, &_mean_anomaly_0, &_ax, &_ay, &_az, &_bx, &_by, &_bz })
+    vec->reserve(count);
+}
+
+
+/*   void positions(TIME_T time, size_t first, size_t last, float* positions) const   */
+/**************************************************************************************/
+void ParticleCloud::positions(TIME_T time, size_t first, size_t last, float* positions) const {
+  const double t = double(time.count());
+
+  for (size_t p = first; p < last; ++p) {
+    const double e = _e[p];
+
+    // Eccentric anomaly, from the mean anomaly (any value: it is reduced by the solver)
+    double sin_E, cos_E;
+    KeplerOrbit::solveKepler(_mean_anomaly_0[p] + _mean_motion[p] * t, e, KEPLER_TOLERANCE, sin_E, cos_E);
+
+    const double x = cos_E - e;
+    const double y = sin_E;
+    float* position = positions + 3 * p;
+    position[0] = float(x * _ax[p] + y * _bx[p]);
+    position[1] = float(x * _ay[p] + y * _by[p]);
+    position[2] = float(x * _az[p] + y * _bz[p]);
+  }
+}
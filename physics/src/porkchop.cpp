@@ -0,0 +1,119 @@
+#include <physics/porkchop.h>
+
+#include <stdexcept>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+
+using namespace physics;
+using namespace physics::units;
+using namespace geometry;
+
+
+/*   void generate(...)   */
+/**************************/
+void Porkchop::generate(const KeplerOrbit& departure, const KeplerOrbit& arrival, REDUCED_MASS_T mu, const Grid& grid, std::vector<Cell>& cells) {
+  if (grid.departures == 0 || grid.tofs == 0)
+    throw std::invalid_argument("Porkchop: the grid is empty");
+  if (grid.departure_step.count() <= 0 || grid.tof_step.count() <= 0 || grid.min_tof.count() <= 0)
+    throw std::invalid_argument("Porkchop: the steps and the minimum time of flight must be positive");
+
+  cells.resize(grid.departures * grid.tofs);
+
+  // The arrival times of different departures usually coincide (e.g. steps of whole days), so the states of the arrival body are reused
+  std::unordered_map<TIME_T::rep, std::pair<PBody::PositionType, PBody::VelocityType>> arrival_states;
+  auto arrivalState = [&](TIME_T time) -> const std::pair<PBody::PositionType, PBody::VelocityType>& {
+    auto state = arrival_states.find(time.count());
+    if (state == arrival_states.end())
+      state = arrival_states.emplace(time.count(), arrival.stateAt(double(time.count()))).first;
+    return state->second;
+  };
+
+  const size_t per_problem = LambertSolver::solutionsPerProblem(grid.max_revolutions);
+  std::vector<std::pair<PBody::PositionType, PBody::VelocityType>> departure_states;
+  for (size_t first = 0; first < grid.departures; first += BLOCK_DEPARTURES) {
+    const size_t last = std::min(grid.departures, first + BLOCK_DEPARTURES);
+
+    // The arrival states before the first arrival of the block are not used any more
+    const TIME_T first_arrival = grid.first_departure + grid.departure_step * TIME_T::rep(first) + grid.min_tof;
+    for (auto state = arrival_states.begin(); state != arrival_states.end(); ) {
+      if (state->first < first_arrival.count())
+        state = arrival_states.erase(state);
+      else
+        ++state;
+    }
+
+    // 1. Problems of the block
+    _problems.clear();
+    departure_states.clear();
+    for (size_t dep = first; dep < last; dep++) {
+      const TIME_T departure_time = grid.first_departure + grid.departure_step * TIME_T::rep(dep);
+      departure_states.push_back(departure.stateAt(double(departure_time.count())));
+      for (size_t tof = 0; tof < grid.tofs; tof++) {
+        const TIME_T tof_time = grid.min_tof + grid.tof_step * TIME_T::rep(tof);
+        _problems.push_back(LambertSolver::Problem{ departure_states.back().first.vec(), arrivalState(departure_time + tof_time).first.vec(),
+                                                    double(tof_time.count()), mu, true });
+      }
+    }
+
+    // 2. Lambert's problems, solved in parallel
+    _solver.solve(_problems, grid.max_revolutions, _solutions);
+
+    // 3. Best transfer of every cell
+    for (size_t dep = first; dep < last; dep++) {
+      const auto& departure_state = departure_states[dep - first];
+      for (size_t tof = 0; tof < grid.tofs; tof++) {
+        const size_t problem = (dep - first) * grid.tofs + tof;
+        Cell& cell = cells[dep * grid.tofs + tof];
+        cell.departure = grid.first_departure + grid.departure_step * TIME_T::rep(dep);
+        cell.tof = grid.min_tof + grid.tof_step * TIME_T::rep(tof);
+        cell.c3 = std::numeric_limits<double>::quiet_NaN();
+        cell.arrival_v_inf = std::numeric_limits<double>::quiet_NaN();
+        cell.delta_v = std::numeric_limits<double>::infinity();
+        cell.revolutions = 0;
+
+        const auto& arrival_state = arrivalState(cell.departure + cell.tof);
+        for (size_t index = problem * per_problem; index < (problem + 1) * per_problem; index++) {
+          const LambertSolver::Solution& solution = _solutions[index];
+          if (!solution.valid)
+            continue;
+          const SPEED_T departure_v_inf = (solution.v1 - departure_state.second).norm();
+          const SPEED_T arrival_v_inf = (solution.v2 - arrival_state.second).norm();
+          if (departure_v_inf + arrival_v_inf < cell.delta_v) {
+            cell.c3 = departure_v_inf * departure_v_inf;
+            cell.arrival_v_inf = arrival_v_inf;
+            cell.delta_v = departure_v_inf + arrival_v_inf;
+            cell.revolutions = solution.revolutions;
+          }
+        }
+        if (std::isinf(cell.delta_v))
+          cell.delta_v = std::numeric_limits<double>::quiet_NaN();
+      }
+    }
+  }
+}
+
+
+/*   void writeCsv(std::ostream& out, const std::vector<Cell>& cells, char separator)   */
+/****************************************************************************************/
+void Porkchop::writeCsv(std::ostream& out, const std::vector<Cell>& cells, char separator) {
+  out << "DEPARTURE" << separator << "TOF" << separator << "C3" << separator << "ARRIVAL_V_INF" << separator << "DELTA_V" << separator << "REVOLUTIONS" << "\n";
+  for (const Cell& cell : cells) {
+    out << cell.departure.count() << separator << cell.tof.count() << separator << cell.c3 << separator << cell.arrival_v_inf << separator
+        << cell.delta_v << separator << cell.revolutions << "\n";
+  }
+  out.flush();
+}
+
+
+/*   void writeBinary(std::ostream& out, const std::vector<Cell>& cells)   */
+/***************************************************************************/
+void Porkchop::writeBinary(std::ostream& out, const std::vector<Cell>& cells) {
+  const uint64_t num_cells = cells.size();
+  out.write(reinterpret_cast<const char*>(&num_cells), sizeof(num_cells));
+  for (const Cell& cell : cells) {
+    const double record[6]{ double(cell.departure.count()), double(cell.tof.count()), cell.c3, cell.arrival_v_inf, cell.delta_v, double(cell.revolutions) };
+    out.write(reinterpret_cast<const char*>(record), sizeof(record));
+  }
+  out.flush();
+}
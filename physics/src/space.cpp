@@ -4,14 +4,20 @@
 #include <iomanip>
 #include <ctime>
 #include <sstream>
+#include <fstream>
+#include <algorithm>
 
 #include <logger.h>
 #include <sqlitedb/sqlitedb.h>
 
 #include <physics/k_body.h>
+#include <physics/state_file.h>
+
+#include <files/csv_file_reader.h>
 
 
 using namespace physics;
+using namespace std::chrono;
 using namespace physics::units;
 using namespace sqlitedb;
 
@@ -69,13 +75,159 @@ Observer& Space::activeObs(size_t obs_id) {
 
 
 void Space::runTick() {
-  _elapsed_time += _tick;
+  runTicks(1);
+}
+
+
+void Space::runTicks(uint64_t ticks) {
+  _elapsed_time += _tick * TIME_T::rep(ticks);
+  _ticks += ticks;
 
   ////////// Move the observer
   ////////_observers[_active_obs]->move();
-  ////////
-  ////////// Let the bodies interact
-  ////////KBody::gravInteraction(_bodies, _tick);  
+
+  // Let the bodies interact (the coalesced ticks are propagated as a single step)
+  if (ticks == 1)
+    _context->gravInteraction(_bodies, _tick);
+  else
+    _context->jumpTo(_bodies, _elapsed_time);
+
+  // The collisions are detected on the ticks when all the bodies have been moved (see multi-rate stepping in KBody), so the detection does not 
+  //    calculate the states of the lagging bodies
+  if (_collision_interval.count() > 0 && _elapsed_time - _collision_time >= _collision_interval && _context->synchronized())
+    detectCollisions();
+
+  if (!_event_definitions.empty() && _elapsed_time - _event_time >= _event_interval)
+    detectEvents();
+
+  if (_elapsed_time - _checkpoints->back().bodies.time >= _checkpoint_interval)
+    checkpoint();
+}
+
+
+void Space::jumpTo(const std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds>& date_time) {
+  _elapsed_time = date_time - _init_date_time;
+
+  _context->jumpTo(_bodies, _elapsed_time);
+
+  // The previous checkpoints and impacts do not belong to the new history
+  _checkpoints->clear();
+  checkpoint();
+  _impacts.clear();
+  resetCollisions();
+  resetEvents();
+}
+
+
+bool Space::rewindTo(const std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds>& date_time) {
+  const TIME_T time{ date_time - _init_date_time };
+  if (time > _elapsed_time)
+    return false;
+
+  // Latest checkpoint before the time
+  size_t index = _checkpoints->size();
+  while (index > 0 && (*_checkpoints)[index - 1].bodies.time > time)
+    index--;
+  if (index == 0)
+    return false;
+
+  const Checkpoint& restored = (*_checkpoints)[index - 1];
+  _context->restore(_bodies, restored.bodies);
+  _elapsed_time = restored.bodies.time;
+  _ticks = restored.ticks;
+  _checkpoints->truncate(index);
+
+  // The later impacts will be detected again
+  while (!_impacts.empty() && _impacts.back().time > _elapsed_time)
+    _impacts.pop_back();
+  resetCollisions();
+  resetEvents();
+
+  // Run the whole ticks again up to the time
+  while (_elapsed_time + _tick <= time)
+    runTick();
+
+  return true;
+}
+
+
+void Space::synchronize() {
+  _context->synchronize(_bodies);
+}
+
+
+void Space::saveState(const std::string& file_name) {
+  StateFile::write(file_name, _bodies, *_context, duration_cast<seconds>(_init_date_time.time_since_epoch()).count(), _elapsed_time, _tick, _ticks);
+}
+
+
+size_t Space::addEvent(EventDetector::Type type, const KBody& body, const KBody* other, const KBody* reference, LENGTH_T distance) {
+  switch (type) {
+  case EventDetector::APSIS:
+    if (!reference && !body.hasParent())
+      throw std::invalid_argument("Space: the event APSIS of " + body.name() + " needs a reference body");
+    if (!reference)
+      reference = &body.parent();
+    other = nullptr;
+    break;
+  case EventDetector::SOI:
+    if (!other && !body.hasParent())
+      throw std::invalid_argument("Space: the event SOI of " + body.name() + " needs another body");
+    if (!other)
+      other = &body.parent();
+    if (!other->hasParent())
+      throw std::invalid_argument("Space: " + other->name() + " does not have a SOI");
+    distance = other->soiRadius();
+    reference = nullptr;
+    break;
+  case EventDetector::DISTANCE:
+    reference = nullptr;
+    break;
+  case EventDetector::CONJUNCTION:
+  case EventDetector::ECLIPSE:
+    if (!reference)
+      reference = &_bodies.root();
+    break;
+  }
+  if (type != EventDetector::APSIS && !other)
+    throw std::invalid_argument("Space: the event " + EventDetector::TYPE_NAME[type] + " of " + body.name() + " needs another body");
+
+  const size_t id = _event_definitions.size();
+  _event_definitions.push_back(EventDetector::Definition{ type, eventBody(body), other ? eventBody(*other) : 0, reference ? eventBody(*reference) : 0, distance });
+  _event_functions.push_back(Event{ id, type, false, &body, other, reference, 0 });
+
+  // The new bodies must be in the states of the current interval
+  resetEvents();
+
+  return id;
+}
+
+
+ParticleCloud& Space::addParticleCloud(const KBody& parent) {
+  _particle_clouds.push_back(std::make_unique<ParticleCloud>(parent));
+  return *_particle_clouds.back();
+}
+
+
+bool Space::pollEvents(std::vector<Event>& events) {
+  events.clear();
+  std::lock_guard<std::mutex> lock(_events_mutex);
+  events.swap(_events);
+  return !events.empty();
+}
+
+
+std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds> Space::parseDateTime(const std::string& date_time) const {
+  std::istringstream iss_date_time{ date_time };
+  std::tm tm_datetime{};
+  std::string date_time_format = _datetime_format->first + " " + _datetime_format->second;
+  // Extract time
+  iss_date_time >> std::get_time(&tm_datetime, date_time_format.c_str());
+
+  if (iss_date_time.fail())
+    throw std::string("Invalid Date/Time '" + date_time + "'. Expected format: " + date_time_format);
+
+  return std::chrono::time_point_cast<std::chrono::seconds>(std::chrono::system_clock::from_time_t(mktime(&tm_datetime)));
 }
 
 
@@ -84,6 +236,58 @@ void Space::tick(const TIME_T &new_tick) {
 }
 
 
+void Space::start() {
+  if (_sim_thread.joinable())
+    return;
+
+  // Bodies in the snapshots: all the bodies in the tree (it is not changed while the simulation is running)
+  _snapshot_bodies.clear();
+  _snapshot_index.clear();
+  auto iter = _bodies.begin();
+  while (iter.hasNext()) {
+    const KBody* body = &iter.next();
+    _snapshot_index[body] = _snapshot_bodies.size();
+    _snapshot_bodies.push_back(body);
+  }
+
+  // First snapshot, so the readers have a valid state from the beginning
+  publish();
+
+  _stop_sim = false;
+  _sim_thread = std::thread(&Space::simulate, this);
+}
+
+
+void Space::stop() {
+  {
+    std::lock_guard<std::mutex> lock(_commands_mutex);
+    _stop_sim = true;
+  }
+  _commands_cv.notify_one();
+
+  if (_sim_thread.joinable())
+    _sim_thread.join();
+}
+
+
+void Space::post(const Command& command) {
+  {
+    std::lock_guard<std::mutex> lock(_commands_mutex);
+    _commands.push_back(command);
+  }
+  _commands_cv.notify_one();
+}
+
+
+const Space::Snapshot& Space::snapshot() {
+  if (_sim_failed)
+    std::rethrow_exception(_sim_exception);
+
+  _snapshots.update();
+  return _snapshots.readBuffer();
+}
+
+
 /// ************************************************* PUBLIC (END) ********************************************************
 /// ***********************************************************************************************************************
 
@@ -99,20 +303,25 @@ Space::Space() {
 
 	// Initialize variables
   _datetime_format = std::make_unique<std::pair<std::string, std::string>>(properties.property("DATE_FORMAT"), properties.property("TIME_FORMAT"));
-  std::istringstream iss_init_date_time { properties.property("INIT_DATE_TIME") };
-  std::tm tm_datetime;
-  std::string date_time_format = _datetime_format->first + " " + _datetime_format->second;
-  // Extract time
-  iss_init_date_time >> std::get_time(&tm_datetime, date_time_format.c_str());
-
-  if (iss_init_date_time.fail())
-    throw std::string("Invalid Initial Date/Time. Expected format: " + _datetime_format->first + " " + _datetime_format->second);
-
-  _init_date_time = std::chrono::time_point_cast<std::chrono::seconds>(std::chrono::system_clock::from_time_t(mktime(&tm_datetime)));
+  _init_date_time = parseDateTime(properties.property("INIT_DATE_TIME"));
   DebugLog( "Initial Time: " + std::to_string(std::chrono::system_clock::to_time_t(_init_date_time)) );
 
   _tick = static_cast<TIME_T>(properties.property<int32_t>("TICK"));
 
+  _snapshot_interval = milliseconds(properties.property<int32_t>("SNAPSHOT_INTERVAL"));
+
+  _real_time_factor = properties.property<double>("REAL_TIME_FACTOR");
+  _max_coalesced_ticks = std::max(properties.property<uint64_t>("MAX_COALESCED_TICKS"), uint64_t(1));
+
+  _log_interval = static_cast<TIME_T>(properties.property<int64_t>("LOG_INTERVAL"));
+
+  _checkpoint_interval = static_cast<TIME_T>(properties.property<int64_t>("CHECKPOINT_INTERVAL"));
+  _checkpoints = std::make_unique<utils::RingBuffer<Checkpoint>>(properties.property<size_t>("CHECKPOINTS"));
+
+  _collision_interval = static_cast<TIME_T>(properties.property<int64_t>("COLLISION_INTERVAL"));
+
+  _event_interval = static_cast<TIME_T>(properties.property<int64_t>("EVENT_INTERVAL"));
+
   _elapsed_time = static_cast<TIME_T>(0);
 
   ////////// Create Default Observer
@@ -124,15 +333,35 @@ Space::Space() {
   ////////_observers[_active_obs]->reposition(init_pos);
 
  
-  // Create bodies from DB
-  createBodies(properties);
+  // Create bodies from the state file, if it exists
+  auto state_file = properties.getProperties().find("STATE_FILE");
+  if (state_file != properties.getProperties().end() && std::ifstream(state_file->second).good()) {
+    loadState(state_file->second);
+  }
+  else {
+    // Create bodies from DB
+    createBodies(properties);
+
+    // Determine Barycenters for all the parent bodies and reset CS to the system barycenter, which is an inertial CS
+    _context->barycenters(_bodies);
+
+    // Initial checkpoint
+    checkpoint();
+  }
+
+  // Start of the first collision detection interval
+  resetCollisions();
+  _event_time = _elapsed_time;
 
-  ////////// Determine Barycenters for all the parent bodies and reset CS to the system barycenter, which is an inertial CS
-  ////////KBody::barycenters(_bodies);
+  // Particle clouds, attached to the bodies
+  auto particle_clouds = properties.getProperties().find("PARTICLE_CLOUDS");
+  if (particle_clouds != properties.getProperties().end())
+    createParticleClouds(particle_clouds->second);
 }
 
 Space::~Space() {
   DebugLog( "Space: DESTROYED" );
+  stop();
   while (_observers.size()) {
     delete _observers.back();
     _observers.pop_back();
@@ -145,9 +374,32 @@ Space::~Space() {
 
 /// ***********************************************************************************************************************
 /// ************************************************* PRIVATE *************************************************************
+void Space::loadState(const std::string& file_name) {
+  // Initialize Body parameters and the context of their movement
+  KBody::initialize();
+  _context = std::make_unique<KBody::Context>();
+
+  StateFile state_file(file_name);
+  if (state_file.header().init_date_time != duration_cast<seconds>(_init_date_time.time_since_epoch()).count())
+    throw std::string("The state file " + file_name + " was saved with another INIT_DATE_TIME");
+
+  // The loaded state is the first checkpoint
+  Checkpoint& loaded = _checkpoints->push();
+  state_file.load(_bodies, *_context, loaded.bodies);
+
+  _elapsed_time = TIME_T(state_file.header().elapsed_time);
+  _tick = TIME_T(state_file.header().tick);
+  _ticks = state_file.header().ticks;
+  loaded.ticks = _ticks;
+
+  InfoLog("Space loaded from " + file_name + ": " + std::to_string(_bodies.size()) + " bodies");
+}
+
+
 void Space::createBodies(const utils::PropertiesFileReader& properties) {
-  // Initialize Body parameters
+  // Initialize Body parameters and the context of their movement
   KBody::initialize();
+  _context = std::make_unique<KBody::Context>();
     
   // Check the DB type
   if (properties.property("DB.TYPE").size() == 0) {
@@ -246,8 +498,7 @@ void Space::createBodies(const utils::PropertiesFileReader& properties) {
         body_type = KBody::BodyType::MINOR_BODY;
       }
       else if (body_type_id == bod_types["SHIP"]) {
-//        body_type = KBody::BodyType::SHIP;
-        continue;
+        body_type = KBody::BodyType::SHIP;
       }
       else {
         std::stringstream txt;
@@ -482,5 +733,342 @@ void Space::createBodies(const utils::PropertiesFileReader& properties) {
 #endif
 }
 
+
+void Space::simulate() {
+  auto last_publish = steady_clock::now();
+  _pace_time = last_publish;
+  _pace_debt = 0;
+
+  try {
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(_commands_mutex);
+        // While paused, the thread sleeps until a new command is received. If the ticks are paced, it also sleeps until the next tick is owed
+        if (!_paused && _real_time_factor > 0 && _pace_debt < _tick.count()) {
+          auto next_tick = _pace_time + duration_cast<steady_clock::duration>(duration<double>((_tick.count() - _pace_debt) / _real_time_factor));
+          _commands_cv.wait_until(lock, next_tick, [this] { return _stop_sim || !_commands.empty(); });
+        }
+        else
+          _commands_cv.wait(lock, [this] { return _stop_sim || !_paused || !_commands.empty(); });
+        if (_stop_sim)
+          return;
+        _commands_exec.swap(_commands);
+      }
+
+      for (auto& command : _commands_exec)
+        execute(command);
+      bool changed = !_commands_exec.empty();
+      _commands_exec.clear();
+
+      if (!_paused) {
+        if (_real_time_factor > 0)
+          runPaced();
+        else
+          runTick();
+      }
+
+      // Publish the state when a command has changed it or when the interval has elapsed
+      auto now = steady_clock::now();
+      if (changed || now - last_publish >= _snapshot_interval) {
+        publish();
+        last_publish = now;
+      }
+    }
+  }
+  catch (...) {
+    ErrorLog("Space: Simulation thread stopped by an exception");
+    _sim_exception = std::current_exception();
+    _sim_failed = true;
+  }
+}
+
+
+void Space::runPaced() {
+  auto now = steady_clock::now();
+  _pace_debt += duration<double>(now - _pace_time).count() * _real_time_factor;
+  _pace_time = now;
+
+  // Too far behind the real time: the excess is dropped, so the simulation does not try to catch up forever
+  const double max_debt = std::max(double(_tick.count()) * _max_coalesced_ticks, _real_time_factor * MAX_PACE_LAG);
+  if (_pace_debt > max_debt) {
+    if (!_lagging) {
+      InfoLog("Space: The simulation cannot keep up with the real-time factor " + std::to_string(_real_time_factor) + " (tick " + std::to_string(_tick.count()) + " s)");
+    }
+    _lagging = true;
+    _pace_debt = max_debt;
+  }
+
+  const uint64_t owed = uint64_t(_pace_debt / _tick.count());
+  if (owed == 0)
+    return;
+
+  const uint64_t ticks = _context->canCoalesce() ? std::min(owed, _max_coalesced_ticks) : 1;
+  runTicks(ticks);
+  _pace_debt -= double(_tick.count()) * ticks;
+
+  if (_pace_debt < _tick.count())
+    _lagging = false;
+}
+
+
+void Space::execute(const Command& command) {
+  switch (command.type) {
+  case Command::PAUSE:
+    _paused = true;
+    break;
+  case Command::RESUME:
+    _paused = false;
+    // The paused time is not owed
+    _pace_time = steady_clock::now();
+    _pace_debt = 0;
+    break;
+  case Command::TICK:
+    tick(command.value);
+    break;
+  case Command::JUMP_TO:
+    jumpTo(_init_date_time + command.value);
+    break;
+  case Command::REWIND_TO:
+    if (!rewindTo(_init_date_time + command.value)) {
+      InfoLog("Space: Rewind to " + dateAndTime(command.value).first + " " + dateAndTime(command.value).second + " not possible (not covered by the checkpoints)");
+    }
+    else {
+      InfoLog("Space: Rewound to " + dateAndTime(_elapsed_time).first + " " + dateAndTime(_elapsed_time).second);
+    }
+    break;
+  }
+}
+
+
+void Space::publish() {
+  // The published state must be consistent for all the bodies
+  synchronize();
+
+  Snapshot& snapshot = _snapshots.writeBuffer();
+
+  snapshot.elapsed_time = _elapsed_time;
+  snapshot.tick = _tick;
+  snapshot.ticks = _ticks;
+  snapshot.paused = _paused;
+  snapshot.lagging = _lagging;
+  snapshot.index = &_snapshot_index;
+
+  // The vector keeps its capacity, so there are no allocations after the first snapshots
+  _context->states(_snapshot_bodies, _body_states);
+  snapshot.bodies.resize(_snapshot_bodies.size());
+  _snapshot_positions.resize(_snapshot_bodies.size());
+  for (size_t i = 0; i < _snapshot_bodies.size(); i++) {
+    const KBody* body = _snapshot_bodies[i];
+    snapshot.bodies[i] = BodyState{ body, body->hasParent() ? &body->parent() : nullptr, _body_states[i].first, _body_states[i].second, body->orbit().a() };
+    _snapshot_positions[i] = _body_states[i].first.vec();
+  }
+
+  // The index is built by the simulation thread, so the reader thread only executes the queries
+  snapshot.spatial_index.build(_snapshot_positions);
+
+  // The particles have no state: their positions are calculated for the time of the snapshot (the buffer keeps its capacity), with the pool of 
+  //      threads of the bodies, which are not being moved now
+  size_t num_particles{ 0 };
+  snapshot.clouds.resize(_particle_clouds.size());
+  for (size_t i = 0; i < _particle_clouds.size(); i++) {
+    const ParticleCloud& cloud = *_particle_clouds[i];
+    snapshot.clouds[i] = CloudState{ &cloud, cloud.parent().state().first, num_particles, cloud.size() };
+    num_particles += cloud.size();
+  }
+  snapshot.particles.resize(3 * num_particles);
+  for (const CloudState& cloud_state : snapshot.clouds) {
+    float* positions = snapshot.particles.data() + 3 * cloud_state.first;
+    _context->pool().parallelFor(0, cloud_state.count, PARTICLE_CHUNK, [this, &cloud_state, positions](size_t first, size_t last) {
+      cloud_state.cloud->positions(_elapsed_time, first, last, positions);
+    });
+  }
+
+  _snapshots.publish();
+}
+
+
+void Space::checkpoint() {
+  Checkpoint& newest = _checkpoints->push();
+  _context->checkpoint(_bodies, newest.bodies);
+  newest.ticks = _ticks;
+}
+
+
+void Space::createParticleClouds(const std::string& clouds) {
+  utils::Tokenizer tokenizer;
+  std::vector<std::string> definitions, fields;
+  tokenizer(definitions, clouds, ';');
+  size_t num_particles{ 0 };
+  for (size_t index = 0; index < definitions.size(); index++) {
+    tokenizer(fields, definitions[index], ',');
+    if (fields.size() != 6)
+      throw std::string("Invalid particle cloud '" + definitions[index] + "'. Expected: parent,count,min_a,max_a,max_e,max_i");
+
+    // The name of the parent can be surrounded by spaces
+    const size_t name_first = fields[0].find_first_not_of(' ');
+    const std::string parent_name = name_first == std::string::npos ? "" : fields[0].substr(name_first, fields[0].find_last_not_of(' ') - name_first + 1);
+    const KBody* parent{ nullptr };
+    try {
+      parent = &_bodies.find(parent_name);
+    }
+    catch (std::out_of_range&) {
+      throw std::string("Parent body " + parent_name + " of the particle cloud does not exist");
+    }
+
+    try {
+      // The seed is the index of the cloud, so the same clouds are generated in every execution
+      addParticleCloud(*parent).generate(std::stoull(fields[1]), std::stod(fields[2]), std::stod(fields[3]), std::stod(fields[4]), std::stod(fields[5]), 
+                                         uint32_t(index));
+    }
+    catch (std::exception& exc) {
+      throw std::string("Invalid particle cloud '" + definitions[index] + "': " + exc.what());
+    }
+    num_particles += _particle_clouds.back()->size();
+  }
+
+  InfoLog("Particle clouds: " + std::to_string(_particle_clouds.size()) + " clouds, " + std::to_string(num_particles) + " particles");
+}
+
+
+std::unordered_map<const KBody*, std::vector<const KBody*>> Space::Snapshot::children() const {
+  std::unordered_map<const KBody*, std::vector<const KBody*>> children;
+  for (const BodyState& state : bodies) {
+    if (state.parent)
+      children[state.parent].push_back(state.body);
+  }
+  for (auto& family : children)
+    std::sort(family.second.begin(), family.second.end(), [](const KBody* body_1, const KBody* body_2) { return *body_1 < *body_2; });
+
+  return children;
+}
+
+
+void Space::resetCollisions() {
+  if (_collision_interval.count() <= 0)
+    return;
+
+  synchronize();
+
+  // Bodies in the detection: all the bodies in the tree (it is not changed after the bodies are created)
+  _collision_bodies.clear();
+  _collision_radii.clear();
+  _collision_positions[0].clear();
+  _collision_velocities[0].clear();
+  auto iter = _bodies.begin();
+  while (iter.hasNext()) {
+    const KBody& body = iter.next();
+    _collision_bodies.push_back(&body);
+    _collision_radii.push_back(body.radius);
+  }
+  _context->states(_collision_bodies, _body_states);
+  for (const auto& state : _body_states) {
+    _collision_positions[0].push_back(state.first.vec());
+    _collision_velocities[0].push_back(state.second);
+  }
+  _collision_time = _elapsed_time;
+}
+
+
+void Space::detectCollisions() {
+  synchronize();
+
+  _collision_positions[1].clear();
+  _collision_velocities[1].clear();
+  _context->states(_collision_bodies, _body_states);
+  for (const auto& state : _body_states) {
+    _collision_positions[1].push_back(state.first.vec());
+    _collision_velocities[1].push_back(state.second);
+  }
+
+  // The fast bodies (orbital period of a few intervals) are followed in segments, calculated back from the orbits at the end of the interval
+  _collision_max_segments.resize(_collision_bodies.size());
+  for (size_t index = 0; index < _collision_bodies.size(); index++) {
+    const KBody* body = _collision_bodies[index];
+    _collision_max_segments[index] = (body->hasParent() && body->orbit().bound()) ? double(body->orbit().period().count()) / COLLISION_SEGMENTS_PER_ORBIT : 0.0;
+  }
+  auto sampler = [this](size_t body, double time, geometry::Vec3<LENGTH_T>& position, geometry::Vec3<SPEED_T>& velocity) {
+    auto state = _collision_bodies[body]->stateAt(double(_collision_time.count()) + time);
+    position = state.first.vec();
+    velocity = state.second;
+  };
+
+  _collision_impacts.clear();
+  _collision_detector.detect(_collision_positions[0], _collision_velocities[0], _collision_positions[1], _collision_velocities[1], _collision_radii,
+                             _collision_max_segments, sampler, double((_elapsed_time - _collision_time).count()), _collision_impacts);
+
+  for (auto& impact : _collision_impacts) {
+    _impacts.push_back(Impact{ _collision_bodies[impact.body_1], _collision_bodies[impact.body_2], 
+                               _collision_time + TIME_T(TIME_T::rep(impact.time)), impact.distance });
+    auto date_time = dateAndTime(_impacts.back().time);
+    InfoLog("IMPACT: " + _impacts.back().body_1->name() + " - " + _impacts.back().body_2->name() + " on " + date_time.first + " " + date_time.second);
+  }
+
+  // The end of this interval is the start of the next one
+  std::swap(_collision_positions[0], _collision_positions[1]);
+  std::swap(_collision_velocities[0], _collision_velocities[1]);
+  _collision_time = _elapsed_time;
+}
+
+
+size_t Space::eventBody(const KBody& body) {
+  auto index = std::find(_event_bodies.begin(), _event_bodies.end(), &body);
+  if (index != _event_bodies.end())
+    return size_t(index - _event_bodies.begin());
+
+  _event_bodies.push_back(&body);
+  _event_radii.push_back(body.radius);
+  return _event_bodies.size() - 1;
+}
+
+
+void Space::resetEvents() {
+  _event_time = _elapsed_time;
+  if (_event_definitions.empty())
+    return;
+
+  // Only the bodies of the events (and their parents) are calculated at the current time, the bodies are not synchronized (see KBody::state())
+  _event_positions[0].clear();
+  _event_velocities[0].clear();
+  for (const KBody* body : _event_bodies) {
+    auto state = body->state();
+    _event_positions[0].push_back(state.first.vec());
+    _event_velocities[0].push_back(state.second);
+  }
+}
+
+
+void Space::detectEvents() {
+  _event_positions[1].clear();
+  _event_velocities[1].clear();
+  for (const KBody* body : _event_bodies) {
+    auto state = body->state();
+    _event_positions[1].push_back(state.first.vec());
+    _event_velocities[1].push_back(state.second);
+  }
+
+  _detected_events.clear();
+  _event_detector.detect(_event_definitions, _event_positions[0], _event_velocities[0], _event_positions[1], _event_velocities[1], _event_radii,
+                         double((_elapsed_time - _event_time).count()), _detected_events);
+
+  if (!_detected_events.empty()) {
+    std::lock_guard<std::mutex> lock(_events_mutex);
+    for (auto& detected : _detected_events) {
+      Event event = _event_functions[detected.definition];
+      event.rising = detected.rising;
+      event.time = double(_event_time.count()) + detected.time;
+      _events.push_back(event);
+
+      auto date_time = dateAndTime(TIME_T(TIME_T::rep(event.time)));
+      InfoLog("EVENT: " + EventDetector::eventName(event.type, event.rising) + " " + event.body->name() + (event.other ? " - " + event.other->name() : "") + 
+              " on " + date_time.first + " " + date_time.second);
+    }
+  }
+
+  // The end of this interval is the start of the next one
+  std::swap(_event_positions[0], _event_positions[1]);
+  std::swap(_event_velocities[0], _event_velocities[1]);
+  _event_time = _elapsed_time;
+}
+
 /// ************************************************* PRIVATE (END) *******************************************************
 /// ***********************************************************************************************************************
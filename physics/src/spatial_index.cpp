@@ -0,0 +1,147 @@
+#include <physics/spatial_index.h>
+
+#include <numeric>
+#include <algorithm>
+
+using namespace physics;
+using namespace physics::units;
+using namespace geometry;
+
+
+/*   void build(const std::vector<Vec3<LENGTH_T>>& positions)   */
+/****************************************************************/
+void SpatialIndex::build(const std::vector<Vec3<LENGTH_T>>& positions) {
+  _indexes.resize(positions.size());
+  std::iota(_indexes.begin(), _indexes.end(), size_t(0));
+  _axes.assign(positions.size(), 0);
+
+  // The indexes are sorted first, and then the points are copied in the order of the tree
+  _points = positions;
+  split(0, positions.size());
+  for (size_t position = 0; position < positions.size(); position++)
+    _points[position] = positions[_indexes[position]];
+}
+
+
+/*   void range(const Vec3<LENGTH_T>& center, LENGTH_T radius, std::vector<size_t>& result) const   */
+/**************************************************************************************************/
+void SpatialIndex::range(const Vec3<LENGTH_T>& center, LENGTH_T radius, std::vector<size_t>& result) const {
+  result.clear();
+  if (radius >= 0)
+    range(0, _points.size(), center, radius * radius, result);
+}
+
+
+/*   void nearest(const Vec3<LENGTH_T>& center, size_t k, std::vector<size_t>& result) const   */
+/*********************************************************************************************/
+void SpatialIndex::nearest(const Vec3<LENGTH_T>& center, size_t k, std::vector<size_t>& result) const {
+  result.clear();
+  k = std::min(k, _points.size());
+  if (k == 0)
+    return;
+
+  std::vector<std::pair<double, size_t>> heap;
+  heap.reserve(k);
+  nearest(0, _points.size(), center, k, heap);
+
+  std::sort_heap(heap.begin(), heap.end());
+  for (auto& entry : heap)
+    result.push_back(_indexes[entry.second]);
+}
+
+
+/*   void split(size_t first, size_t last)   */
+/*********************************************/
+void SpatialIndex::split(size_t first, size_t last) {
+  if (last - first <= _leaf_size)
+    return;
+
+  // Axis of the largest extent (the points are still in the original order: they are accessed through the indexes)
+  Vec3<LENGTH_T> min_corner = _points[_indexes[first]];
+  Vec3<LENGTH_T> max_corner = min_corner;
+  for (size_t position = first + 1; position < last; position++) {
+    min_corner = min_corner.cwiseMin(_points[_indexes[position]]);
+    max_corner = max_corner.cwiseMax(_points[_indexes[position]]);
+  }
+  Vec3<LENGTH_T>::Index axis;
+  (max_corner - min_corner).maxCoeff(&axis);
+
+  const size_t middle = first + (last - first) / 2;
+  std::nth_element(_indexes.begin() + first, _indexes.begin() + middle, _indexes.begin() + last,
+                   [this, axis](size_t index_1, size_t index_2) { return _points[index_1][axis] < _points[index_2][axis]; });
+  _axes[middle] = uint8_t(axis);
+
+  split(first, middle);
+  split(middle + 1, last);
+}
+
+
+/*   void range(size_t first, size_t last, ...) const   */
+/*******************************************************/
+void SpatialIndex::range(size_t first, size_t last, const Vec3<LENGTH_T>& center, double squared_radius, std::vector<size_t>& result) const {
+  if (last - first <= _leaf_size) {
+    for (size_t position = first; position < last; position++) {
+      if ((_points[position] - center).squaredNorm() <= squared_radius)
+        result.push_back(_indexes[position]);
+    }
+    return;
+  }
+
+  const size_t middle = first + (last - first) / 2;
+  const double offset = center[_axes[middle]] - _points[middle][_axes[middle]];
+  if ((_points[middle] - center).squaredNorm() <= squared_radius)
+    result.push_back(_indexes[middle]);
+
+  // The near side first; the far side only if the sphere crosses the split plane
+  if (offset < 0) {
+    range(first, middle, center, squared_radius, result);
+    if (offset * offset <= squared_radius)
+      range(middle + 1, last, center, squared_radius, result);
+  }
+  else {
+    range(middle + 1, last, center, squared_radius, result);
+    if (offset * offset <= squared_radius)
+      range(first, middle, center, squared_radius, result);
+  }
+}
+
+
+/*   void nearest(size_t first, size_t last, ...) const   */
+/*********************************************************/
+void SpatialIndex::nearest(size_t first, size_t last, const Vec3<LENGTH_T>& center, size_t k, std::vector<std::pair<double, size_t>>& heap) const {
+  // Adds a point if the heap is not full or it is nearer than the farthest point in the heap
+  auto check = [&](size_t position) {
+    const double squared_distance = (_points[position] - center).squaredNorm();
+    if (heap.size() < k) {
+      heap.emplace_back(squared_distance, position);
+      std::push_heap(heap.begin(), heap.end());
+    }
+    else if (squared_distance < heap.front().first) {
+      std::pop_heap(heap.begin(), heap.end());
+      heap.back() = { squared_distance, position };
+      std::push_heap(heap.begin(), heap.end());
+    }
+  };
+
+  if (last - first <= _leaf_size) {
+    for (size_t position = first; position < last; position++)
+      check(position);
+    return;
+  }
+
+  const size_t middle = first + (last - first) / 2;
+  const double offset = center[_axes[middle]] - _points[middle][_axes[middle]];
+  check(middle);
+
+  // The near side first; the far side only if it can contain a nearer point than the farthest one found
+  if (offset < 0) {
+    nearest(first, middle, center, k, heap);
+    if (heap.size() < k || offset * offset < heap.front().first)
+      nearest(middle + 1, last, center, k, heap);
+  }
+  else {
+    nearest(middle + 1, last, center, k, heap);
+    if (heap.size() < k || offset * offset < heap.front().first)
+      nearest(first, middle, center, k, heap);
+  }
+}
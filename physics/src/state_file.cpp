@@ -0,0 +1,195 @@
+#include <physics/state_file.h>
+
+#include <fstream>
+#include <vector>
+#include <unordered_map>
+#include <numeric>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace physics;
+using namespace physics::units;
+using namespace geometry;
+
+
+/*   void write(...)   */
+/**********************/
+void StateFile::write(const std::string& file_name, tree::MTree<KBody>& bodies, KBody::Context& context, int64_t init_date_time, TIME_T elapsed_time, TIME_T tick, uint64_t ticks) {
+  KBody::Checkpoint checkpoint;
+  context.checkpoint(bodies, checkpoint);
+
+  // Index of every body, to reference the parents
+  std::unordered_map<const KBody*, int64_t> index;
+  index.reserve(bodies.size());
+  auto iter = bodies.begin();
+  while (iter.hasNext()) {
+    const KBody* body = &iter.next();
+    index.emplace(body, int64_t(index.size()));
+  }
+
+  std::vector<BodyRecord> records(bodies.size());
+  std::string names;
+  iter.rewind();
+  for (size_t i = 0; i < records.size(); i++) {
+    const KBody& body = iter.next();
+    const auto& entry = checkpoint.bodies[i];
+    const auto setup = body.setup();
+    BodyRecord& record = records[i];
+    std::memset(&record, 0, sizeof(BodyRecord));
+
+    record.name_offset = names.size();
+    record.common_name_size = uint32_t(body.COMMON_NAME.size());
+    record.provisional_name_size = uint32_t(body.PROVISIONAL_NAME.size());
+    names += body.COMMON_NAME;
+    names += body.PROVISIONAL_NAME;
+
+    record.parent = body.hasParent() ? index.at(&body.parent()) : -1;
+    record.id = body.ID;
+    record.type = body.TYPE;
+    record.parent_perturbator = setup.parent_perturbator;
+    record.reduced_mass = body.reduced_mass;
+    record.radius = body.radius;
+    for (uint8_t coord = 0; coord < 3; coord++) {
+      record.position[coord] = entry.position[coord];
+      record.velocity[coord] = entry.velocity[coord];
+      record.barycenter_pos[coord] = setup.barycenter_pos[coord];
+      record.barycenter_vel[coord] = setup.barycenter_vel[coord];
+      record.orbit_position[coord] = entry.orbit.position[coord];
+      record.orbit_velocity[coord] = entry.orbit.velocity[coord];
+    }
+
+    record.a = entry.orbit.a;
+    record.e = entry.orbit.e;
+    record.i = entry.orbit.i;
+    record.asc_node = entry.orbit.asc_node;
+    record.periapsis = entry.orbit.periapsis;
+    record.anomaly = entry.orbit.anomaly;
+    record.ecc_anomaly = entry.orbit.ecc_anomaly;
+    record.mean_anomaly = entry.orbit.mean_anomaly;
+    record.mean_anomaly_epoch = entry.orbit.mean_anomaly_epoch;
+    record.epoch = entry.orbit.epoch.count();
+    record.time = entry.orbit.time.count();
+    record.time_periapsis = entry.orbit.time_periapsis.count();
+  }
+
+  Header header;
+  std::memset(&header, 0, sizeof(Header));
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.record_size = sizeof(BodyRecord);
+  header.init_date_time = init_date_time;
+  header.elapsed_time = elapsed_time.count();
+  header.tick = tick.count();
+  header.ticks = ticks;
+  header.step_ticks = checkpoint.ticks;
+  header.integrator = context.integrator();
+  header.num_bodies = records.size();
+  header.bodies_offset = sizeof(Header);
+  header.names_offset = header.bodies_offset + records.size() * sizeof(BodyRecord);
+  header.names_size = names.size();
+
+  std::ofstream file(file_name, std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file)
+    throw std::runtime_error("File cannot be opened: " + file_name);
+
+  file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+  file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(BodyRecord));
+  file.write(names.data(), names.size());
+  if (!file)
+    throw std::runtime_error("File cannot be written: " + file_name);
+}
+
+
+/*   CONSTRUCTOR   */
+/*******************/
+StateFile::StateFile(const std::string& file_name) : _file{ file_name } {
+  if (_file.size() < sizeof(Header) || std::memcmp(header().magic, MAGIC, sizeof(MAGIC)) != 0)
+    throw std::runtime_error("Not a state file: " + file_name);
+
+  if (header().version != VERSION || header().record_size != sizeof(BodyRecord))
+    throw std::runtime_error("State file version not supported: " + file_name);
+
+  // The sections must be inside the file (the records must be aligned, so they can be read in place)
+  const Header& hdr = header();
+  if (hdr.bodies_offset % alignof(BodyRecord) != 0 || hdr.bodies_offset > _file.size() ||
+      hdr.num_bodies > (_file.size() - hdr.bodies_offset) / sizeof(BodyRecord) ||
+      hdr.names_offset < hdr.bodies_offset + hdr.num_bodies * sizeof(BodyRecord) ||
+      hdr.names_offset > _file.size() || hdr.names_size > _file.size() - hdr.names_offset)
+    throw std::runtime_error("Corrupted state file: " + file_name);
+
+  for (size_t index = 0; index < size(); index++) {
+    const BodyRecord& record = body(index);
+    if (record.name_offset > hdr.names_size || uint64_t(record.common_name_size) + record.provisional_name_size > hdr.names_size - record.name_offset)
+      throw std::runtime_error("Corrupted state file: " + file_name);
+  }
+}
+
+
+/*   void load(tree::MTree<KBody>& bodies, KBody::Context& context, KBody::Checkpoint& checkpoint) const   */
+/*********************************************************************************************************/
+void StateFile::load(tree::MTree<KBody>& bodies, KBody::Context& context, KBody::Checkpoint& checkpoint) const {
+  if (header().integrator != context.integrator())
+    throw std::runtime_error("The state file was saved with another integrator");
+
+  if (bodies.size())
+    throw std::runtime_error("The bodies of a state file can only be loaded in an empty tree");
+
+  const size_t num_bodies = size();
+  if (num_bodies == 0)
+    throw std::runtime_error("The state file does not contain any body");
+
+  std::vector<int64_t> parents(num_bodies);
+  for (size_t index = 0; index < num_bodies; index++) {
+    if (body(index).type >= KBody::TYPE_NAME.size())
+      throw std::runtime_error("Invalid body type in the state file");
+    if (body(index).parent < -1)
+      throw std::runtime_error("Invalid hierarchy of bodies in the state file");
+    parents[index] = body(index).parent;
+  }
+
+  // The tree is built at once from the stored parent indices: each body is created under its parent, which is already in the tree
+  std::vector<KBody*> created;
+  try {
+    created = bodies.adoptNodes(parents, [this](size_t index, KBody* parent) {
+      const BodyRecord& record = body(index);
+      PBody::PositionType position{ record.position[0], record.position[1], record.position[2] };
+      PBody::VelocityType velocity{ record.velocity[0], record.velocity[1], record.velocity[2] };
+      if (!parent)
+        return new KBody(std::string(commonName(index)), record.reduced_mass, record.radius, position, velocity);
+      return new KBody(std::string(commonName(index)), record.reduced_mass, record.radius, position, velocity, *parent, 
+                       KBody::BodyType(record.type), record.id, std::string(provisionalName(index)));
+    });
+  }
+  catch (std::invalid_argument& exc) {
+    throw std::runtime_error(std::string("Invalid hierarchy of bodies in the state file: ") + exc.what());
+  }
+
+  // The records are in the iteration order of the tree, so the setups and the checkpoint are filled in the same order
+  std::vector<KBody::Setup> setups;
+  setups.reserve(num_bodies);
+  checkpoint.time = TIME_T(header().elapsed_time);
+  checkpoint.ticks = header().step_ticks;
+  checkpoint.bodies.clear();
+  auto iter = bodies.begin();
+  for (size_t index = 0; index < num_bodies; index++) {
+    if (&iter.next() != created[index])
+      throw std::runtime_error("The bodies of the state file are not sorted by name");
+
+    const BodyRecord& record = body(index);
+    setups.push_back(KBody::Setup{ record.parent_perturbator != 0, 
+                                   PBody::PositionType{ record.barycenter_pos[0], record.barycenter_pos[1], record.barycenter_pos[2] }, 
+                                   PBody::VelocityType{ record.barycenter_vel[0], record.barycenter_vel[1], record.barycenter_vel[2] } });
+
+    KeplerOrbit::Checkpoint orbit{ record.a, record.e, record.i, record.asc_node, record.periapsis, 
+                                   record.anomaly, record.ecc_anomaly, record.mean_anomaly, record.mean_anomaly_epoch, 
+                                   TIME_T(record.epoch), TIME_T(record.time), TIME_T(record.time_periapsis),
+                                   PBody::PositionType{ record.orbit_position[0], record.orbit_position[1], record.orbit_position[2] }, 
+                                   PBody::VelocityType{ record.orbit_velocity[0], record.orbit_velocity[1], record.orbit_velocity[2] } };
+    checkpoint.bodies.push_back(KBody::Checkpoint::Entry{ PBody::PositionType{ record.position[0], record.position[1], record.position[2] }, 
+                                                          PBody::VelocityType{ record.velocity[0], record.velocity[1], record.velocity[2] }, orbit,
+                                                          record.parent < 0 ? nullptr : created[size_t(record.parent)] });
+  }
+
+  context.adopt(bodies, setups, checkpoint);
+}
@@ -0,0 +1,73 @@
+#include <physics/collision_detector.h>
+#include <physics/kepler_orbit.h>
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+using namespace physics;
+using namespace std;
+
+int cd__main(int argc, char** args) {
+  // Interval of the collision detection with space_headless.cfg: it waits for the synchronization of the bodies, every MAX_STEP_TICKS (64) 
+  //    ticks of 3600 s
+  const double interval = 64 * 3600.0;
+
+  // Mars (fixed), Phobos (period of 7.65 hours) and an impactor crossing the orbit of Phobos at the time when Phobos passes through the crossing point
+  const units::REDUCED_MASS_T mu = 4.282837e13;
+  const double r = 9.376e6;
+  KeplerOrbit phobos;
+  phobos.conic(mu, geometry::Vec3<units::LENGTH_T>{ r, 0.0, 0.0 }, geometry::Vec3<units::SPEED_T>{ 0.0, sqrt(mu / r), 0.0 }, units::TIME_T(0));
+  cout << "Phobos period: " << phobos.period().count() << " s. Interval: " << interval << " s" << endl;
+
+  const double impact_time = 100000.0;
+  const geometry::Vec3<units::LENGTH_T> crossing = phobos.stateAt(impact_time).first.vec();
+  const geometry::Vec3<units::SPEED_T> impactor_velocity{ 0.0, 0.0, 5000.0 };
+
+  auto sampler = [&](size_t body, double time, geometry::Vec3<units::LENGTH_T>& position, geometry::Vec3<units::SPEED_T>& velocity) {
+    if (body == 0) {
+      position = geometry::Vec3<units::LENGTH_T>{ 0.0, 0.0, 0.0 };
+      velocity = geometry::Vec3<units::SPEED_T>{ 0.0, 0.0, 0.0 };
+    }
+    else if (body == 1) {
+      auto state = phobos.stateAt(time);
+      position = state.first.vec();
+      velocity = state.second;
+    }
+    else {
+      position = crossing + impactor_velocity * (time - impact_time);
+      velocity = impactor_velocity;
+    }
+  };
+
+  vector<geometry::Vec3<units::LENGTH_T>> positions_0(3), positions_1(3);
+  vector<geometry::Vec3<units::SPEED_T>> velocities_0(3), velocities_1(3);
+  for (size_t body = 0; body < 3; body++) {
+    sampler(body, 0.0, positions_0[body], velocities_0[body]);
+    sampler(body, interval, positions_1[body], velocities_1[body]);
+  }
+  const vector<units::LENGTH_T> radii{ 3.3895e6, 11.1e3, 1e3 };
+
+  auto report = [](const vector<CollisionDetector::Impact>& impacts) {
+    cout << "Impacts: " << impacts.size() << endl;
+    for (auto& impact : impacts)
+      cout << "   " << impact.body_1 << " - " << impact.body_2 << " at " << impact.time << " s (distance " << impact.distance << " m)" << endl;
+  };
+
+  // 1. A single Hermite curve per body over the whole interval: the impact is missed
+  CollisionDetector detector;
+  vector<CollisionDetector::Impact> impacts;
+  detector.detect(positions_0, velocities_0, positions_1, velocities_1, radii, interval, impacts);
+  cout << "Single segment. ";
+  report(impacts);
+
+  // 2. Phobos in segments of 1/16 of its period (as in Space::detectCollisions()): the impact is found
+  const vector<double> max_segments{ 0.0, double(phobos.period().count()) / 16, 0.0 };
+  impacts.clear();
+  detector.detect(positions_0, velocities_0, positions_1, velocities_1, radii, max_segments, sampler, interval, impacts);
+  cout << "Segments. ";
+  report(impacts);
+  cout << "Expected: 1 - 2 at " << impact_time - (radii[1] + radii[2]) / impactor_velocity.norm() << " s" << endl;
+
+  return 0;
+}
@@ -0,0 +1,97 @@
+#include <physics/ephemeris_cache.h>
+#include <physics/kepler_orbit.h>
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <future>
+#include <cmath>
+
+using namespace physics;
+using namespace std;
+
+int ec__main(int argc, char** args) {
+  // Orbits around the Sun, from 0.4 to 5 AU, with eccentricities up to 0.3
+  const units::REDUCED_MASS_T mu = 1.32712440018e20;
+  const size_t num_bodies = argc > 1 ? size_t(atoi(args[1])) : 16;
+  vector<unique_ptr<KeplerOrbit>> orbits;
+  for (size_t body = 0; body < num_bodies; body++) {
+    const double a = 1.496e11 * (0.4 + 4.6 * body / num_bodies);
+    const double e = 0.3 * body / num_bodies;
+    const double r = a * (1 - e);
+    orbits.emplace_back(new KeplerOrbit());
+    orbits.back()->conic(mu, geometry::Vec3<units::LENGTH_T>{ r, 0.0, 0.0 }, geometry::Vec3<units::SPEED_T>{ 0.0, sqrt(mu * (1 + e) / r), 1000.0 }, units::TIME_T(0));
+  }
+  auto propagator = [&orbits](size_t body, double time) {
+    auto state = orbits[body]->stateAt(time);
+    return EphemerisCache::State{ state.first.vec(), state.second };
+  };
+
+  // Segments of 10 days, degree 12
+  EphemerisCache cache(num_bodies, propagator, units::TIME_T(10 * 86400), 12, 64 * 1024 * 1024, 2);
+  cout << "Bodies: " << num_bodies << endl;
+
+  // 1. Accuracy: random times over 1 year
+  mt19937_64 random(1);
+  uniform_real_distribution<double> time_dist(0.0, 365.0 * 86400);
+  vector<pair<size_t, double>> queries(100000);
+  for (auto& query : queries)
+    query = { size_t(random() % num_bodies), time_dist(random) };
+
+  double max_position_error{ 0 }, max_velocity_error{ 0 };
+  for (auto& query : queries) {
+    auto exact = propagator(query.first, query.second);
+    auto cached = cache.evaluate(query.first, query.second);
+    max_position_error = max(max_position_error, (cached.first - exact.first).norm());
+    max_velocity_error = max(max_velocity_error, (cached.second - exact.second).norm());
+  }
+  cout << "Max error: " << max_position_error << " m, " << max_velocity_error << " m/s" << endl;
+  cout << "Segments: " << cache.size() << " Memory: " << cache.memoryUsage() << " bytes" << endl;
+
+  // 2. Speed of the cached evaluations compared with the Kepler orbits
+  auto start = chrono::steady_clock::now();
+  double sum{ 0 };
+  for (auto& query : queries)
+    sum += propagator(query.first, query.second).first.x();
+  auto exact_time = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+  start = chrono::steady_clock::now();
+  for (auto& query : queries)
+    sum -= cache.evaluate(query.first, query.second).first.x();
+  auto cached_time = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+  cout << "Kepler orbits: " << exact_time << " us. Cache: " << cached_time << " us (" << sum << ")" << endl;
+
+  // 3. Prefetch of the second year, fitted by the worker threads
+  cache.clear();
+  vector<future<void>> prefetches;
+  for (size_t body = 0; body < num_bodies; body++)
+    prefetches.push_back(cache.prefetch(body, 365.0 * 86400, 730.0 * 86400));
+  for (auto& prefetch : prefetches)
+    prefetch.wait();
+  cout << "Prefetched segments: " << cache.size() << " (expected " << num_bodies * 38 << ")" << endl;
+
+  //    Segments being fitted when the cache is cleared are discarded
+  prefetches.clear();
+  for (size_t body = 0; body < num_bodies; body++)
+    prefetches.push_back(cache.prefetch(body, 730.0 * 86400, 1095.0 * 86400));
+  cache.clear();
+  for (auto& prefetch : prefetches)
+    prefetch.wait();
+  cout << "Segments after clearing during the prefetch: " << cache.size() << " (expected at most " << num_bodies * 38 << ")" << endl;
+
+  // 4. Eviction: a budget of 100 segments
+  EphemerisCache small_cache(num_bodies, propagator, units::TIME_T(10 * 86400), 12, 100 * (13 * 6 * sizeof(double) + 128), 0);
+  for (auto& query : queries)
+    small_cache.evaluate(query.first, query.second);
+  cout << "Small cache. Segments: " << small_cache.size() << " Memory: " << small_cache.memoryUsage() << " bytes" << endl;
+
+  try {
+    cache.evaluate(num_bodies, 0.0);
+  }
+  catch (out_of_range& exc) {
+    cout << "Exception caught: " << exc.what() << endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,467 @@
+/** \mainpage Space Simulator (Headless)
+ *  \section  Introduction
+ *            Batch execution of the space simulation, without window, GLFW or OpenGL.
+ *            The space is simulated from a start date to an end date, at a fixed tick, as fast as possible.
+ *            Every LOG_INTERVAL seconds of simulation time (see config/space.cfg) the state of all the bodies and the statistics
+ *            of the execution are written to disk.
+ *            Optionally, the bodies nearest to a body of interest are also written (using a spatial index instead of checking all the bodies).
+ *            Optionally, the minor bodies whose orbits come close to the orbit of a planet (MOID below a threshold) are written at the start, 
+ *            as candidates for a detailed close approach analysis.
+ *            Optionally, a porkchop plot of the transfers between 2 bodies (C3, arrival v-inf, delta-v) is written at the start.
+ *            Optionally, events of some bodies (apsis passages, SOI crossings, distances, conjunctions, eclipses) are written when they are detected.
+ *  \section  Dependencies
+ *            The following libraries are required:
+ *            - utils-1.0.0 (https://github.com/Pako2K/utils)
+ *  \section  Execution
+ *            It must be executed in the same directory as the Space Simulator, since it uses the same configuration files
+ *            (config/space.cfg and config/body.cfg) and DB.
+ *            The headless configuration is read from config/space_headless.cfg, unless another file is given as first argument.
+ *  \section  Build
+ *      \subsection Macros
+ *                  - DEBUG_BUILD --> Use when building for debugging and test purposes. Logs will be shown in the standard output
+ *                  - RELEASE_BUILD --> Use when building a deployable version
+ *                  - Other macros --> See Logger macros for increasing/decreasing log level
+ *  \section  Logging
+ *            Logging is performed using the Logger macros.
+ *
+ *            In Release Build, errors and info logs are by default written to the <b>logs/SpaceSimulatorHeadless.log</b> file,
+ *                unless otherwise stated via the Logger macros during the build
+ *
+ *  \author   Pako2K
+ */
+
+
+#include <fstream>
+#include <algorithm>
+#include <iomanip>
+#include <chrono>
+
+#include <logger.h>
+#include <files/properties_file_reader.h>
+#include <files/csv_file_reader.h>
+
+#include <physics/space.h>
+#include <physics/k_body.h>
+#include <physics/spatial_index.h>
+#include <physics/moid_screener.h>
+#include <physics/lambert_solver.h>
+#include <physics/porkchop.h>
+
+
+using namespace std::chrono;
+using namespace physics::units;
+
+
+// Location of the log file
+static const std::string       LOG_FILE { "logs/SpaceSimulatorHeadless.log" };
+
+// Location of the default config file with the headless configuration
+static const std::string       PROPS_FILE_NAME { "config/space_headless.cfg" };
+
+// Separator of the fields in the output files
+static const char              SEP { ';' };
+
+
+/**
+ *  @brief Writes the state (position and velocity in the inertial CS) of all the bodies
+ */
+static void writeStates(std::ofstream& file, const physics::Space& space) {
+  auto date_time = space.dateAndTime();
+
+  auto iter = space.bodies().begin();
+  while (iter.hasNext()) {
+    const physics::KBody& body = iter.next();
+    auto state = body.state();
+    file << date_time.first << SEP << date_time.second << SEP << body.name() << SEP
+         << state.first.x() << SEP << state.first.y() << SEP << state.first.z() << SEP
+         << state.second.x() << SEP << state.second.y() << SEP << state.second.z() << "\n";
+  }
+  file.flush();
+}
+
+
+/**
+ *  @brief Writes the bodies nearest to a body (and their distance to it), found with a spatial index of the positions of all the bodies
+ */
+static void writeNearest(std::ofstream& file, const physics::Space& space, const physics::KBody& target, size_t count, 
+                         const std::vector<const physics::KBody*>& bodies, std::vector<geometry::Vec3<LENGTH_T>>& positions,
+                         physics::SpatialIndex& index, std::vector<size_t>& nearest) {
+  auto date_time = space.dateAndTime();
+
+  for (size_t i = 0; i < bodies.size(); i++)
+    positions[i] = bodies[i]->state().first.vec();
+  index.build(positions);
+
+  // The body itself is the nearest one
+  const geometry::Vec3<LENGTH_T> target_position = target.state().first.vec();
+  index.nearest(target_position, count + 1, nearest);
+  size_t rank{ 0 };
+  for (size_t i : nearest) {
+    if (bodies[i] == &target)
+      continue;
+    file << date_time.first << SEP << date_time.second << SEP << target.name() << SEP << ++rank << SEP << bodies[i]->name() << SEP
+         << (positions[i] - target_position).norm() << "\n";
+    if (rank == count)
+      break;
+  }
+  file.flush();
+}
+
+
+/**
+ *  @brief Writes the pairs (minor body, planet) whose MOID is below the threshold. Only the bodies orbiting the root body are screened
+ */
+static void writeMoidCandidates(std::ofstream& file, const physics::Space& space, LENGTH_T threshold) {
+  std::vector<const physics::KBody*> minor_bodies, planets;
+  std::vector<const physics::KeplerOrbit*> minor_body_orbits, planet_orbits;
+  auto child_iter = space.bodies().children(space.bodies().root().name());
+  while (child_iter.hasNext()) {
+    const physics::KBody& body = *child_iter;
+    if (body.TYPE == physics::KBody::BodyType::MINOR_BODY) {
+      minor_bodies.push_back(&body);
+      minor_body_orbits.push_back(&body.orbit());
+    }
+    else if (body.TYPE == physics::KBody::BodyType::PLANET) {
+      planets.push_back(&body);
+      planet_orbits.push_back(&body.orbit());
+    }
+    child_iter.next();
+  }
+
+  physics::MoidScreener screener;
+  std::vector<physics::MoidScreener::Candidate> candidates;
+  screener.screen(minor_body_orbits, planet_orbits, threshold, candidates);
+
+  for (auto& candidate : candidates)
+    file << minor_bodies[candidate.body]->name() << SEP << planets[candidate.target]->name() << SEP << candidate.moid << "\n";
+  file.flush();
+
+  InfoLog("MOID screening: " + std::to_string(minor_bodies.size() * planets.size()) + " pairs, " + std::to_string(screener.calculated()) + 
+          " calculated, " + std::to_string(candidates.size()) + " candidates");
+}
+
+
+/**
+ *  @brief Writes the porkchop plot of the transfers between 2 bodies orbiting the same body, calculated from their orbits at the start
+ */
+static void writePorkchop(std::ofstream& file, bool binary, const physics::Space& space, const utils::PropertiesFileReader& properties) {
+  const physics::KBody* bodies[2]{ nullptr, nullptr };
+  const std::string names[2]{ properties.property("PORKCHOP_DEPARTURE_BODY"), properties.property("PORKCHOP_ARRIVAL_BODY") };
+  for (size_t i = 0; i < 2; i++) {
+    try {
+      bodies[i] = &space.bodies().find(names[i]);
+    }
+    catch (std::out_of_range&) {
+      throw std::string("Porkchop body " + names[i] + " does not exist");
+    }
+    if (!bodies[i]->hasParent())
+      throw std::string("Porkchop body " + names[i] + " does not have an orbit");
+  }
+  if (&bodies[0]->parent() != &bodies[1]->parent())
+    throw std::string("The porkchop bodies must orbit the same body");
+
+  physics::Porkchop::Grid grid;
+  grid.first_departure = TIME_T(space.parseDateTime(properties.property("PORKCHOP_FIRST_DEPARTURE")) - space.initDateTime());
+  grid.departure_step = TIME_T(properties.property<int32_t>("PORKCHOP_DEPARTURE_STEP"));
+  grid.departures = properties.property<uint32_t>("PORKCHOP_DEPARTURES");
+  grid.min_tof = TIME_T(properties.property<int32_t>("PORKCHOP_MIN_TOF"));
+  grid.tof_step = TIME_T(properties.property<int32_t>("PORKCHOP_TOF_STEP"));
+  grid.tofs = properties.property<uint32_t>("PORKCHOP_TOFS");
+  grid.max_revolutions = properties.property<uint32_t>("PORKCHOP_REVOLUTIONS");
+
+  physics::LambertSolver solver;
+  physics::Porkchop porkchop(solver);
+  std::vector<physics::Porkchop::Cell> cells;
+  porkchop.generate(bodies[0]->orbit(), bodies[1]->orbit(), bodies[0]->parent().reduced_mass, grid, cells);
+  if (binary)
+    physics::Porkchop::writeBinary(file, cells);
+  else
+    physics::Porkchop::writeCsv(file, cells, SEP);
+
+  InfoLog("Porkchop " + names[0] + " - " + names[1] + ": " + std::to_string(cells.size()) + " transfers");
+}
+
+
+/**
+ *  @brief Registers the events of the property EVENTS: events separated by ';', with their fields separated by ',' (see the configuration file)
+ */
+static void addEvents(physics::Space& space, const std::string& events) {
+  auto trim = [](const std::string& str) {
+    size_t first = str.find_first_not_of(" \t");
+    return first == std::string::npos ? std::string() : str.substr(first, str.find_last_not_of(" \t") - first + 1);
+  };
+  auto findBody = [&space](const std::string& name) {
+    try {
+      return &space.bodies().find(name);
+    }
+    catch (std::out_of_range&) {
+      throw std::string("Event body " + name + " does not exist");
+    }
+  };
+
+  utils::Tokenizer tokenizer;
+  std::vector<std::string> definitions, fields;
+  tokenizer(definitions, events, ';');
+  for (auto& definition : definitions) {
+    tokenizer(fields, definition, ',');
+    for (auto& field : fields)
+      field = trim(field);
+    if (fields.size() < 2)
+      throw std::string("Invalid event '" + definition + "'");
+
+    auto type = std::find(physics::EventDetector::TYPE_NAME.begin(), physics::EventDetector::TYPE_NAME.end(), fields[0]);
+    if (type == physics::EventDetector::TYPE_NAME.end())
+      throw std::string("Invalid event type '" + fields[0] + "'");
+
+    const physics::EventDetector::Type event_type = physics::EventDetector::Type(type - physics::EventDetector::TYPE_NAME.begin());
+    const physics::KBody& body = *findBody(fields[1]);
+    const physics::KBody* other{ nullptr };
+    const physics::KBody* reference{ nullptr };
+    LENGTH_T distance{ 0 };
+    switch (event_type) {
+    case physics::EventDetector::APSIS:
+      if (fields.size() > 2)
+        reference = findBody(fields[2]);
+      break;
+    case physics::EventDetector::DISTANCE:
+      if (fields.size() != 4)
+        throw std::string("Invalid event '" + definition + "': DISTANCE,body,other,distance");
+      other = findBody(fields[2]);
+      distance = std::stod(fields[3]);
+      break;
+    default:
+      if (fields.size() > 2)
+        other = findBody(fields[2]);
+      if (fields.size() > 3)
+        reference = findBody(fields[3]);
+    }
+    space.addEvent(event_type, body, other, reference, distance);
+  }
+
+  InfoLog("Events: " + std::to_string(definitions.size()) + " event functions");
+}
+
+
+/**
+ *  @brief Writes the events detected since the last call
+ */
+static void writeEvents(std::ofstream& file, physics::Space& space, std::vector<physics::Space::Event>& events) {
+  if (!space.pollEvents(events))
+    return;
+
+  for (auto& event : events) {
+    auto date_time = space.dateAndTime(TIME_T(TIME_T::rep(event.time)));
+    file << date_time.first << SEP << date_time.second << SEP << event.time << SEP << physics::EventDetector::eventName(event.type, event.rising) << SEP
+         << event.body->name() << SEP << (event.other ? event.other->name() : "") << SEP << (event.reference ? event.reference->name() : "") << "\n";
+  }
+  file.flush();
+}
+
+
+/**
+ *  @brief Writes the statistics of the execution: total ticks, real time and speed since the start and in the last interval
+ */
+static void writeStats(std::ofstream& file, const physics::Space& space, uint64_t ticks, duration<double> real_time, uint64_t interval_ticks, duration<double> interval_real_time) {
+  auto date_time = space.dateAndTime();
+
+  file << date_time.first << SEP << date_time.second << SEP << ticks << SEP << real_time.count() << SEP
+       << (interval_real_time.count() > 0 ? interval_ticks / interval_real_time.count() : 0) << SEP
+       << (real_time.count() > 0 ? space.elapsedTime().count() / real_time.count() : 0) << "\n";
+  file.flush();
+
+  InfoLog(date_time.first + " " + date_time.second + " -- TICKS " + std::to_string(ticks) + " -- REAL TIME " + std::to_string(real_time.count()) + " s");
+}
+
+
+/**
+ *  @brief Application entry function
+ *
+ *  It initializes the Logger, creates the Space singleton and runs the simulation until the end date
+ *
+ *  Configuration file properties (all mandatory):
+ *    START_DATE_TIME  --> Start of the simulation, in the space date/time format (the space jumps directly to it)
+ *    END_DATE_TIME    --> End of the simulation, in the space date/time format
+ *    TICK             --> Tick time, in simulation seconds
+ *    STATES_FILE      --> Output file for the states of the bodies (CSV)
+ *    STATS_FILE       --> Output file for the statistics of the execution (CSV)
+ *
+ *  Optional properties:
+ *    END_STATE_FILE   --> Output file for the state of the space at the end of the simulation (see Space::saveState())
+ *    PROXIMITY_BODY   --> Body whose nearest bodies are written every LOG_INTERVAL (the following 2 properties are then mandatory)
+ *    PROXIMITY_COUNT  --> Number of nearest bodies
+ *    PROXIMITY_FILE   --> Output file for the nearest bodies (CSV)
+ *    MOID_THRESHOLD   --> Maximum MOID (in meters) of the pairs (minor body, planet) written at the start (the following property is then mandatory)
+ *    MOID_FILE        --> Output file for the candidate pairs (CSV)
+ *    PORKCHOP_FILE    --> Output file for the porkchop plot (the following properties are then mandatory)
+ *    PORKCHOP_FORMAT  --> CSV or BINARY (see physics::Porkchop::writeBinary())
+ *    PORKCHOP_DEPARTURE_BODY, PORKCHOP_ARRIVAL_BODY --> Bodies of the transfers (they must orbit the same body)
+ *    PORKCHOP_FIRST_DEPARTURE --> First departure, in the space date/time format
+ *    PORKCHOP_DEPARTURES, PORKCHOP_DEPARTURE_STEP --> Number of departures and seconds between them
+ *    PORKCHOP_TOFS, PORKCHOP_MIN_TOF, PORKCHOP_TOF_STEP --> Number of times of flight, the shortest one and the seconds between them
+ *    PORKCHOP_REVOLUTIONS --> Maximum number of complete revolutions of the transfers
+ *    EVENTS           --> Events to be detected (the following property is then mandatory, see addEvents())
+ *    EVENTS_FILE      --> Output file for the events (CSV)
+ */
+int main(int argc, char** args) {
+
+  InitializeLogger(LOG_FILE);
+
+  int return_code{ 0 };
+  try {
+    // Read properties file
+    utils::PropertiesFileReader properties(argc > 1 ? args[1] : PROPS_FILE_NAME);
+
+    physics::Space& space = physics::Space::create();
+
+    auto start_date_time = space.parseDateTime(properties.property("START_DATE_TIME"));
+    auto end_date_time = space.parseDateTime(properties.property("END_DATE_TIME"));
+    if (end_date_time <= start_date_time)
+      throw std::string("END_DATE_TIME must be after START_DATE_TIME");
+
+    TIME_T tick{ properties.property<int32_t>("TICK") };
+    if (tick.count() <= 0)
+      throw std::string("TICK must be positive");
+    space.tick(tick);
+
+    // The space can start at a later date/time, if it was loaded from a state file
+    if (start_date_time != space.initDateTime() + space.elapsedTime())
+      space.jumpTo(start_date_time);
+
+    const TIME_T end_time{ end_date_time - space.initDateTime() };
+
+    // Output files
+    std::ofstream states_file(properties.property("STATES_FILE"));
+    std::ofstream stats_file(properties.property("STATS_FILE"));
+    if (!states_file || !stats_file)
+      throw std::string("The output files cannot be opened");
+
+    states_file << std::setprecision(15);
+    states_file << "DATE" << SEP << "TIME" << SEP << "BODY" << SEP << "X" << SEP << "Y" << SEP << "Z" << SEP << "VX" << SEP << "VY" << SEP << "VZ" << "\n";
+    stats_file << "DATE" << SEP << "TIME" << SEP << "TICKS" << SEP << "REAL_TIME" << SEP << "TPS" << SEP << "SIM_SPEED" << "\n";
+
+    // Optional proximity analysis. The tree of bodies is not changed during the simulation, so the bodies are collected only once
+    const physics::KBody* proximity_body{ nullptr };
+    size_t proximity_count{ 0 };
+    std::ofstream proximity_file;
+    std::vector<const physics::KBody*> proximity_bodies;
+    std::vector<geometry::Vec3<LENGTH_T>> proximity_positions;
+    physics::SpatialIndex proximity_index;
+    std::vector<size_t> proximity_nearest;
+    auto proximity_body_prop = properties.getProperties().find("PROXIMITY_BODY");
+    if (proximity_body_prop != properties.getProperties().end()) {
+      try {
+        proximity_body = &space.bodies().find(proximity_body_prop->second);
+      }
+      catch (std::out_of_range&) {
+        throw std::string("PROXIMITY_BODY " + proximity_body_prop->second + " does not exist");
+      }
+      proximity_count = properties.property<uint32_t>("PROXIMITY_COUNT");
+      proximity_file.open(properties.property("PROXIMITY_FILE"));
+      if (!proximity_file)
+        throw std::string("The proximity file cannot be opened");
+      proximity_file << std::setprecision(15);
+      proximity_file << "DATE" << SEP << "TIME" << SEP << "BODY" << SEP << "RANK" << SEP << "NEAREST" << SEP << "DISTANCE" << "\n";
+
+      auto iter = space.bodies().begin();
+      while (iter.hasNext())
+        proximity_bodies.push_back(&iter.next());
+      proximity_positions.resize(proximity_bodies.size());
+    }
+
+    space.synchronize();
+
+    // Optional close approach screening, with the orbits at the start
+    auto moid_threshold = properties.getProperties().find("MOID_THRESHOLD");
+    if (moid_threshold != properties.getProperties().end()) {
+      std::ofstream moid_file(properties.property("MOID_FILE"));
+      if (!moid_file)
+        throw std::string("The MOID file cannot be opened");
+      moid_file << std::setprecision(15);
+      moid_file << "BODY" << SEP << "PLANET" << SEP << "MOID" << "\n";
+      writeMoidCandidates(moid_file, space, std::stod(moid_threshold->second));
+    }
+
+    // Optional porkchop plot, with the orbits at the start
+    auto porkchop_file_name = properties.getProperties().find("PORKCHOP_FILE");
+    if (porkchop_file_name != properties.getProperties().end()) {
+      const std::string format = properties.property("PORKCHOP_FORMAT");
+      if (format != "CSV" && format != "BINARY")
+        throw std::string("PORKCHOP_FORMAT must be CSV or BINARY");
+      std::ofstream porkchop_file(porkchop_file_name->second, format == "BINARY" ? std::ios::binary : std::ios::out);
+      if (!porkchop_file)
+        throw std::string("The porkchop file cannot be opened");
+      porkchop_file << std::setprecision(15);
+      writePorkchop(porkchop_file, format == "BINARY", space, properties);
+    }
+
+    // Optional events, detected during the simulation
+    std::ofstream events_file;
+    std::vector<physics::Space::Event> events;
+    auto events_prop = properties.getProperties().find("EVENTS");
+    if (events_prop != properties.getProperties().end()) {
+      events_file.open(properties.property("EVENTS_FILE"));
+      if (!events_file)
+        throw std::string("The events file cannot be opened");
+      events_file << std::setprecision(15);
+      events_file << "DATE" << SEP << "TIME" << SEP << "ELAPSED_TIME" << SEP << "EVENT" << SEP << "BODY" << SEP << "OTHER" << SEP << "REFERENCE" << "\n";
+      addEvents(space, events_prop->second);
+    }
+
+    writeStates(states_file, space);
+    if (proximity_body)
+      writeNearest(proximity_file, space, *proximity_body, proximity_count, proximity_bodies, proximity_positions, proximity_index, proximity_nearest);
+
+    // Run the simulation
+    const auto real_start = steady_clock::now();
+    auto real_last_log = real_start;
+    uint64_t ticks{ 0 };
+    uint64_t last_log_ticks{ 0 };
+    TIME_T last_log_time{ space.elapsedTime() };
+
+    while (space.elapsedTime() < end_time) {
+      // The last tick is reduced so the simulation ends exactly at the end date
+      if (space.elapsedTime() + tick > end_time)
+        space.tick(end_time - space.elapsedTime());
+
+      space.runTick();
+      ++ticks;
+
+      if (events_file.is_open())
+        writeEvents(events_file, space, events);
+
+      if (space.elapsedTime() - last_log_time >= space.logInterval() || space.elapsedTime() >= end_time) {
+        auto now = steady_clock::now();
+        space.synchronize();
+        writeStates(states_file, space);
+        if (proximity_body)
+          writeNearest(proximity_file, space, *proximity_body, proximity_count, proximity_bodies, proximity_positions, proximity_index, proximity_nearest);
+        writeStats(stats_file, space, ticks, now - real_start, ticks - last_log_ticks, now - real_last_log);
+
+        real_last_log = now;
+        last_log_ticks = ticks;
+        last_log_time = space.elapsedTime();
+      }
+    }
+
+    auto end_state_file = properties.getProperties().find("END_STATE_FILE");
+    if (end_state_file != properties.getProperties().end())
+      space.saveState(end_state_file->second);
+
+    space.destroy();
+  }
+  catch (std::exception& exc) {
+    ErrorLog( exc.what() );
+    return_code = 1;
+  }
+  catch (std::string& exc) {
+    ErrorLog( exc );
+    return_code = 1;
+  }
+  catch (...) {
+    ErrorLog("Unexpected exception!");
+    return_code = 1;
+  }
+
+  DestroyLogger();
+  return return_code;
+}
@@ -59,7 +59,8 @@ public:
 
 protected:
   /**
-    *  \brief  Implementation of the application logic
+    *  \brief  Implementation of the application logic, executed once per frame
+    *          The simulation runs in its own thread: the info on the screen is updated from its latest snapshot
     */
   virtual void eventLoopIteration() override;
 //////
@@ -204,6 +205,22 @@ private:
     */
   REAL_TIME_UNIT _total_elapsed_time{ 0 };
 
+  /**
+    *  \brief  Real time since the last update of the info on the screen, and frames rendered in that time
+    */
+  REAL_TIME_UNIT _info_upd_timer{ 0 };
+  size_t         _frames{ 0 };
+
+  /**
+    *  \brief  Simulation ticks executed until the last update of the info on the screen
+    */
+  uint64_t _last_ticks{ 0 };
+
+  /**
+    *  \brief  State of the simulation requested by the user (the simulation thread will apply it before its next tick)
+    */
+  bool _paused{ false };
+
   /**
     *  \brief  Initialization of windows objects in the constructor 
     */
@@ -214,18 +231,17 @@ private:
     */
   void setListeners();
 
-  /**
-    *  \brief Pointer to the function to be called for running the simulation
-    *         By default it will point to Space::is_running(). But if the simulation is paused it'll point to the local is_paused()
-    */
-  void  (SpaceSimulatorWnd::* runTick)(void) { &SpaceSimulatorWnd::isRunning };
-
   /**
     * \brief  Default allowed tick values
     *         These are the default allowed values for the tick time when using the methods incTick or decTick.
     */
   const std::array<int16_t, 13> _DEFAULT_TICKS{ 1, 2, 5, 10, 20, 30, 60, 120, 300, 600, 1200, 3600, 18000 };
 
+  /**
+    * \brief  Number of ticks moved back by the method rewind
+    */
+  static constexpr int64_t REWIND_TICKS{ 1000 };
+
   /**
     * \brief  Selected tick position in _DEFAULT_TICKS
     */
@@ -249,41 +265,29 @@ private:
 //////  bool updateStats();
 //////
   /**
-    *  \brief Switches the state of the simulation to paused or un-paused
+    *  \brief Switches the state of the simulation to paused or un-paused, sending the command to the simulation thread
     *
     *  @return void
     */
   void pause();
 
   /**
-    *  \brief Function to be called when the simulation is paused
-    *         This function has the same signature as Space::is_running() so it can be pointed by
-    *         the local runTick function pointer
-    *
-    *  @return void
-    */
-  void isPaused() { } // DO NOTHING
-
-  /**
-    *  \brief Function to be called when the simulation is running
-    *         This function has the same signature as Space::is_paused() so it can be pointed by
-    *         the local runTick function pointer
-    *
-    *  @return void
+    *  \brief Increase Tick time to the next predefined value (sending the command to the simulation thread)
+    *  @return  void
     */
-  void isRunning();
+  void incTick();
 
   /**
-    *  \brief Increase Tick time to the next predefined value
+    *  \brief Decrease Tick time to the next predefined value (sending the command to the simulation thread)
     *  @return  void
     */
-  void incTick();
+  void decTick();
 
   /**
-    *  \brief Decrease Tick time to the next predefined value
+    *  \brief Moves the simulation back REWIND_TICKS ticks (sending the command to the simulation thread)
     *  @return  void
     */
-  void decTick();
+  void rewind();
 
   // Add bodies to the list sorted by distance
   void addBodiesByDistance();
@@ -31,6 +31,11 @@ void SpaceSimulatorWnd::keyPressed(int key, int scancode, int modifiers) {
       incTick();
     return;
   }
+  // Rewind
+  if (*keyname == 'R') {
+    rewind();
+    return;
+  }
 }
 
 //////
@@ -2,6 +2,7 @@
 #include <space_simulator_wnd.defs.h>
 
 #include <chrono>
+#include <algorithm>
 
 #include <logger.h>
 #include <misc/formatDateTime.h>
@@ -24,7 +25,10 @@ SpaceSimulatorWnd::SpaceSimulatorWnd(const std::pair<std::string, std::string>&
   initializeLayout();
 
   setListeners();
-  
+
+  // Run the simulation in its own thread
+  _space.start();
+  _timestamp = high_resolution_clock::now();
   
 //////
 //////  // Initialize tracking
@@ -95,6 +99,7 @@ SpaceSimulatorWnd::~SpaceSimulatorWnd() {
 
 ////  body_renderer->destroy();
 
+  _space.stop();
   _space.destroy();
 }
 
@@ -104,28 +109,27 @@ SpaceSimulatorWnd::~SpaceSimulatorWnd() {
 /* ************************************************* PROTECTED ********************************************************** */
 
 void SpaceSimulatorWnd::eventLoopIteration() {
-  // Run internal loop until the info update interval time is reached
-  REAL_TIME_UNIT elapsed_time{ 0 };
-  REAL_TIME_UNIT info_upd_timer{ 0 };
-  size_t total_ticks{ 0 }; 
-  do {
-    //**********************************************************//
-    //**** EXECUTE SPACE TICK, unless simulation is paused *****//
-    //**********************************************************//
-    (this->*runTick)();
-
-    // Calculate elapsed_time and info_upd_timer in the tick iteration 
-    elapsed_time = high_resolution_clock::now() - _timestamp;
-    info_upd_timer += elapsed_time;
-    _timestamp += elapsed_time;
-
-    ++total_ticks;
-  } while (info_upd_timer <= _INFO_UPD_INTERVAL);
-
-  _total_elapsed_time += info_upd_timer;
+  // Calculate elapsed_time and info_upd_timer in the frame
+  REAL_TIME_UNIT elapsed_time{ high_resolution_clock::now() - _timestamp };
+  _info_upd_timer += elapsed_time;
+  _timestamp += elapsed_time;
+  ++_frames;
+
+  // Update the info only when the info update interval time is reached
+  if (_info_upd_timer <= _INFO_UPD_INTERVAL)
+    return;
+
+  _total_elapsed_time += _info_upd_timer;
+
+  // Latest state published by the simulation thread
+  const auto& snapshot = _space.snapshot();
   
-  size_t avg_fps{ size_t(_UNITS_PER_SEC / info_upd_timer.count() + 0.5) };
-  size_t avg_tps{ size_t(_UNITS_PER_SEC * total_ticks / info_upd_timer.count()) };
+  size_t avg_fps{ size_t(_UNITS_PER_SEC * _frames / _info_upd_timer.count()) };
+  size_t avg_tps{ size_t(_UNITS_PER_SEC * (snapshot.ticks - _last_ticks) / _info_upd_timer.count()) };
+
+  _info_upd_timer = REAL_TIME_UNIT(0);
+  _frames = 0;
+  _last_ticks = snapshot.ticks;
 
   // Update real datetime
   _real_date_time = utils::formatDateTime(time_point_cast<seconds>(system_clock::now()), _REAL_DATETIME_FORMAT.first, _REAL_DATETIME_FORMAT.second);
@@ -134,7 +138,8 @@ void SpaceSimulatorWnd::eventLoopIteration() {
   
   // Update labels on the screen
   _lbl_fps_value->text(std::to_string(avg_fps));
-  _lbl_tps_value->text(std::to_string(avg_tps));
+  // The simulation cannot keep up with the real-time factor
+  _lbl_tps_value->text(std::to_string(avg_tps) + (snapshot.lagging ? " !" : ""));
 
   _lbl_date->text(_real_date_time.first);
   _lbl_time->text(_real_date_time.second);
@@ -142,15 +147,15 @@ void SpaceSimulatorWnd::eventLoopIteration() {
                       std::to_string( (duration_cast<seconds>(_total_elapsed_time).count() % 3600) / 60 ) + " m " +
                       std::to_string( duration_cast<seconds>(_total_elapsed_time).count() % 60 ) + " s" );
 
-  auto sim_date_time = _space.dateAndTime();
+  auto sim_date_time = _space.dateAndTime(snapshot.elapsed_time);
   _lbl_sim_date->text(sim_date_time.first);
   _lbl_sim_time->text(sim_date_time.second.substr(0,5));
-  _lbl_sim_elapsed->text(std::to_string(_space.elapsedTime().count() / 31557600) + " y " +
-                         std::to_string( (_space.elapsedTime().count() % 31557600) / 86400 ) + " d " +
-                         std::to_string( (_space.elapsedTime().count() % 86400) / 3600 ) + " h " +
-                         std::to_string( (_space.elapsedTime().count() % 3600) / 60 ) + " m");
+  _lbl_sim_elapsed->text(std::to_string(snapshot.elapsed_time.count() / 31557600) + " y " +
+                         std::to_string( (snapshot.elapsed_time.count() % 31557600) / 86400 ) + " d " +
+                         std::to_string( (snapshot.elapsed_time.count() % 86400) / 3600 ) + " h " +
+                         std::to_string( (snapshot.elapsed_time.count() % 3600) / 60 ) + " m");
 
-   _lbl_tick_value->text(std::to_string(_space.tick().count()) + " s");
+   _lbl_tick_value->text(std::to_string(snapshot.tick.count()) + " s");
 }
 
 void SpaceSimulatorWnd::drawMainWindow() {
@@ -193,31 +198,8 @@ void SpaceSimulatorWnd::drawMainWindow() {
 
 /* ************************************************* PRIVATE ************************************************************ */
 void SpaceSimulatorWnd::pause() {
-  if ( runTick == &SpaceSimulatorWnd::isPaused )
-    runTick = &SpaceSimulatorWnd::isRunning;
-  else
-    runTick = &SpaceSimulatorWnd::isPaused;
-}
-
-
-void SpaceSimulatorWnd::isRunning() {
-  // !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-  // !!!                                               !!!
-  // !!!   MOST IMPORTANT FUNCTION: RUN A SPACE TICK   !!!
-  // !!!                                               !!!
-                      _space.runTick();
-  // !!!                                               !!!
-  // !!!                                               !!!
-  // !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-
-
-///  ////////// Store tracking information after the defined tracking interval of simulation time
-///  ////////static decltype(_tracking_interval) track_timer{ 0 };
-///  ////////track_timer += _space.tick();
-///  ////////if (track_timer >= _tracking_interval) {
-///  ////////  track_timer = 0s;
-///  ////////  tracker->track(std::chrono::duration_cast<physics::units::TIME_T>(TIMESTAMP_T(_timestamp)), _avg_fps);
-///  ////////}
+  _paused = !_paused;
+  _space.post({ _paused ? physics::Space::Command::PAUSE : physics::Space::Command::RESUME });
 }
 
 
@@ -225,7 +207,7 @@ void SpaceSimulatorWnd::incTick() {
   if (_def_ticks_offset < _DEFAULT_TICKS.size() - 1 ) {
     // Increase to the next default value
     _def_ticks_offset++;
-    _space.tick(static_cast<physics::units::TIME_T>(_DEFAULT_TICKS.at(_def_ticks_offset)));
+    _space.post({ physics::Space::Command::TICK, static_cast<physics::units::TIME_T>(_DEFAULT_TICKS.at(_def_ticks_offset)) });
   }
 }
 
@@ -234,9 +216,15 @@ void SpaceSimulatorWnd::decTick() {
   if (_def_ticks_offset > 0 ) {
     // Decrease to the previous default value
     _def_ticks_offset--;
-    _space.tick(static_cast<physics::units::TIME_T>(_DEFAULT_TICKS.at(_def_ticks_offset)));
+    _space.post({ physics::Space::Command::TICK, static_cast<physics::units::TIME_T>(_DEFAULT_TICKS.at(_def_ticks_offset)) });
   }
 }
 
 
+void SpaceSimulatorWnd::rewind() {
+  auto rewind_time = _space.snapshot().elapsed_time - static_cast<physics::units::TIME_T>(REWIND_TICKS * _DEFAULT_TICKS.at(_def_ticks_offset));
+  _space.post({ physics::Space::Command::REWIND_TO, std::max(rewind_time, physics::units::TIME_T(0)) });
+}
+
+
 /* ************************************************* PRIVATE (END) ****************************************************** */
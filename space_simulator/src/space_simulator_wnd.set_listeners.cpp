@@ -42,24 +42,29 @@ void SpaceSimulatorWnd::updateBodiesByDistance() {
 
   _list_bodies->update(pos++, _space.bodies().root().name());
 
-  std::map<physics::units::LENGTH_T, std::string> by_distance;
-  auto child_iter = _space.bodies().children(_space.bodies().root().name());
-  while (child_iter.hasNext()) {
-    if (SHOW_BODY(*child_iter)) {
-      by_distance[(*child_iter).orbit().a()] = (*child_iter).name();
+  // The bodies are moved by the simulation thread: use its latest snapshot
+  const auto& snapshot = _space.snapshot();
+  auto children = snapshot.children();
+
+  // The bodies shown in the first level of the list are sorted by their current distance to the root
+  const auto& root_position = snapshot.state(_space.bodies().root()).position;
+  std::multimap<physics::units::LENGTH_T, const physics::Space::BodyState*> child_by_distance;
+  for (const physics::KBody* child : children[&_space.bodies().root()]) {
+    if (SHOW_BODY(*child)) {
+      const physics::Space::BodyState& child_state = snapshot.state(*child);
+      child_by_distance.emplace((child_state.position - root_position).norm(), &child_state);
     }
-    child_iter.next();
   }
-  for (auto& pair : by_distance) {
-    _list_bodies->update(pos++, "   " + pair.second);
 
+  for (auto& c_pair : child_by_distance) {
+    const physics::Space::BodyState& child = *c_pair.second;
+    _list_bodies->update(pos++, "   " + child.body->name());
+
+    // The satellites are sorted by their current distance to the body
     if (_list_filter_mask & _SHOW_SATELLITES) {
-      auto grand_child_iter = _space.bodies().children(pair.second);
-      std::map<physics::units::LENGTH_T, std::string> grand_child_by_distance;
-      while (grand_child_iter.hasNext()) {
-        grand_child_by_distance[(*grand_child_iter).orbit().a()] = (*grand_child_iter).name();
-        grand_child_iter.next();
-      }
+      std::multimap<physics::units::LENGTH_T, std::string> grand_child_by_distance;
+      for (const physics::KBody* grand_child : children[child.body])
+        grand_child_by_distance.emplace((snapshot.state(*grand_child).position - child.position).norm(), grand_child->name());
       for (auto& gc_pair : grand_child_by_distance)
         _list_bodies->update(pos++, "      " + gc_pair.second);
     }
@@ -78,24 +83,18 @@ void SpaceSimulatorWnd::updateBodiesByMass() {
 
   _list_bodies->unselect();
 
-  std::string body_name;
-  body_name = _space.bodies().root().name();
-  _list_bodies->update(pos++, body_name);
+  _list_bodies->update(pos++, _space.bodies().root().name());
 
-  auto child_iter = _space.bodies().children(body_name);
-  while (child_iter.hasNext()) {
-    body_name = (*child_iter).name();
-    if (SHOW_BODY(*child_iter)) {
-      _list_bodies->update(pos++, "   " + body_name);
+  // The ships are moved in the tree by the simulation thread: use the hierarchy of its latest snapshot
+  auto children = _space.snapshot().children();
+  for (const physics::KBody* child : children[&_space.bodies().root()]) {
+    if (SHOW_BODY(*child)) {
+      _list_bodies->update(pos++, "   " + child->name());
     }
     if (_list_filter_mask & _SHOW_SATELLITES) {
-      auto grand_child_iter = _space.bodies().children(body_name);
-      while (grand_child_iter.hasNext()) {
-        _list_bodies->update(pos++, "      " + (*grand_child_iter).name());
-        grand_child_iter.next();
-      }
+      for (const physics::KBody* grand_child : children[child])
+        _list_bodies->update(pos++, "      " + grand_child->name());
     }
-    child_iter.next();
   }
 
   // Remove elements from the list which are not used any more
@@ -113,30 +112,29 @@ void SpaceSimulatorWnd::updateBodiesByName() {
 
   _list_bodies->update(pos++, _space.bodies().root().name());
 
-  std::map<std::string, std::string> child_hashmap;
+  // The ships are moved in the tree by the simulation thread: use the hierarchy of its latest snapshot
+  auto children = _space.snapshot().children();
+
+  std::map<std::string, const physics::KBody*> child_hashmap;
   std::string common_name;
-  auto child_iter = _space.bodies().children(_space.bodies().root().name());
-  while (child_iter.hasNext()) {
-    if (SHOW_BODY(*child_iter)) {
-      common_name = (*child_iter).COMMON_NAME;
+  for (const physics::KBody* child : children[&_space.bodies().root()]) {
+    if (SHOW_BODY(*child)) {
+      common_name = child->COMMON_NAME;
       if (common_name == "")
-        common_name = (*child_iter).PROVISIONAL_NAME;
-      child_hashmap[common_name] = (*child_iter).name();
+        common_name = child->PROVISIONAL_NAME;
+      child_hashmap[common_name] = child;
     }
-    child_iter.next();
   }
   for (auto& pair : child_hashmap) {
-    _list_bodies->update(pos++, "   " + pair.second);
+    _list_bodies->update(pos++, "   " + pair.second->name());
 
     if (_list_filter_mask & _SHOW_SATELLITES) {
-      auto grand_child_iter = _space.bodies().children(pair.second);
-      decltype(child_hashmap) grand_child_hashmap;
-      while (grand_child_iter.hasNext()) {
-        common_name = (*grand_child_iter).COMMON_NAME;
+      std::map<std::string, std::string> grand_child_hashmap;
+      for (const physics::KBody* grand_child : children[pair.second]) {
+        common_name = grand_child->COMMON_NAME;
         if (common_name == "")
-          common_name = (*grand_child_iter).PROVISIONAL_NAME;
-        grand_child_hashmap[common_name] = (*grand_child_iter).name();
-        grand_child_iter.next();
+          common_name = grand_child->PROVISIONAL_NAME;
+        grand_child_hashmap[common_name] = grand_child->name();
       }
       for (auto& gc_pair : grand_child_hashmap)
         _list_bodies->update(pos++, "      " + gc_pair.second);
@@ -157,27 +155,21 @@ void SpaceSimulatorWnd::updateBodiesById() {
 
   _list_bodies->update(pos++, _space.bodies().root().name());
 
-  std::map<int64_t, std::string> child_hashmap;
-  int64_t body_id;
-  auto child_iter = _space.bodies().children(_space.bodies().root().name());
-  while (child_iter.hasNext()) {
-    if (SHOW_BODY(*child_iter)) {
-      body_id = (*child_iter).ID;
-      child_hashmap[body_id] = (*child_iter).name();
-    }
-    child_iter.next();
+  // The ships are moved in the tree by the simulation thread: use the hierarchy of its latest snapshot
+  auto children = _space.snapshot().children();
+
+  std::map<int64_t, const physics::KBody*> child_hashmap;
+  for (const physics::KBody* child : children[&_space.bodies().root()]) {
+    if (SHOW_BODY(*child))
+      child_hashmap[child->ID] = child;
   }
   for (auto& pair : child_hashmap) {
-    _list_bodies->update(pos++, "   " + pair.second);
+    _list_bodies->update(pos++, "   " + pair.second->name());
 
     if (_list_filter_mask & _SHOW_SATELLITES) {
-      auto grand_child_iter = _space.bodies().children(pair.second);
-      decltype(child_hashmap) grand_child_hashmap;
-      while (grand_child_iter.hasNext()) {
-        body_id = (*grand_child_iter).ID;
-        grand_child_hashmap[body_id] = (*grand_child_iter).name();
-        grand_child_iter.next();
-      }
+      std::map<int64_t, std::string> grand_child_hashmap;
+      for (const physics::KBody* grand_child : children[pair.second])
+        grand_child_hashmap[grand_child->ID] = grand_child->name();
       for (auto& gc_pair : grand_child_hashmap)
         _list_bodies->update(pos++, "      " + gc_pair.second);
     }
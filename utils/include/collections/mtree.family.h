@@ -1,5 +1,6 @@
 /**
-  *  \brief  Family type definition: container of nodes (a deque) in the order of creation plus a vector of sorted references (by the node object value) to the nodes.
+  *  \brief  Family type definition: container of nodes (a list) in the order of creation plus a vector of sorted references (by the node object value) to the nodes.
+  *          The nodes are not moved in memory when other nodes are added or removed, so the pointers to them remain valid.
   *          A family is created empty. Nodes will be added or removed afterwards.
   *          When a family is added to a Tree, it must be posible to move it. Families can't be copied or assigned since that would break all the node pointers.
   */
@@ -92,13 +93,43 @@ public:
   }
 
 
+  /**
+    *  \brief  Adds a node at the end of the vector of sorted nodes, without sorting it (see sortNodes())
+    *  @param  new_node  A new node as rvalue to be moved into the nodes of the family
+    *  @return  A reference to the inserted node
+    */
+  Node& appendNode(Node&& new_node) {
+    _nodes.emplace_back(std::move(new_node));
+    _sorted_nodes.push_back(&_nodes.back());
+
+    return _nodes.back();
+  }
+
+
+  /**
+    *  \brief  Sorts the vector of sorted nodes after they have been appended. The nodes with the same sorting key keep the order of insertion, as with addNode()
+    */
+  void sortNodes() {
+    std::stable_sort(_sorted_nodes.begin(), _sorted_nodes.end(), [](const Node* node_1, const Node* node_2) { return node_1->value() < node_2->value(); });
+  }
+
+
   /**
     *  \brief  Removes a node from the family, recalculating the values of the pointers in the sorted nodes
     *          It cannot check whether the node has descendants (that must be done previously before calling this method)
     *           It will not check whether the node exists: it is assumed that has already been checked
     *  @param  old_node  A reference to the node to be removed
     */
-  void removeNode(Node& old_node) {
+  void removeNode(Node& old_node) { extractNode(old_node); }
+
+
+  /**
+    *  \brief  Removes a node from the family and returns it (e.g. to add it to another family). The value of the node is not moved in memory
+    *           It will not check whether the node exists: it is assumed that has already been checked
+    *  @param  old_node  A reference to the node to be removed
+    *  @return  The removed node
+    */
+  Node extractNode(Node& old_node) {
     //    First, search the node in the sorted nodes
     auto _sorted_nodes_it = _sorted_nodes.begin();
     while ((*_sorted_nodes_it)->value() < old_node.value())
@@ -109,12 +140,14 @@ public:
     //    Found: remove it
     _sorted_nodes.erase(_sorted_nodes_it);
 
-    //    Second search the node in the list of nodes
+    //    Second search the node in the list of nodes (the other nodes are not moved when it is erased)
     auto nodes_it = _nodes.begin();
-    while (nodes_it->value().matchingKey() != old_node.value().matchingKey())
+    while (&(*nodes_it) != &old_node)
       ++nodes_it;
-    //      Iterator is pointing to the found node: delete it
+    Node node(std::move(*nodes_it));
     _nodes.erase(nodes_it);
+
+    return node;
   }
 
 
@@ -155,7 +188,7 @@ public:
   Node& operator[](size_t pos) {
     if(pos >= _nodes.size())
       throw std::out_of_range("Invalid position");
-    return _nodes[pos];
+    return *std::next(_nodes.begin(), pos);
   }
 
   
@@ -168,16 +201,16 @@ public:
   const Node& operator[](size_t pos) const {
     if (pos >= _nodes.size())
       throw std::out_of_range("Invalid position");
-    return _nodes[pos];
+    return *std::next(_nodes.begin(), pos);
   }
 
 
 protected:
 
   /**
-    *  \brief  List of nodes in the order of insertion, stored as a deque to avoid copying
+    *  \brief  List of nodes in the order of insertion, stored as a list to avoid copying or moving them
     */
-  std::deque<Node> _nodes;
+  std::list<Node> _nodes;
 
 
   /**
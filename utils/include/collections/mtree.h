@@ -3,6 +3,7 @@
 
 #include <type_traits>
 #include <deque>
+#include <list>
 #include <vector>
 #include <map>
 #include <stdexcept>
@@ -10,6 +11,7 @@
 #include <ostream>
 #include <string>
 #include <memory>
+#include <algorithm>
 
 #include <logger.h>
 #include <collections/unique_sortable.h>
@@ -24,7 +26,8 @@ namespace tree
     *          The Tree takes ownership of the objects passed as values for the nodes, and will store them in the heap. 
     *          As a consequence NO DOWNCASTING will be possible anymore, if an object derived from type OBJ_T is added to the tree.
     *          The tree has a single root parent. Each child node has a single parent, and each parent can have [0..n] children.
-    *          The tree is represented by a deque of families. Each Family is a deque of Nodes with the same parent Node. 
+    *          The tree is represented by a deque of families. Each Family is a list of Nodes with the same parent Node, so the nodes are not moved in memory
+    *          when other nodes are added to or removed from their family. 
     *          The order is stored in a vector of sorted references to the objects in the family
     *
     *          Template parameters:
@@ -141,6 +144,21 @@ namespace tree
       */
     void addNode(OBJ_T* obj, const typename OBJ_T::match_key_type& parent_key) { addNode(std::move(*obj), parent_key); delete obj; }
 
+    /**
+      *  \brief  Builds the whole tree at once from the index of the parent of every node. The nodes are created so that the parents precede their 
+      *          children, and they are added without searching their parents by key. The families are sorted once, and the index of keys is filled 
+      *          in the order of the list, which is fast when the keys are sorted (e.g. the iteration order of a saved tree)
+      *  @param  parents  Index of the parent of each node in the list (negative for the root)
+      *  @param  create   Function creating the value of each node, OBJ_T* create(size_t index, OBJ_T* parent), where the parent is already in the tree 
+      *                   (nullptr for the root). The tree takes ownership of the value, as in addNode()
+      *  @return  Pointers to the values in the tree, in the order of the list
+      *  @throw  logic_error  If the tree is not empty
+      *  @throw  invalid_argument  If there is not a single root, a parent index is not valid, the hierarchy has cycles or a key is repeated. Then, as 
+      *                            with the exceptions thrown by the function, the tree is left empty
+      */
+    template <class FACTORY>
+    std::vector<OBJ_T*> adoptNodes(const std::vector<int64_t>& parents, FACTORY&& create);
+
     /**
       *  \brief  Removes a node with the given value key from the tree. If the flag is true then removes all the descendant nodes. Otherwise only a final (leaf) node can be removed.
       *          If the descendant family and the node's family itself are empty, thy will not be removed, since that would lead to a cascade
@@ -151,6 +169,14 @@ namespace tree
       */
     void removeNode(const typename OBJ_T::match_key_type& key, bool with_desc = false);
 
+    /**
+      *  \brief  Moves a node, with all its descendants, under another parent node. The values are not moved in memory, so references to them remain valid
+      *  @param  key  The value key of the node to be moved
+      *  @param  parent_key  The value key of the new parent node
+      *  @throw  invalid_argument  If any of the nodes does not exist, the node is the root or the new parent is the node itself or one of its descendants
+      */
+    void moveNode(const typename OBJ_T::match_key_type& key, const typename OBJ_T::match_key_type& parent_key);
+
     /**
       *  \brief  Returns the number of elements in the tree
       *  @return  The number of elements in the tree
@@ -51,6 +51,91 @@ void TREE_CLS::addNode(OBJ_T&& obj, const typename OBJ_T::match_key_type& parent
 }
 
 
+/*   std::vector<OBJ_T*> adoptNodes(const std::vector<int64_t>& parents, FACTORY&& create)   */
+/********************************************************************************************/
+TREE_TEMPLATE
+template <class FACTORY>
+std::vector<OBJ_T*> TREE_CLS::adoptNodes(const std::vector<int64_t>& parents, FACTORY&& create) {
+  if (_size > 0)
+    throw std::logic_error("Tree already has a root");
+
+  // Children of every node (grouped by parent), so the nodes are created from the root down
+  const size_t num_nodes = parents.size();
+  std::vector<size_t> first_child(num_nodes + 1, 0), children(num_nodes);
+  size_t root = num_nodes;
+  for (size_t index = 0; index < num_nodes; index++) {
+    if (parents[index] < 0) {
+      if (root != num_nodes)
+        throw std::invalid_argument("Tree with several roots");
+      root = index;
+    }
+    else if (size_t(parents[index]) >= num_nodes)
+      throw std::invalid_argument("Parent not found");
+    else
+      ++first_child[size_t(parents[index]) + 1];
+  }
+  if (root == num_nodes)
+    throw std::invalid_argument("Tree without root");
+
+  for (size_t index = 0; index < num_nodes; index++)
+    first_child[index + 1] += first_child[index];
+  std::vector<size_t> next_child(first_child.begin(), first_child.end() - 1);
+  for (size_t index = 0; index < num_nodes; index++) {
+    if (parents[index] >= 0)
+      children[next_child[size_t(parents[index])]++] = index;
+  }
+
+  //    Breadth-first order. The nodes which are not reached are in cycles
+  std::vector<size_t> order{ root };
+  order.reserve(num_nodes);
+  for (size_t position = 0; position < order.size(); position++) {
+    for (size_t child = first_child[order[position]]; child < first_child[order[position] + 1]; child++)
+      order.push_back(children[child]);
+  }
+  if (order.size() != num_nodes)
+    throw std::invalid_argument("Node is its own ancestor");
+
+  // Nodes, appended to the families of their parents, which are sorted at the end
+  std::vector<Node*> nodes(num_nodes, nullptr);
+  try {
+    for (size_t index : order) {
+      Node* parent_node = (index == root) ? nullptr : nodes[size_t(parents[index])];
+      OBJ_T* obj = create(index, parent_node ? &parent_node->value() : nullptr);
+      std::unique_ptr<OBJ_T> owned_obj(obj);
+      if (!parent_node) {
+        _tree.emplace_back(Family());
+        nodes[index] = &_tree[0].appendNode(Node(std::move(*owned_obj), 1));
+      }
+      else
+        nodes[index] = &_tree[parent_node->descFamilyId()].appendNode(Node(std::move(*owned_obj), *parent_node, _tree.size()));
+      ++_size;
+      _tree.emplace_back(Family());
+    }
+
+    for (auto& family : _tree)
+      family.sortNodes();
+
+    for (size_t index = 0; index < num_nodes; index++) {
+      auto map_it = _nodes_index.emplace_hint(_nodes_index.end(), nodes[index]->value().matchingKey(), nodes[index]);
+      if (map_it->second != nodes[index])
+        throw std::invalid_argument("Node already exists");
+    }
+  }
+  catch (...) {
+    _nodes_index.clear();
+    _tree.clear();
+    _size = 0;
+    throw;
+  }
+
+  std::vector<OBJ_T*> values(num_nodes);
+  for (size_t index = 0; index < num_nodes; index++)
+    values[index] = &nodes[index]->value();
+
+  return values;
+}
+
+
 /*    void removeNode(const typename OBJ_T::match_key_type& key, bool with_desc)   */
 /***********************************************************************************/
 TREE_TEMPLATE
@@ -64,9 +149,9 @@ void TREE_CLS::removeNode(const typename OBJ_T::match_key_type& key, bool with_d
   if (!with_desc && desc_family.size() > 0)
     throw std::invalid_argument("Node has descendants");
 
-  // Remove descendant nodes (recursively)
-  for (size_t i = 0; i < desc_family.size(); i++)
-    removeNode(desc_family[i].value().matchingKey(), true);
+  // Remove descendant nodes (recursively). Every removal shortens the family
+  while (desc_family.size() > 0)
+    removeNode(desc_family[0].value().matchingKey(), true);
 
   // Remove this node 
   _tree[node.parentNode().descFamilyId()].removeNode(node);
@@ -77,6 +162,40 @@ void TREE_CLS::removeNode(const typename OBJ_T::match_key_type& key, bool with_d
 }
 
 
+/*    void moveNode(const typename OBJ_T::match_key_type& key, const typename OBJ_T::match_key_type& parent_key)   */
+/*******************************************************************************************************************/
+TREE_TEMPLATE
+void TREE_CLS::moveNode(const typename OBJ_T::match_key_type& key, const typename OBJ_T::match_key_type& parent_key) {
+  // Search both nodes
+  auto map_it = searchNodeIt(key);
+  Node& node = *map_it->second;
+  Node& parent_node = searchNode(parent_key);
+
+  if (node.parentNode().isNull())
+    throw std::invalid_argument("The root node cannot be moved");
+  
+  // The new parent cannot be a descendant of the node
+  for (const Node* ancestor = &parent_node; !ancestor->isNull(); ancestor = &ancestor->parentNode()) {
+    if (ancestor == &node)
+      throw std::invalid_argument("Node cannot be moved under itself or its descendants");
+  }
+
+  if (&node.parentNode() == &parent_node)
+    return;
+
+  // Move the node to the new family. The value and the descendant family are kept
+  Node moved_node = _tree[node.parentNode().descFamilyId()].extractNode(node);
+  moved_node.parentNode(parent_node);
+  Node& new_node = _tree[parent_node.descFamilyId()].addNode(std::move(moved_node));
+
+  // The children must point to the new node
+  for (auto child : _tree[new_node.descFamilyId()].sortedNodes())
+    child->parentNode(new_node);
+
+  map_it->second = &new_node;
+}
+
+
 /*    OBJ_T& root()    */
 /***********************/
 TREE_TEMPLATE
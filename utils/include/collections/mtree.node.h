@@ -1,7 +1,7 @@
 /**
   *  \brief  Node Class. Represents a node in a tree
   *          A node has a value, a pointer to the parent node and the index of the descendant family of nodes.
-  *          These data members are set during the initialization of the node (constructor) and cannot be changed.
+  *          These data members are set during the initialization of the node (constructor). Only the parent can be changed, when the node is moved in the tree.
   *          Nodes cannot be copied or assigned, but they can be moved.
   *          A static const node, NULL_NODE, represents the empty node (for instance the parent of a root node)
   */
@@ -94,6 +94,11 @@ public:
     */
   Node& parentNode() const { return (_parent_node != nullptr) ? *_parent_node : NULL_NODE; }
 
+  /**
+    *  \brief  Set parent node (when the node is moved in the tree)
+    */
+  void parentNode(Node& parent) { _parent_node = &parent; }
+
   /**
     *  \brief  Get descendant family id
     */
@@ -112,7 +117,7 @@ protected:
   std::unique_ptr<OBJ_T> _value{ nullptr };
 
   /**
-    *  \brief  Pointer to the parent Node. This pointer value cannot be changed, i.e. the parent of a node cannot change (no set method)
+    *  \brief  Pointer to the parent Node. It only changes when the node is moved in the tree (see MTree::moveNode())
     */
   Node* _parent_node{ nullptr };
 
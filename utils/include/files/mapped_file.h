@@ -0,0 +1,91 @@
+//  MIT License
+//
+//  Copyright (c) 2018 Francisco de Lanuza
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+#include <stdexcept>
+
+
+namespace utils
+{
+  /**
+    *  \brief Read-only memory mapped file
+    *           The whole file is mapped in the address space of the process when the object is created, so its content can be read directly 
+    *           from memory, without copies. The pages are loaded by the OS when they are accessed for the first time.
+    *           The file is unmapped and closed when the object is destroyed: the content must not be used afterwards.
+  */
+  class MappedFile
+  {
+  public:
+    /**
+      *  \brief Constructor: opens and maps the file
+      *  @param file_name [in] Name of the file
+      *  @throw  runtime_error exception if the file cannot be opened or mapped
+      */
+    explicit MappedFile(const std::string& file_name);
+
+    /**
+      *  \brief Copy Constructor: DELETED
+      */
+    MappedFile(const MappedFile&) = delete;
+
+    /**
+      *  \brief Assignment operator: DELETED
+      */
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+      *  \brief Destructor: unmaps and closes the file
+      */
+    ~MappedFile();
+
+    /**
+      *  \brief Content of the file (nullptr if the file is empty)
+      */
+    const char* data() const { return _data; }
+
+    /**
+      *  \brief Size of the file, in bytes
+      */
+    size_t size() const { return _size; }
+
+
+  protected:
+    const char* _data{ nullptr };
+    size_t      _size{ 0 };
+
+    /**
+      *  Handles of the file and the mapping (Windows), or file descriptor (POSIX)
+      */
+#ifdef _WIN32
+    void*       _file{ nullptr };
+    void*       _mapping{ nullptr };
+#else
+    int         _file{ -1 };
+#endif
+  };
+}
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,120 @@
+//  MIT License
+//
+//  Copyright (c) 2018 Francisco de Lanuza
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+
+namespace utils
+{
+  /**
+    *  \brief Bounded ring buffer of objects, ordered from the oldest to the newest one. When it is full, adding a new object discards the oldest one.
+    *           The objects are allocated once, at construction, and reused: push() returns the slot of the discarded (or unused) object, 
+    *           which should be overwritten completely. So objects owning memory (e.g. vectors) keep their capacity and no allocations are needed.
+  */
+  template <typename T>
+  class RingBuffer
+  {
+  public:
+    /**
+      *  \brief Constructor: the objects are default constructed
+      *  @param  capacity  Maximum number of objects (at least 1)
+      */
+    explicit RingBuffer(size_t capacity) : _objects(std::max(size_t(1), capacity)) {}
+
+    /**
+      *  \brief Copy Constructor: DELETED
+      */
+    RingBuffer(const RingBuffer&) = delete;
+
+    /**
+      *  \brief Assignment operator: DELETED
+      */
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    size_t capacity() const { return _objects.size(); }
+
+    size_t size() const { return _size; }
+
+    bool empty() const { return _size == 0; }
+
+    /**
+      *  \brief Adds a new object, as the newest one, discarding the oldest one if the buffer is full
+      *  @return  The new object, to be overwritten
+      */
+    T& push() {
+      if (_size < _objects.size())
+        _size++;
+      else
+        _first = (_first + 1) % _objects.size();
+
+      return _objects[(_first + _size - 1) % _objects.size()];
+    }
+
+    /**
+      *  \brief Object by age: 0 is the oldest one, size() - 1 the newest one
+      *  @throw  out_of_range  If the index is not valid
+      */
+    T& operator[](size_t index) { return _objects[position(index)]; }
+    const T& operator[](size_t index) const { return _objects[position(index)]; }
+
+    /**
+      *  \brief Newest object
+      *  @throw  out_of_range  If the buffer is empty
+      */
+    T& back() { return (*this)[_size - 1]; }
+    const T& back() const { return (*this)[_size - 1]; }
+
+    /**
+      *  \brief Discards the newest objects, keeping the oldest size objects
+      */
+    void truncate(size_t size) { _size = std::min(_size, size); }
+
+    /**
+      *  \brief Discards all the objects
+      */
+    void clear() { _first = 0; _size = 0; }
+
+
+  protected:
+    std::vector<T> _objects;
+
+    /**
+      *  \brief Position of the oldest object in the vector
+      */
+    size_t _first{ 0 };
+
+    size_t _size{ 0 };
+
+    size_t position(size_t index) const {
+      if (index >= _size)
+        throw std::out_of_range("RingBuffer: invalid index");
+      return (_first + index) % _objects.size();
+    }
+  };
+}
+
+#endif // RING_BUFFER_H
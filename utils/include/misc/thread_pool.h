@@ -0,0 +1,174 @@
+//  MIT License
+//
+//  Copyright (c) 2018 Francisco de Lanuza
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <type_traits>
+
+
+namespace utils
+{
+  /**
+    *  \brief Work-stealing thread pool to execute parallel loops
+    *           A loop over the range [first, last) is split in chunks (tasks), which are distributed among the queues of the worker threads.
+    *           Each worker executes the tasks in its own queue and, once it is empty, steals tasks from the queues of the other workers.
+    *           The calling thread also executes tasks, until the whole range has been processed.
+    *           Tasks are plain (function, context, range) records stored in reusable queues: no memory is allocated per loop in steady state.
+    *           Only one loop can be executed at a time (loops must not be nested).
+    *           If any task throws an exception, the first one is rethrown in the calling thread once all the tasks have finished.
+  */
+  class ThreadPool
+  {
+  public:
+    /**
+      *  \brief Constructor
+      *         Creates and starts the worker threads
+      *  @param num_threads [in] Total number of threads executing the loops, including the calling thread. 0: number of hardware threads
+      */
+    explicit ThreadPool(size_t num_threads);
+
+    /**
+      *  \brief Copy Constructor: DELETED
+      */
+    ThreadPool(const ThreadPool&) = delete;
+
+    /**
+      *  \brief Assignment operator: DELETED
+      */
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+      *  \brief Destructor
+      *         Stops and joins the worker threads
+      */
+    ~ThreadPool();
+
+    /**
+      *  \brief Total number of threads executing the loops, including the calling thread
+      */
+    size_t size() const { return _queues.size(); }
+
+    /**
+      *  \brief Executes func(chunk_first, chunk_last) for all the chunks of the range [first, last) in parallel, and waits until all of them are finished
+      *  @param first [in] First index of the range
+      *  @param last  [in] Index after the last one of the range
+      *  @param chunk [in] Maximum number of indexes per task
+      *  @param func  [in] Callable object with the signature void(size_t, size_t)
+      *  @throw  the first exception thrown by any of the tasks
+      */
+    template <typename FUNC>
+    void parallelFor(size_t first, size_t last, size_t chunk, FUNC&& func) {
+      using FUNC_T = std::remove_reference_t<FUNC>;
+      run(first, last, chunk, [](void* context, size_t chunk_first, size_t chunk_last) { (*static_cast<FUNC_T*>(context))(chunk_first, chunk_last); },
+          const_cast<void*>(static_cast<const void*>(&func)));
+    }
+
+
+  protected:
+    /**
+      *  \brief Task: range of a loop to be executed by a thread
+      */
+    struct Task
+    {
+      void (*func)(void*, size_t, size_t);
+      void* context;
+      size_t first;
+      size_t last;
+    };
+
+    /**
+      *  \brief Queue of tasks of a thread. The owner takes the tasks from the back and the other threads steal them from the front
+      */
+    struct TaskQueue
+    {
+      std::mutex mutex;
+      std::vector<Task> tasks;
+      size_t head{ 0 };
+    };
+
+    /**
+      *  \brief Queues of tasks: one per worker thread, plus the one of the calling thread (the last one)
+      */
+    std::vector<std::unique_ptr<TaskQueue>> _queues;
+
+    /**
+      *  \brief Worker threads
+      */
+    std::vector<std::thread> _workers;
+
+    /**
+      *  \brief Synchronization of the idle workers
+      */
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    bool _stop{ false };
+
+    /**
+      *  \brief Number of tasks waiting in the queues (it can be negative for a short time, while new tasks are being queued)
+      */
+    std::atomic<int64_t> _queued{ 0 };
+
+    /**
+      *  \brief Number of tasks of the current loop which are not finished yet
+      */
+    std::atomic<size_t> _pending{ 0 };
+
+    /**
+      *  \brief First exception thrown by a task of the current loop
+      */
+    std::exception_ptr _exception{ nullptr };
+    std::mutex _exception_mutex;
+
+
+  private:
+    /**
+      *  \brief Splits the range in tasks, distributes them and executes them until all are finished
+      */
+    void run(size_t first, size_t last, size_t chunk, void (*func)(void*, size_t, size_t), void* context);
+
+    /**
+      *  \brief Main loop of the worker threads
+      */
+    void work(size_t index);
+
+    /**
+      *  \brief Takes a task from the own queue or, if it is empty, steals one from the other queues
+      *  @return  false if all the queues are empty
+      */
+    bool take(size_t index, Task& task);
+
+    /**
+      *  \brief Executes a task and updates the number of pending tasks
+      */
+    void execute(const Task& task);
+  };
+}
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,119 @@
+//  MIT License
+//
+//  Copyright (c) 2018 Francisco de Lanuza
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+
+namespace utils
+{
+  /**
+    *  \brief Lock-free triple buffer, to pass the latest version of an object from one writer thread to one reader thread
+    *           The writer fills the write buffer and publishes it. The reader takes the latest published buffer, if any, and reads it.
+    *           Neither the writer nor the reader are ever blocked: the writer always has a free buffer and the reader keeps the last taken buffer
+    *           until a newer one is published. Intermediate versions can be skipped by the reader.
+    *           The buffers are reused, so the writer should overwrite all the content of the object before publishing it.
+  */
+  template <typename T>
+  class TripleBuffer
+  {
+  public:
+    /**
+      *  \brief Default Constructor: the 3 buffers are default constructed
+      */
+    TripleBuffer() {}
+
+    /**
+      *  \brief Copy Constructor: DELETED
+      */
+    TripleBuffer(const TripleBuffer&) = delete;
+
+    /**
+      *  \brief Assignment operator: DELETED
+      */
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    /**
+      *  \brief WRITER: Buffer to be filled before publishing it
+      */
+    T& writeBuffer() { return _buffers[_write]; }
+
+    /**
+      *  \brief WRITER: Publishes the write buffer, which is exchanged by the free one
+      */
+    void publish() {
+      _write = _shared.exchange(uint8_t(_write | NEW_DATA), std::memory_order_acq_rel) & INDEX;
+    }
+
+    /**
+      *  \brief READER: Takes the latest published buffer, if there is a new one
+      *  @return  true if a new buffer has been taken
+      */
+    bool update() {
+      if (!(_shared.load(std::memory_order_acquire) & NEW_DATA))
+        return false;
+
+      _read = _shared.exchange(_read, std::memory_order_acq_rel) & INDEX;
+      return true;
+    }
+
+    /**
+      *  \brief READER: Last taken buffer
+      */
+    const T& readBuffer() const { return _buffers[_read]; }
+
+
+  protected:
+    /**
+      *  \brief Flag of the shared index, set when the shared buffer has been published and not taken yet by the reader
+      */
+    static constexpr uint8_t NEW_DATA{ 0b100 };
+
+    /**
+      *  \brief Mask of the buffer index in the shared index
+      */
+    static constexpr uint8_t INDEX{ 0b011 };
+
+    std::array<T, 3> _buffers;
+
+    /**
+      *  \brief Index of the buffer owned by the writer
+      */
+    uint8_t _write{ 0 };
+
+    /**
+      *  \brief Index of the buffer exchanged between the writer and the reader, with the NEW_DATA flag
+      */
+    std::atomic<uint8_t> _shared{ 1 };
+
+    /**
+      *  \brief Index of the buffer owned by the reader
+      */
+    uint8_t _read{ 2 };
+  };
+}
+
+#endif // TRIPLE_BUFFER_H
@@ -0,0 +1,87 @@
+#include <files/mapped_file.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+using namespace utils;
+
+/// ***********************************************************************************************************************
+/// ************************************************* PUBLIC **************************************************************
+
+/// CONSTRUCTOR()
+MappedFile::MappedFile(const std::string& file_name) {
+#ifdef _WIN32
+  HANDLE file = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    throw std::runtime_error("File cannot be opened: " + file_name);
+  _file = file;
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    throw std::runtime_error("File size cannot be read: " + file_name);
+  }
+  _size = size_t(size.QuadPart);
+
+  // An empty file cannot be mapped
+  if (_size == 0)
+    return;
+
+  _mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (_mapping)
+    _data = static_cast<const char*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+  if (!_data) {
+    if (_mapping)
+      CloseHandle(_mapping);
+    CloseHandle(file);
+    throw std::runtime_error("File cannot be mapped: " + file_name);
+  }
+#else
+  _file = open(file_name.c_str(), O_RDONLY);
+  if (_file < 0)
+    throw std::runtime_error("File cannot be opened: " + file_name);
+
+  struct stat file_stat;
+  if (fstat(_file, &file_stat) != 0) {
+    close(_file);
+    throw std::runtime_error("File size cannot be read: " + file_name);
+  }
+  _size = size_t(file_stat.st_size);
+
+  // An empty file cannot be mapped
+  if (_size == 0)
+    return;
+
+  void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _file, 0);
+  if (data == MAP_FAILED) {
+    close(_file);
+    throw std::runtime_error("File cannot be mapped: " + file_name);
+  }
+  _data = static_cast<const char*>(data);
+#endif
+}
+
+
+/// DESTRUCTOR()
+MappedFile::~MappedFile() {
+#ifdef _WIN32
+  if (_data)
+    UnmapViewOfFile(_data);
+  if (_mapping)
+    CloseHandle(_mapping);
+  CloseHandle(_file);
+#else
+  if (_data)
+    munmap(const_cast<char*>(_data), _size);
+  close(_file);
+#endif
+}
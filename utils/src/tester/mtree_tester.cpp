@@ -134,6 +134,34 @@ int main(int argc, char** args) {
   t8.removeNode(19);
   std::cout << t8;
 
+  // Move a node with its descendants: the values keep their address
+  t8.addNode(INT(20, 41), 6);
+  t8.addNode(INT(21, 51), 20);
+  const INT* moved = &t8.find(20);
+  t8.moveNode(20, 7);
+  std::cout << t8;
+  std::cout << "Parent: " << t8.parent(20) << " -- Same value: " << (moved == &t8.find(20)) << " -- Grandchild parent: " << t8.parent(21) << "\n";
+  try {
+    t8.moveNode(7, 21);
+  }
+  catch (std::invalid_argument& exc) {
+    std::cout << "Exception: " << exc.what() << "\n";
+  }
+
+  // Build a tree at once from the parent indices (the children are listed before their parents)
+  MTree<INT> t10;
+  std::vector<int64_t> parents{ 3, 3, 1, -1, 0 };
+  auto values = t10.adoptNodes(parents, [](size_t index, INT* parent) { return new INT(int(100 + index), int(10 - index)); });
+  std::cout << t10;
+  std::cout << "Parent: " << t10.parent(104) << " -- Same value: " << (values[4] == &t10.find(104)) << "\n";
+  MTree<INT> t11;
+  try {
+    t11.adoptNodes(std::vector<int64_t>{ -1, 2, 1 }, [](size_t index, INT* parent) { return new INT(int(200 + index), 0); });
+  }
+  catch (std::invalid_argument& exc) {
+    std::cout << "Exception: " << exc.what() << " -- Size: " << t11.size() << "\n";
+  }
+
 
   return 0;
 
@@ -0,0 +1,33 @@
+#include <misc/ring_buffer.h>
+
+#include <iostream>
+#include <string>
+
+using namespace utils;
+using namespace std;
+
+int rb__main(int argc, char** args) {
+  RingBuffer<string> buffer(3);
+  cout << "Capacity: " << buffer.capacity() << endl;
+
+  for (int i = 0; i < 5; i++) {
+    buffer.push() = "Object " + to_string(i);
+    cout << "Size: " << buffer.size() << " Oldest: " << buffer[0] << " Newest: " << buffer.back() << endl;
+  }
+
+  buffer.truncate(2);
+  cout << "Truncated. Size: " << buffer.size() << " Newest: " << buffer.back() << endl;
+  buffer.push() = "Object 5";
+  for (size_t i = 0; i < buffer.size(); i++)
+    cout << i << ": " << buffer[i] << endl;
+
+  buffer.clear();
+  try {
+    buffer.back();
+  }
+  catch (out_of_range& exc) {
+    cout << "Exception caught: " << exc.what() << endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,37 @@
+#include <misc/thread_pool.h>
+
+#include <iostream>
+#include <numeric>
+#include <chrono>
+#include <cmath>
+
+using namespace utils;
+using namespace std;
+
+int tp__main(int argc, char** args) {
+  ThreadPool pool(argc > 1 ? atoi(args[1]) : 0);
+  cout << "Threads: " << pool.size() << endl;
+
+  vector<double> values(1000000);
+  auto start = chrono::steady_clock::now();
+  for (int iter = 0; iter < 100; iter++) {
+    pool.parallelFor(0, values.size(), 10000, [&values](size_t first, size_t last) {
+      for (size_t i = first; i < last; i++)
+        values[i] = sqrt(double(i));
+    });
+  }
+  cout << "Parallel loops: " << chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count() << " ms" << endl;
+  cout << "Sum: " << accumulate(values.begin(), values.end(), 0.0) << endl;
+
+  try {
+    pool.parallelFor(0, 100, 1, [](size_t first, size_t last) {
+      if (first <= 50 && 50 < last)
+        throw runtime_error("Exception in task 50");
+    });
+  }
+  catch (runtime_error& exc) {
+    cout << "Exception caught: " << exc.what() << endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,152 @@
+#include <misc/thread_pool.h>
+
+#include <algorithm>
+
+
+using namespace utils;
+
+/// ***********************************************************************************************************************
+/// ************************************************* PUBLIC **************************************************************
+
+/// CONSTRUCTOR()
+ThreadPool::ThreadPool(size_t num_threads) {
+  if (num_threads == 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+  for (size_t i = 0; i < num_threads; i++)
+    _queues.push_back(std::make_unique<TaskQueue>());
+
+  // The last queue belongs to the calling thread
+  for (size_t i = 0; i < num_threads - 1; i++)
+    _workers.emplace_back(&ThreadPool::work, this, i);
+}
+
+
+/// DESTRUCTOR()
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stop = true;
+  }
+  _cv.notify_all();
+
+  for (auto& worker : _workers)
+    worker.join();
+}
+
+/// ************************************************* PUBLIC (END) ********************************************************
+/// ***********************************************************************************************************************
+
+
+/// ***********************************************************************************************************************
+/// ************************************************* PRIVATE *************************************************************
+
+void ThreadPool::run(size_t first, size_t last, size_t chunk, void (*func)(void*, size_t, size_t), void* context) {
+  if (first >= last)
+    return;
+
+  chunk = std::max(size_t(1), chunk);
+  size_t num_tasks = (last - first + chunk - 1) / chunk;
+
+  // Without workers or with only 1 task there is nothing to parallelize
+  if (_workers.empty() || num_tasks == 1) {
+    func(context, first, last);
+    return;
+  }
+
+  _exception = nullptr;
+  _pending = num_tasks;
+
+  // Distribute the tasks among all the queues (round robin), so stealing is only needed to balance the load
+  size_t queue_index{ 0 };
+  for (size_t task_first = first; task_first < last; task_first += chunk) {
+    auto& queue = *_queues[queue_index];
+    {
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      queue.tasks.push_back(Task{ func, context, task_first, std::min(last, task_first + chunk) });
+    }
+    queue_index = (queue_index + 1) % _queues.size();
+  }
+
+  // Wake up the workers
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _queued += num_tasks;
+  }
+  _cv.notify_all();
+
+  // The calling thread also executes tasks until all of them are finished
+  Task task;
+  while (_pending > 0) {
+    if (take(_queues.size() - 1, task))
+      execute(task);
+    else
+      std::this_thread::yield();
+  }
+
+  if (_exception)
+    std::rethrow_exception(_exception);
+}
+
+
+void ThreadPool::work(size_t index) {
+  Task task;
+  while (true) {
+    if (take(index, task)) {
+      execute(task);
+      continue;
+    }
+
+    // No tasks available: wait for new tasks or for the pool to be stopped
+    std::unique_lock<std::mutex> lock(_mutex);
+    _cv.wait(lock, [this] { return _stop || _queued > 0; });
+    if (_stop)
+      return;
+  }
+}
+
+
+bool ThreadPool::take(size_t index, Task& task) {
+  // Own queue first (LIFO), then steal from the others (FIFO)
+  for (size_t i = 0; i < _queues.size(); i++) {
+    auto& queue = *_queues[(index + i) % _queues.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.head == queue.tasks.size())
+      continue;
+
+    if (i == 0) {
+      task = queue.tasks.back();
+      queue.tasks.pop_back();
+    }
+    else
+      task = queue.tasks[queue.head++];
+
+    // Reuse the storage once the queue is empty
+    if (queue.head == queue.tasks.size()) {
+      queue.tasks.clear();
+      queue.head = 0;
+    }
+
+    _queued--;
+    return true;
+  }
+
+  return false;
+}
+
+
+void ThreadPool::execute(const Task& task) {
+  try {
+    task.func(task.context, task.first, task.last);
+  }
+  catch (...) {
+    std::lock_guard<std::mutex> lock(_exception_mutex);
+    if (!_exception)
+      _exception = std::current_exception();
+  }
+
+  _pending--;
+}
+
+/// ************************************************* PRIVATE (END) *******************************************************
+/// ***********************************************************************************************************************